@@ -0,0 +1,1272 @@
+﻿#include "Bench.h"
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshPacking.h"
+#include "MeshTangents.h"
+#include "Material.h"
+#include "TextureCompress.h"
+#include "TextureMips.h"
+#include "Snow.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "Culling.h"
+#include "Terrain.h"
+#include "TerrainNoise.h"
+#include "Cdlod.h"
+#include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include "stb_image.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* kDefaultObjs[] = { "model/Замок3.obj", "model/sphere1.obj" };
+static const char* kDefaultTextures[] = {
+    "model/Bricks097_1K-PNG/Bricks097_1K-PNG_Color.png", "model/Bricks097_1K-PNG/Bricks097_1K-PNG_NormalGL.png",
+    "model/grass/Grass002_1K-PNG_Color.png", "model/wood/wood_planks_diff_1k.jpg", "skybox/px.jpg"
+};
+
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t fileSize(const char* path) {
+    MappedFile file;
+    if (!mapFile(path, file)) return 0;
+    size_t size = file.size;
+    unmapFile(file);
+    return size;
+}
+
+static bool sameMesh(const std::vector<Vertex>& va, const std::vector<unsigned int>& ia,
+    const std::vector<Vertex>& vb, const std::vector<unsigned int>& ib) {
+    return va.size() == vb.size() && ia.size() == ib.size() &&
+        std::memcmp(va.data(), vb.data(), va.size() * sizeof(Vertex)) == 0 &&
+        std::memcmp(ia.data(), ib.data(), ia.size() * sizeof(unsigned int)) == 0;
+}
+
+// Best-of-N wall time for one loader.
+template <typename Fn>
+static double timeLoader(Fn fn, const char* path, int iterations,
+    std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    double best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        vertices.clear(); vertices.shrink_to_fit();
+        indices.clear(); indices.shrink_to_fit();
+        double t0 = nowSeconds();
+        if (!fn(path, vertices, indices)) return -1.0;
+        double t = nowSeconds() - t0;
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static int benchObj(const std::vector<const char*>& paths, int iterations) {
+    bool allSame = true;
+    for (const char* path : paths) {
+        size_t bytes = fileSize(path);
+        if (!bytes) continue;
+        double mb = bytes / (1024.0 * 1024.0);
+
+        std::vector<Vertex> vStream, vMapped;
+        std::vector<unsigned int> iStream, iMapped;
+        double tStream = timeLoader(loadOBJ, path, iterations, vStream, iStream);
+        double tMapped = timeLoader(loadOBJMapped, path, iterations, vMapped, iMapped);
+        if (tStream < 0.0 || tMapped < 0.0) continue;
+        bool same = sameMesh(vStream, iStream, vMapped, iMapped);
+        allSame = allSame && same;
+
+        std::cout << path << ": " << mb << " MB, " << iMapped.size() / 3 << " triangles\n"
+            << "  stream: " << tStream * 1000.0 << " ms (" << mb / tStream << " MB/s)\n"
+            << "  mapped: " << tMapped * 1000.0 << " ms (" << mb / tMapped << " MB/s)\n"
+            << "  speedup " << tStream / tMapped << "x, output " << (same ? "identical" : "DIFFERS") << "\n";
+    }
+    return allSame ? 0 : 1;
+}
+
+static int benchObjThreads(const std::vector<const char*>& paths, int iterations) {
+    static const unsigned int kThreadCounts[] = { 1, 2, 4, 8, 16 };
+    bool allSame = true;
+    for (const char* path : paths) {
+        size_t bytes = fileSize(path);
+        if (!bytes) continue;
+        double mb = bytes / (1024.0 * 1024.0);
+
+        std::vector<Vertex> vSerial;
+        std::vector<unsigned int> iSerial;
+        double tSerial = timeLoader(loadOBJMapped, path, 1, vSerial, iSerial);
+        if (tSerial < 0.0) continue;
+        std::cout << path << ": " << mb << " MB, serial mapped " << tSerial * 1000.0 << " ms\n";
+
+        double tOne = 0.0;
+        for (unsigned int threads : kThreadCounts) {
+            std::vector<Vertex> v;
+            std::vector<unsigned int> idx;
+            double t = timeLoader([threads](const char* p, std::vector<Vertex>& vv, std::vector<unsigned int>& ii) {
+                ObjLoadOptions options;
+                options.threads = threads;
+                return loadOBJParallel(p, vv, ii, options);
+            }, path, iterations, v, idx);
+            if (threads == 1) tOne = t;
+            bool same = sameMesh(vSerial, iSerial, v, idx);
+            allSame = allSame && same;
+            std::cout << "  " << threads << " threads: " << t * 1000.0 << " ms (" << mb / t << " MB/s, "
+                << tOne / t << "x)" << (same ? "" : " DIFFERS") << "\n";
+        }
+    }
+    return allSame ? 0 : 1;
+}
+
+static int benchWeld(const std::vector<const char*>& paths, int iterations) {
+    for (const char* path : paths) {
+        std::vector<Vertex> vFlat, vWeld;
+        std::vector<unsigned int> iFlat, iWeld;
+        ObjLoadOptions options;
+        double tFlat = timeLoader([&](const char* p, std::vector<Vertex>& vv, std::vector<unsigned int>& ii) {
+            return loadOBJParallel(p, vv, ii, options);
+        }, path, iterations, vFlat, iFlat);
+        options.weld = true;
+        double tWeld = timeLoader([&](const char* p, std::vector<Vertex>& vv, std::vector<unsigned int>& ii) {
+            return loadOBJParallel(p, vv, ii, options);
+        }, path, iterations, vWeld, iWeld);
+        if (tFlat < 0.0 || tWeld < 0.0) continue;
+
+        bool same = iFlat.size() == iWeld.size();
+        for (size_t i = 0; same && i < iFlat.size(); ++i)
+            same = std::memcmp(&vFlat[iFlat[i]], &vWeld[iWeld[i]], sizeof(Vertex)) == 0;
+
+        MeshStats before = computeMeshStats(vFlat.size(), iFlat);
+        MeshStats after = computeMeshStats(vWeld.size(), iWeld);
+        std::cout << path << ":\n";
+        printMeshStats("  unwelded", before);
+        printMeshStats("  welded  ", after);
+        std::cout << "  load " << tFlat * 1000.0 << " ms -> " << tWeld * 1000.0 << " ms, vertices "
+            << static_cast<double>(before.vertexCount) / after.vertexCount << "x fewer, triangles "
+            << (same ? "identical" : "DIFFER") << "\n";
+        if (!same) return 1;
+    }
+    return 0;
+}
+
+// Triangles as sorted vertex-content triples, for order-independent comparisons.
+static std::vector<std::array<Vertex, 3>> triangleSet(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+    std::vector<std::array<Vertex, 3>> tris(indices.size() / 3);
+    for (size_t t = 0; t < tris.size(); ++t)
+        tris[t] = { vertices[indices[3 * t]], vertices[indices[3 * t + 1]], vertices[indices[3 * t + 2]] };
+    std::sort(tris.begin(), tris.end(), [](const std::array<Vertex, 3>& a, const std::array<Vertex, 3>& b) {
+        return std::memcmp(a.data(), b.data(), sizeof(a)) < 0;
+    });
+    return tris;
+}
+
+static int benchVertexCache(const std::vector<const char*>& paths) {
+    for (const char* path : paths) {
+        ObjLoadOptions options;
+        options.weld = true;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        if (!loadOBJParallel(path, vertices, indices, options)) continue;
+        std::vector<std::array<Vertex, 3>> before = triangleSet(vertices, indices);
+
+        std::cout << path << ":\n";
+        printMeshStats("  exported  FIFO32", computeMeshStats(vertices.size(), indices, 32));
+        printMeshStats("  exported  FIFO16", computeMeshStats(vertices.size(), indices, 16));
+        double t0 = nowSeconds();
+        optimizeVertexCache(indices, vertices.size());
+        double t1 = nowSeconds();
+        optimizeVertexFetch(vertices, indices);
+        double t2 = nowSeconds();
+        printMeshStats("  optimized FIFO32", computeMeshStats(vertices.size(), indices, 32));
+        printMeshStats("  optimized FIFO16", computeMeshStats(vertices.size(), indices, 16));
+        bool same = std::memcmp(before.data(), triangleSet(vertices, indices).data(),
+            before.size() * sizeof(before[0])) == 0;
+        std::cout << "  vertex cache pass " << (t1 - t0) * 1000.0 << " ms, fetch reorder " << (t2 - t1) * 1000.0
+            << " ms, triangles " << (same ? "preserved" : "CHANGED") << "\n";
+        if (!same) return 1;
+    }
+    return 0;
+}
+
+// Size savings of 16-bit indices + PackedVertex and the worst-case decode error per attribute,
+// measured through the packed index buffer so sub-mesh splits are checked as well.
+static int benchPack(const std::vector<const char*>& paths) {
+    for (const char* path : paths) {
+        ObjLoadOptions options;
+        options.weld = true;
+        options.optimize = true;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        ObjMaterialInfo materials;
+        if (!loadOBJParallel(path, vertices, indices, options, &materials)) continue;
+
+        double t0 = nowSeconds();
+        PackedMesh packed;
+        packMesh(vertices, indices, materials.ranges, true, packed);
+        double t1 = nowSeconds();
+        MeshData data = packed.view();
+
+        const uint16_t* shortIndices = reinterpret_cast<const uint16_t*>(packed.indexData.data());
+        glm::vec3 extent = data.boundsMax - data.boundsMin;
+        float extentMax = std::max(extent.x, std::max(extent.y, extent.z));
+        float maxPos = 0.0f, maxAngle = 0.0f, maxUV = 0.0f;
+        for (const SubMesh& sub : packed.subMeshes) {
+            for (uint32_t i = sub.indexOffset; i < sub.indexOffset + sub.indexCount; ++i) {
+                const Vertex& a = vertices[indices[i]];
+                Vertex b = unpackVertex(data, sub.baseVertex + shortIndices[i]);
+                glm::vec3 d = glm::abs(a.Position - b.Position);
+                maxPos = std::max(maxPos, std::max(d.x, std::max(d.y, d.z)));
+                float la = glm::length(a.Normal);
+                if (la > 0.0f) {
+                    float c = std::max(-1.0f, std::min(1.0f, glm::dot(a.Normal / la, b.Normal)));
+                    maxAngle = std::max(maxAngle, std::acos(c) * 57.2957795f);
+                }
+                glm::vec2 duv = glm::abs(a.TexCoords - b.TexCoords);
+                maxUV = std::max(maxUV, std::max(duv.x, duv.y));
+            }
+        }
+
+        std::cout << path << ":\n";
+        printPackStats("  packed", data);
+        std::cout << "  pack " << (t1 - t0) * 1000.0 << " ms, max error: position " << maxPos << " ("
+            << (extentMax > 0.0f ? maxPos / extentMax : 0.0f) << " of extent), normal " << maxAngle
+            << " deg, uv " << maxUV << "\n";
+    }
+    return 0;
+}
+
+// Per-frame draw calls and texture binds of the per-material draw: ranges in file order with both
+// textures bound for every range, against ranges sorted by texture with redundant binds skipped.
+// Texture names are stand-ins (one per distinct file), so this runs without a GL context.
+static int benchMaterials(const std::vector<const char*>& paths) {
+    for (const char* path : paths) {
+        ObjLoadOptions options;
+        options.weld = true;
+        options.optimize = true;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        ObjMaterialInfo info;
+        if (!loadOBJParallel(path, vertices, indices, options, &info)) continue;
+        std::vector<Material> materials;
+        loadOBJMaterials(path, info.libraries, info.names, materials);
+        PackedMesh packed;
+        packMesh(vertices, indices, info.ranges, false, packed);
+
+        std::map<std::string, GLuint> names;
+        auto textureName = [&](const std::string& file) -> GLuint {
+            if (file.empty()) return 0;
+            return names.emplace(file, static_cast<GLuint>(names.size() + 2)).first->second;
+        };
+        MaterialSet set;
+        set.fallback.diffuseMap = 1;
+        for (const Material& m : materials) {
+            MaterialGL gl;
+            gl.diffuseMap = m.diffuseMap.empty() ? 1 : textureName(m.diffuseMap);
+            gl.normalMap = textureName(m.normalMap);
+            gl.diffuseColor = m.diffuse;
+            set.materials.push_back(gl);
+        }
+        RenderStats before = countMaterialBinds(packed.subMeshes, set, false);
+        RenderStats after = countMaterialBinds(sortByMaterial(packed.subMeshes, set), set, true);
+
+        std::cout << path << ": " << info.libraries.size() << " mtllib, " << materials.size() << " materials, "
+            << names.size() << " texture files, " << packed.subMeshes.size() << " ranges\n";
+        for (const Material& m : materials) {
+            std::cout << "  " << m.name << ": Kd " << m.diffuse.x << " " << m.diffuse.y << " " << m.diffuse.z
+                << (m.diffuseMap.empty() ? "" : ", map_Kd " + m.diffuseMap)
+                << (m.normalMap.empty() ? "" : ", bump " + m.normalMap) << "\n";
+        }
+        std::cout << "  file order: " << before.drawCalls << " draw calls, " << before.textureBinds << " texture binds\n"
+            << "  sorted:     " << after.drawCalls << " draw calls, " << after.textureBinds << " texture binds\n";
+    }
+    return 0;
+}
+
+// Level-0 encode throughput (one thread and all threads, best of N) and PSNR over the channels the
+// format keeps: RGB for BC1, RGBA for BC3, RG for BC5.
+static int benchCompress(const std::vector<const char*>& paths, int iterations) {
+    JobSystem jobs;
+    startJobSystem(jobs);
+    const size_t threads = jobStats(jobs).size();
+    for (const char* path : paths) {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path, &width, &height, &channels, 0);
+        if (!pixels) {
+            std::cerr << "ERROR: Failed to load texture: " << path << std::endl;
+            continue;
+        }
+        const BlockFormat format = chooseBlockFormat(path, pixels, width, height, channels);
+        std::vector<unsigned char> blocks(compressedLevelSize(format, width, height));
+        double best[2] = { 1e30, 1e30 };
+        for (int i = 0; i < iterations; ++i) {
+            for (int t = 0; t < 2; ++t) {
+                double t0 = nowSeconds();
+                compressImage(pixels, width, height, channels, format, blocks.data(), t == 0 ? nullptr : &jobs);
+                best[t] = std::min(best[t], nowSeconds() - t0);
+            }
+        }
+
+        std::vector<unsigned char> decoded(static_cast<size_t>(width) * height * 4);
+        decompressImage(blocks.data(), width, height, format, decoded.data());
+        const int compared = format == BLOCK_BC5 ? 2 : format == BLOCK_BC1 ? 3 : 4;
+        double squared = 0.0;
+        for (size_t p = 0; p < static_cast<size_t>(width) * height; ++p) {
+            for (int k = 0; k < compared; ++k) {
+                const int source = k < channels ? pixels[p * channels + k] : 255;
+                const double d = source - decoded[p * 4 + k];
+                squared += d * d;
+            }
+        }
+        const double mse = squared / (static_cast<double>(width) * height * compared);
+        const double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+        const double mpix = static_cast<double>(width) * height / 1e6;
+        const size_t raw = static_cast<size_t>(width) * height * channels;
+        std::cout << path << ": " << width << "x" << height << "x" << channels << " -> " << blockFormatName(format)
+            << ", " << raw / 1024 << " KB -> " << blocks.size() / 1024 << " KB (" << static_cast<double>(raw) / blocks.size()
+            << "x), PSNR " << psnr << " dB\n"
+            << "  encode: " << mpix / best[0] << " MPix/s on 1 thread, " << mpix / best[1] << " MPix/s on " << threads << "\n";
+        stbi_image_free(pixels);
+    }
+    stopJobSystem(jobs);
+    return 0;
+}
+
+// Mip chain generation per filter: plain loops on one thread, SIMD on one thread and SIMD on every
+// thread (best of N), checked against buildMipChainReference.
+static int benchMips(const std::vector<const char*>& paths, int iterations) {
+    JobSystem jobs;
+    startJobSystem(jobs);
+    const size_t threads = jobStats(jobs).size();
+    std::cout << "SIMD: " << simdLevelName(bestSimdLevel()) << ", " << threads << " threads\n";
+    for (const char* path : paths) {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path, &width, &height, &channels, 0);
+        if (!pixels) {
+            std::cerr << "ERROR: Failed to load texture: " << path << std::endl;
+            continue;
+        }
+        std::vector<std::vector<unsigned char>> source(1);
+        source[0].assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+        stbi_image_free(pixels);
+        const MipContent content = mipContentForPath(path);
+        std::cout << path << ": " << width << "x" << height << "x" << channels
+            << (content == MIP_CONTENT_NORMAL ? ", normal map" : ", color") << "\n";
+
+        for (MipFilter filter : { MIP_FILTER_BOX, MIP_FILTER_KAISER }) {
+            MipOptions options;
+            options.filter = filter;
+            options.content = content;
+            std::vector<std::vector<unsigned char>> levels[3];
+            double best[3] = { 1e30, 1e30, 1e30 };
+            for (int i = 0; i < iterations; ++i) {
+                for (int run = 0; run < 3; ++run) {
+                    options.simd = run > 0;
+                    options.jobs = run == 2 ? &jobs : nullptr;
+                    levels[run] = source;
+                    double t0 = nowSeconds();
+                    buildMipChain(levels[run], width, height, channels, options);
+                    best[run] = std::min(best[run], nowSeconds() - t0);
+                }
+            }
+            std::vector<std::vector<unsigned char>> reference = source;
+            buildMipChainReference(reference, width, height, channels, options);
+            int maxDiff = 0;
+            bool identical = true;
+            for (size_t level = 1; level < reference.size(); ++level) {
+                identical = identical && levels[0][level] == levels[1][level] && levels[1][level] == levels[2][level];
+                for (size_t i = 0; i < reference[level].size(); ++i)
+                    maxDiff = std::max(maxDiff, std::abs(int(reference[level][i]) - int(levels[2][level][i])));
+            }
+            std::cout << "  " << mipFilterName(filter) << ": scalar " << best[0] * 1000.0 << " ms, SIMD "
+                << best[1] * 1000.0 << " ms, SIMD x" << threads << " " << best[2] * 1000.0 << " ms; "
+                << reference.size() << " levels, max diff vs reference " << maxDiff
+                << (identical ? ", scalar/SIMD identical" : ", SCALAR/SIMD MISMATCH") << "\n";
+        }
+    }
+    stopJobSystem(jobs);
+    return 0;
+}
+
+// CPU side of one snow frame, old path against the instanced one. The old loop built a model matrix per
+// flake and issued a uniform lookup, two uniform uploads, a VAO bind and a draw for each; the GL calls
+// cannot run headless, so only their count is reported. The instanced path updates the flakes and
+// copies them into the instance buffer (here: a staging vector) for one draw.
+static int benchSnow(int iterations) {
+    const size_t counts[] = { 500, 10000, 100000, 1000000 };
+    const int frames = 10;
+    for (size_t count : counts) {
+        Snowfall snow;
+        initSnowfall(snow, count);
+        std::vector<glm::vec3> positions(count);
+        for (size_t i = 0; i < count; ++i) positions[i] = glm::vec3(snow.x[i], snow.y[i], snow.z[i]);
+        std::vector<float> staging(3 * count);
+        volatile float sink = 0.0f;
+
+        double perFlake = 1e30, instanced = 1e30;
+        for (int it = 0; it < iterations; ++it) {
+            double t0 = nowSeconds();
+            for (int f = 0; f < frames; ++f) {
+                for (glm::vec3& p : positions) {
+                    p.y -= 0.016f * 1.5f;
+                    if (p.y < -1.0f) p.y = 10.0f;
+                    glm::mat4 model = glm::translate(glm::mat4(1.0f), p);
+                    model = glm::scale(model, glm::vec3(0.02f));
+                    sink = sink + model[3][1];
+                }
+            }
+            perFlake = std::min(perFlake, (nowSeconds() - t0) / frames);
+
+            t0 = nowSeconds();
+            for (int f = 0; f < frames; ++f) {
+                updateSnowfall(snow, 0.016f);
+                std::memcpy(staging.data(), snow.x.data(), count * sizeof(float));
+                std::memcpy(staging.data() + count, snow.y.data(), count * sizeof(float));
+                std::memcpy(staging.data() + 2 * count, snow.z.data(), count * sizeof(float));
+            }
+            instanced = std::min(instanced, (nowSeconds() - t0) / frames);
+        }
+        std::cout << count << " flakes: per-flake " << perFlake * 1000.0 << " ms + " << count << " draw calls, "
+            << 3 * count << " uniform calls; instanced " << instanced * 1000.0 << " ms + 1 draw call, "
+            << staging.size() * sizeof(float) / 1024 << " KB streamed\n";
+    }
+    return 0;
+}
+
+// Snow simulation kernels: every SIMD level must reproduce the scalar streams bit for bit (including
+// respawns) over a few hundred uneven steps, then update throughput on one core.
+static int benchParticles(int iterations) {
+    const SimdLevel levels[] = { SIMD_SCALAR, SIMD_SSE, SIMD_AVX };
+    const int levelCount = cpuHasAVX() ? 3 : 2;
+    int rc = 0;
+
+    const size_t checkCount = 100003;
+    Snowfall reference;
+    reference.simd = SIMD_SCALAR;
+    initSnowfall(reference, checkCount);
+    for (int step = 0; step < 600; ++step) updateSnowfall(reference, 0.01f + 0.001f * (step % 7));
+    for (int l = 1; l < levelCount; ++l) {
+        Snowfall snow;
+        snow.simd = levels[l];
+        initSnowfall(snow, checkCount);
+        for (int step = 0; step < 600; ++step) updateSnowfall(snow, 0.01f + 0.001f * (step % 7));
+        bool identical = true;
+        const AlignedFloats Snowfall::* streams[] = { &Snowfall::x, &Snowfall::y, &Snowfall::z, &Snowfall::vx,
+            &Snowfall::vy, &Snowfall::vz, &Snowfall::life, &Snowfall::phase };
+        for (auto stream : streams)
+            identical = identical && std::memcmp((snow.*stream).data(), (reference.*stream).data(), checkCount * sizeof(float)) == 0;
+        std::cout << simdLevelName(levels[l]) << " vs scalar, " << checkCount << " flakes x 600 steps: "
+            << (identical ? "identical" : "MISMATCH") << "\n";
+        if (!identical) rc = 1;
+    }
+
+    const size_t count = 1000000;
+    const int steps = 20;
+    for (int l = 0; l < levelCount; ++l) {
+        Snowfall snow;
+        snow.simd = levels[l];
+        initSnowfall(snow, count);
+        double best = 1e30;
+        for (int it = 0; it < iterations; ++it) {
+            const double t0 = nowSeconds();
+            for (int step = 0; step < steps; ++step) updateSnowfall(snow, 0.016f);
+            best = std::min(best, (nowSeconds() - t0) / steps);
+        }
+        std::cout << simdLevelName(levels[l]) << ": " << count << " flakes in " << best * 1000.0 << " ms per update ("
+            << count / (best * 1e9) << " M flakes/ms)\n";
+    }
+    return rc;
+}
+
+// Snow update on the job system with 0..N workers: same streams as the single-threaded update, time per
+// update and what every worker did.
+static int benchJobs(int iterations) {
+    const size_t count = 1000000;
+    const int steps = 20;
+    Snowfall reference;
+    initSnowfall(reference, count);
+    for (int step = 0; step < steps; ++step) updateSnowfall(reference, 0.016f);
+
+    const int maxWorkers = static_cast<int>(std::max(4u, std::thread::hardware_concurrency()));
+    int rc = 0;
+    for (int workers = 0; workers <= maxWorkers; workers = workers ? workers * 2 : 1) {
+        JobSystem jobs;
+        startJobSystem(jobs, workers);
+        double best = 1e30;
+        bool identical = true;
+        for (int it = 0; it < iterations; ++it) {
+            Snowfall snow;
+            initSnowfall(snow, count);
+            jobStats(jobs, true);
+            const double t0 = nowSeconds();
+            for (int step = 0; step < steps; ++step) {
+                JobCounter done;
+                updateSnowfallAsync(snow, 0.016f, jobs, done);
+                waitForJobs(jobs, done);
+            }
+            best = std::min(best, (nowSeconds() - t0) / steps);
+            identical = identical && std::memcmp(snow.y.data(), reference.y.data(), count * sizeof(float)) == 0
+                && std::memcmp(snow.x.data(), reference.x.data(), count * sizeof(float)) == 0;
+        }
+        const std::vector<JobWorkerStats> stats = jobStats(jobs);
+        stopJobSystem(jobs);
+        std::cout << workers << " workers: " << best * 1000.0 << " ms per update of " << count << " flakes"
+            << (identical ? "" : ", MISMATCH") << "\n";
+        for (size_t w = 0; w < stats.size(); ++w)
+            std::cout << "  " << (w == 0 ? "main" : "worker " + std::to_string(w)) << ": " << stats[w].jobs << " jobs, "
+                << stats[w].steals << " steals, " << stats[w].idleMs << " ms idle\n";
+        if (!identical) rc = 1;
+    }
+    return rc;
+}
+
+// Hidden 64x64 window with a current GL 3.3 core context, or nullptr (and a message) without one.
+static GLFWwindow* openBenchContext() {
+    if (!glfwInit()) { std::cerr << "ERROR: GLFW init failed\n"; return nullptr; }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow* win = glfwCreateWindow(64, 64, "bench", nullptr, nullptr);
+    if (!win) { std::cerr << "ERROR: no GL 3.3 context\n"; glfwTerminate(); return nullptr; }
+    glfwMakeContextCurrent(win);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "ERROR: GLAD init failed\n";
+        glfwDestroyWindow(win);
+        glfwTerminate();
+        return nullptr;
+    }
+    std::cout << "GL: " << glGetString(GL_RENDERER) << "\n";
+    return win;
+}
+
+// Transform feedback snow against the CPU reference after a few hundred steps, then time per step of
+// both. Needs a GL 3.3 context; without a GPU, Mesa llvmpipe (LIBGL_ALWAYS_SOFTWARE=1) will do. The GPU
+// may round differently (fused multiply-add), so a flake close to a respawn threshold can respawn a
+// step apart; those are counted, the rest must agree closely.
+static int benchSnowGpu(int iterations) {
+    GLFWwindow* win = openBenchContext();
+    if (!win) return 1;
+
+    const size_t counts[] = { 10000, 1000000 };
+    const int steps = 300;
+    int rc = 0;
+    for (size_t count : counts) {
+        Snowfall cpu, gpu;
+        initSnowfall(cpu, count);
+        initSnowfall(gpu, count);
+        if (!createSnowfallGPU(gpu, "shaders/snow_update.vert", 0, 0, 0, GL_UNSIGNED_SHORT)) { rc = 1; break; }
+        for (int step = 0; step < steps; ++step) {
+            const float dt = 0.01f + 0.001f * (step % 7);
+            updateSnowfall(cpu, dt);
+            updateSnowfallGPU(gpu, dt);
+        }
+        std::vector<float> state;
+        readSnowfallGPU(gpu, state);
+        size_t diverged = 0;
+        float maxError = 0.0f;
+        for (size_t i = 0; i < count; ++i) {
+            const float error = std::max({ std::fabs(state[i * 8] - cpu.x[i]), std::fabs(state[i * 8 + 1] - cpu.y[i]),
+                std::fabs(state[i * 8 + 2] - cpu.z[i]) });
+            if (error > 1e-3f) ++diverged;
+            else maxError = std::max(maxError, error);
+        }
+        const bool ok = diverged * 1000 <= count;
+
+        double cpuMs = 1e30, gpuMs = 1e30;
+        for (int it = 0; it < iterations; ++it) {
+            double t0 = nowSeconds();
+            for (int step = 0; step < 10; ++step) updateSnowfall(cpu, 0.016f);
+            cpuMs = std::min(cpuMs, (nowSeconds() - t0) * 100.0);
+            glFinish();
+            t0 = nowSeconds();
+            for (int step = 0; step < 10; ++step) updateSnowfallGPU(gpu, 0.016f);
+            glFinish();
+            gpuMs = std::min(gpuMs, (nowSeconds() - t0) * 100.0);
+        }
+        std::cout << count << " flakes x " << steps << " steps: max error " << maxError << ", " << diverged
+            << " respawned apart" << (ok ? "" : " (TOO MANY)") << "; CPU " << cpuMs << " ms + upload, GPU "
+            << gpuMs << " ms per step\n";
+        if (!ok) rc = 1;
+        destroySnowfallGL(gpu);
+    }
+    glfwDestroyWindow(win);
+    glfwTerminate();
+    return rc;
+}
+
+// Zeroed Lighting and Fog blocks (bindings 1 and 2, from blocks[1]) and an Object block for model
+// (binding 3, blocks[2]) in the std140 layout of ObjectBlock in FileName.cpp: the mat4, then the normal
+// matrix as three vec4 columns.
+static void bindBenchBlocks(const GLuint blocks[3], const glm::mat4& model) {
+    const std::vector<char> zeros(256, 0);
+    glBindBuffer(GL_UNIFORM_BUFFER, blocks[1]);
+    glBufferData(GL_UNIFORM_BUFFER, zeros.size(), zeros.data(), GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 1, blocks[1]);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 2, blocks[1]);
+    glm::vec4 object[7];
+    const glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(model));
+    for (int c = 0; c < 4; ++c) object[c] = model[c];
+    for (int c = 0; c < 3; ++c) object[4 + c] = glm::vec4(normalMatrix[c], 0.0f);
+    glBindBuffer(GL_UNIFORM_BUFFER, blocks[2]);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(object), object, GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 3, blocks[2]);
+}
+
+// Wireframe overlay cost: each mesh drawn with shader.vert/frag alone, with the second wire.gs pass on
+// top (polygon offset lines), and with the barycentric single pass (wire_bary.gs), best of N frames of
+// 20 draws each into a 1280x720 framebuffer. Needs a GL 3.3 context (llvmpipe will do, see
+// benchSnowGpu) and the shaders/ directory.
+static int benchWire(const std::vector<const char*>& paths, int iterations) {
+    GLFWwindow* win = openBenchContext();
+    if (!win) return 1;
+    const int width = 1280, height = 720;
+    GLuint fbo, color, depth;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    const std::string vs = loadShaderSource("shaders/shader.vert");
+    const std::string fs = loadShaderSource("shaders/shader.frag");
+    const std::string wireGs = loadShaderSource("shaders/wire.gs");
+    const std::string wireFs = loadShaderSource("shaders/wire.frag");
+    const std::string baryGs = loadShaderSource("shaders/wire_bary.gs");
+    ShaderProgram plain, wire, bary;
+    reflectProgram(plain, createProgram(vs.c_str(), fs.c_str()));
+    reflectProgram(wire, createProgramWithGS(vs.c_str(), wireGs.c_str(), wireFs.c_str()));
+    reflectProgram(bary, createProgramWithGS(withDefine(vs, "WIREFRAME_BARYCENTRIC").c_str(), baryGs.c_str(),
+        withDefine(fs, "WIREFRAME_BARYCENTRIC").c_str()));
+    // Camera block at binding 0, an identity model at 3; lighting and fog read zeros (no lights, no fog).
+    GLuint blocks[3];
+    glGenBuffers(3, blocks);
+    bindBenchBlocks(blocks, glm::mat4(1.0f));
+    for (ShaderProgram* program : { &plain, &wire, &bary }) {
+        bindUniformBlock(*program, internUniform("Camera"), 0);
+        bindUniformBlock(*program, internUniform("Lighting"), 1);
+        bindUniformBlock(*program, internUniform("Fog"), 2);
+        bindUniformBlock(*program, internUniform("Object"), 3);
+    }
+
+    int rc = 0;
+    for (const char* path : paths) {
+        ObjLoadOptions options;
+        options.weld = true;
+        options.optimize = true;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        ObjMaterialInfo materials;
+        if (!loadOBJParallel(path, vertices, indices, options, &materials)) { rc = 1; continue; }
+        PackedMesh packed;
+        packMesh(vertices, indices, materials.ranges, true, packed);
+        GLuint vao, vbo, ebo;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        const MeshDraw draw = uploadMesh(packed.view(), vao, vbo, ebo);
+
+        // Whole mesh in view, filling most of the frame.
+        const glm::vec3 center = (packed.boundsMin + packed.boundsMax) * 0.5f;
+        const float radius = glm::length(packed.boundsMax - packed.boundsMin) * 0.5f;
+        float camera[52] = {};
+        const glm::mat4 view = glm::lookAt(center + glm::vec3(0.6f, 0.4f, 1.0f) * (1.6f * radius), center, glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 proj = glm::perspective(glm::radians(45.0f), float(width) / height, 0.01f * radius, 10.0f * radius);
+        std::memcpy(camera, &view[0][0], sizeof(view));
+        std::memcpy(camera + 16, &proj[0][0], sizeof(proj));
+        glBindBuffer(GL_UNIFORM_BUFFER, blocks[0]);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(camera), camera, GL_STATIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, blocks[0]);
+
+        const char* names[] = { "no wireframe", "two-pass", "single-pass" };
+        double best[3] = { 1e30, 1e30, 1e30 };
+        RenderStats stats[3];
+        for (int it = 0; it < iterations + 1; ++it) {      // the first round warms up the drivers' shader caches
+            for (int mode = 0; mode < 3; ++mode) {
+                RenderStats frame;
+                glFinish();
+                const double t0 = nowSeconds();
+                for (int repeat = 0; repeat < 20; ++repeat) {
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    ShaderProgram& lit = mode == 2 ? bary : plain;
+                    glUseProgram(lit.id);
+                    setVertexDecode(lit, &draw);
+                    glBindVertexArray(vao);
+                    drawMesh(draw, &frame);
+                    if (mode == 1) {
+                        glEnable(GL_POLYGON_OFFSET_LINE);
+                        glPolygonOffset(-1.0f, -1.0f);
+                        glUseProgram(wire.id);
+                        setVertexDecode(wire, &draw);
+                        drawMesh(draw, &frame);
+                        glDisable(GL_POLYGON_OFFSET_LINE);
+                    }
+                }
+                glFinish();
+                if (it > 0) best[mode] = std::min(best[mode], (nowSeconds() - t0) * 1000.0 / 20);
+                stats[mode] = frame;
+            }
+        }
+        std::cout << path << ": " << packed.indexCount / 3 << " triangles, " << width << "x" << height << "\n";
+        for (int mode = 0; mode < 3; ++mode)
+            std::cout << "  " << names[mode] << ": " << best[mode] << " ms per frame, " << stats[mode].drawCalls / 20
+                << " draw calls\n";
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
+    }
+    glDeleteBuffers(3, blocks);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+    glfwDestroyWindow(win);
+    glfwTerminate();
+    return rc;
+}
+
+// Normals and tangents. CPU: computeTangents on a JobSystem without workers and on one with a worker
+// per other core (same result required), once keeping the OBJ's normals and once with them cleared so
+// every normal is generated. GPU: the vertex shader with the per-draw normal matrix against the old per-vertex inverse
+// (NORMAL_MATRIX_PER_VERTEX), best of N rounds of 20 draws with rasterization off, so only vertex work
+// is timed; the difference per vertex is the ALU the normal matrix saves. The two alternate which runs
+// first, since on llvmpipe the order alone moves the result by a few ns per vertex. Needs a GL 3.3
+// context (llvmpipe will do, see benchSnowGpu) and the shaders/ directory.
+static int benchNormals(const std::vector<const char*>& paths, int iterations) {
+    JobSystem serial, jobs;
+    startJobSystem(serial, 0);
+    startJobSystem(jobs);
+    const size_t threads = jobStats(jobs).size();
+    int rc = 0;
+    std::vector<std::vector<Vertex>> meshVertices;
+    std::vector<std::vector<unsigned int>> meshIndices;
+    std::vector<const char*> meshPaths;
+    for (const char* path : paths) {
+        ObjLoadOptions options;
+        options.weld = true;
+        options.optimize = true;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        if (!loadOBJParallel(path, vertices, indices, options)) { rc = 1; continue; }
+        std::cout << path << ": " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles\n";
+        for (int clearNormals = 0; clearNormals < 2; ++clearNormals) {
+            std::vector<Vertex> source = vertices;
+            if (clearNormals)
+                for (Vertex& v : source) v.Normal = glm::vec3(0.0f);
+            std::vector<Vertex> single, all;
+            double best[2] = { 1e30, 1e30 };
+            TangentStats stats;
+            for (int it = 0; it < iterations; ++it) {
+                single = source;
+                best[0] = std::min(best[0], computeTangents(single, indices, serial).ms);
+                all = source;
+                stats = computeTangents(all, indices, jobs);
+                best[1] = std::min(best[1], stats.ms);
+            }
+            const bool same = sameMesh(single, indices, all, indices);
+            if (!same) rc = 1;
+            std::cout << "  " << (clearNormals ? "normals generated" : "OBJ normals") << ": 1 thread " << best[0]
+                << " ms, " << threads << " threads " << best[1] << " ms (" << stats.vertices / (best[1] * 1000.0)
+                << " M vertices/s); " << stats.normalsGenerated << " normals generated, " << stats.tangentsMadeUp
+                << " tangents without a mapping, output " << (same ? "identical" : "DIFFERS") << "\n";
+            if (!clearNormals) meshVertices.push_back(all);
+        }
+        meshIndices.push_back(indices);
+        meshPaths.push_back(path);
+    }
+    stopJobSystem(serial);
+    stopJobSystem(jobs);
+
+    GLFWwindow* win = openBenchContext();
+    if (!win) return 1;
+    const std::string vs = loadShaderSource("shaders/shader.vert");
+    const std::string fs = loadShaderSource("shaders/shader.frag");
+    ShaderProgram programs[2];
+    reflectProgram(programs[0], createProgram(withDefine(vs, "NORMAL_MATRIX_PER_VERTEX").c_str(), fs.c_str()));
+    reflectProgram(programs[1], createProgram(vs.c_str(), fs.c_str()));
+    GLuint blocks[3];
+    glGenBuffers(3, blocks);
+    bindBenchBlocks(blocks, glm::rotate(glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 1.0f)), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f)));
+    for (ShaderProgram& program : programs) {
+        bindUniformBlock(program, internUniform("Camera"), 0);
+        bindUniformBlock(program, internUniform("Lighting"), 1);
+        bindUniformBlock(program, internUniform("Fog"), 2);
+        bindUniformBlock(program, internUniform("Object"), 3);
+    }
+
+    for (size_t m = 0; m < meshVertices.size(); ++m) {
+        PackedMesh packed;
+        packMesh(meshVertices[m], meshIndices[m], {}, true, packed);
+        GLuint vao, vbo, ebo;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        const MeshDraw draw = uploadMesh(packed.view(), vao, vbo, ebo);
+
+        const glm::vec3 center = (packed.boundsMin + packed.boundsMax) * 0.5f;
+        const float radius = glm::length(packed.boundsMax - packed.boundsMin);
+        float camera[52] = {};
+        const glm::mat4 view = glm::lookAt(center + glm::vec3(0.6f, 0.4f, 1.0f) * (1.6f * radius), center, glm::vec3(0.0f, 1.0f, 0.0f));
+        const glm::mat4 proj = glm::perspective(glm::radians(45.0f), 1.0f, 0.01f * radius, 10.0f * radius);
+        std::memcpy(camera, &view[0][0], sizeof(view));
+        std::memcpy(camera + 16, &proj[0][0], sizeof(proj));
+        glBindBuffer(GL_UNIFORM_BUFFER, blocks[0]);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(camera), camera, GL_STATIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, 0, blocks[0]);
+
+        double best[2] = { 1e30, 1e30 };
+        glEnable(GL_RASTERIZER_DISCARD);
+        for (int it = 0; it < 2 * iterations + 1; ++it) {  // the first round warms up the drivers' shader caches
+            for (int k = 0; k < 2; ++k) {
+                const int p = (it + k) % 2;
+                glUseProgram(programs[p].id);
+                setVertexDecode(programs[p], &draw);
+                glBindVertexArray(vao);
+                glFinish();
+                const double t0 = nowSeconds();
+                for (int repeat = 0; repeat < 20; ++repeat) drawMesh(draw);
+                glFinish();
+                if (it > 0) best[p] = std::min(best[p], (nowSeconds() - t0) * 1000.0 / 20);
+            }
+        }
+        glDisable(GL_RASTERIZER_DISCARD);
+        std::cout << meshPaths[m] << ": " << packed.vertexCount << " vertices shaded per draw\n"
+            << "  inverse per vertex: " << best[0] << " ms per draw\n"
+            << "  normal matrix per draw: " << best[1] << " ms per draw, "
+            << (best[0] - best[1]) * 1e6 / packed.vertexCount << " ns per vertex saved\n";
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ebo);
+    }
+    glDeleteBuffers(3, blocks);
+    glfwDestroyWindow(win);
+    glfwTerminate();
+    return rc;
+}
+
+// Sort keys of a scene-sized queue: radix sort against std::stable_sort (same order required, since
+// both are stable). Packets mimic the frame in main: a few programs, a few dozen textures and VAOs.
+static int benchQueue(int iterations) {
+    const size_t counts[] = { 1000, 10000, 100000 };
+    ShaderProgram programs[3];
+    for (int i = 0; i < 3; ++i) programs[i].id = 3 + i;
+    int rc = 0;
+    for (size_t count : counts) {
+        RenderQueue queue;
+        uint32_t seed = 12345;
+        const auto next = [&]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+        for (size_t i = 0; i < count; ++i) {
+            DrawPacket p;
+            p.pass = static_cast<RenderPass>(next() % 8 == 0 ? PASS_OVERLAY : PASS_OPAQUE);
+            p.program = &programs[next() % 3];
+            p.vao = 1 + next() % 16;
+            p.textures[0] = 1 + next() % 32;
+            p.textures[1] = 1 + next() % 32;
+            p.depth = static_cast<float>(next() % 10000) * 0.01f;
+            submitDraw(queue, p);
+        }
+        std::vector<SortEntry> keys(count), sorted, scratch;
+        for (size_t i = 0; i < count; ++i) keys[i] = { renderSortKey(queue, queue.packets[i]), static_cast<uint32_t>(i) };
+
+        double radixMs = 1e30, stdMs = 1e30;
+        bool identical = true;
+        for (int it = 0; it < iterations; ++it) {
+            sorted = keys;
+            double t0 = nowSeconds();
+            radixSortKeys(sorted, scratch);
+            radixMs = std::min(radixMs, (nowSeconds() - t0) * 1000.0);
+            std::vector<SortEntry> reference = keys;
+            t0 = nowSeconds();
+            std::stable_sort(reference.begin(), reference.end(),
+                [](const SortEntry& a, const SortEntry& b) { return a.key < b.key; });
+            stdMs = std::min(stdMs, (nowSeconds() - t0) * 1000.0);
+            for (size_t i = 0; i < count; ++i) identical = identical && sorted[i].packet == reference[i].packet;
+        }
+        std::cout << count << " packets: radix " << radixMs << " ms, std::stable_sort " << stdMs << " ms"
+            << (identical ? "" : ", MISMATCH") << "\n";
+        if (!identical) rc = 1;
+    }
+    return rc;
+}
+
+// Frustum culling: random boxes and a million snowflake-sized spheres around the camera of main. Every
+// SIMD level must keep exactly the boxes and spheres the scalar test keeps; time per pass, best of N.
+static int benchCull(int iterations) {
+    const SimdLevel levels[] = { SIMD_SCALAR, SIMD_SSE, SIMD_AVX };
+    const int levelCount = cpuHasAVX() ? 3 : 2;
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 5.0f), glm::vec3(0.0f, 0.0f, -3.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum = extractFrustum(glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f) * view);
+    uint32_t seed = 12345;
+    const auto uniform = [&](float lo, float hi) {
+        seed = seed * 1664525u + 1013904223u;
+        return lo + (hi - lo) * static_cast<float>(seed >> 8) / 16777216.0f;
+    };
+    int rc = 0;
+
+    const size_t boxCounts[] = { 1000, 10000, 100000 };
+    for (size_t count : boxCounts) {
+        CullBoxes boxes;
+        for (size_t i = 0; i < count; ++i) {
+            const glm::vec3 c(uniform(-60.0f, 60.0f), uniform(-20.0f, 20.0f), uniform(-110.0f, 10.0f));
+            const glm::vec3 e(uniform(0.1f, 2.0f), uniform(0.1f, 2.0f), uniform(0.1f, 2.0f));
+            addCullBox(boxes, c - e, c + e);
+        }
+        std::vector<uint8_t> reference, visible;
+        size_t kept = 0;
+        std::cout << count << " boxes:";
+        for (int l = 0; l < levelCount; ++l) {
+            double best = 1e30;
+            for (int it = 0; it < iterations; ++it) {
+                const double t0 = nowSeconds();
+                kept = cullBoxes(boxes, frustum, visible, levels[l]);
+                best = std::min(best, nowSeconds() - t0);
+            }
+            if (l == 0) reference = visible;
+            const bool identical = visible == reference;
+            if (!identical) rc = 1;
+            std::cout << " " << simdLevelName(levels[l]) << " " << best * 1000.0 << " ms" << (identical ? "" : " MISMATCH") << ";";
+        }
+        std::cout << " " << kept << " visible, " << count - kept << " culled\n";
+    }
+
+    const size_t count = 1000000;
+    const float radius = 0.02f * 0.8660254f;
+    AlignedFloats x(count), y(count), z(count), outX(count), outY(count), outZ(count), refX, refZ;
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = uniform(-30.0f, 30.0f);
+        y[i] = uniform(-1.0f, 10.0f);
+        z[i] = uniform(-60.0f, 10.0f);
+    }
+    size_t kept = 0;
+    std::cout << count << " spheres:";
+    for (int l = 0; l < levelCount; ++l) {
+        double best = 1e30;
+        for (int it = 0; it < iterations; ++it) {
+            const double t0 = nowSeconds();
+            kept = cullSpheres(x.data(), y.data(), z.data(), count, radius, frustum, outX.data(), outY.data(), outZ.data(), levels[l]);
+            best = std::min(best, nowSeconds() - t0);
+        }
+        if (l == 0) {
+            refX.assign(outX.begin(), outX.begin() + kept);
+            refZ.assign(outZ.begin(), outZ.begin() + kept);
+        }
+        const bool identical = kept == refX.size() && std::memcmp(outX.data(), refX.data(), kept * sizeof(float)) == 0
+            && std::memcmp(outZ.data(), refZ.data(), kept * sizeof(float)) == 0;
+        if (!identical) rc = 1;
+        std::cout << " " << simdLevelName(levels[l]) << " " << best * 1000.0 << " ms" << (identical ? "" : " MISMATCH") << ";";
+    }
+    std::cout << " " << kept << " visible, " << count - kept << " culled\n";
+    return rc;
+}
+
+// Rolling hills one unit per sample, centred on the origin, for the terrain benchmarks.
+static Heightfield benchHeightfield(int size) {
+    Heightfield field;
+    field.width = field.depth = size;
+    field.spacing = 1.0f;
+    field.origin = glm::vec2(-0.5f * (size - 1));
+    field.heights.resize(static_cast<size_t>(size) * size);
+    for (int z = 0; z < size; ++z) {
+        for (int x = 0; x < size; ++x) {
+            const float wx = field.origin.x + x, wz = field.origin.y + z;
+            float height = 0.0f, amplitude = 40.0f, frequency = 0.005f;
+            for (int octave = 0; octave < 6; ++octave) {
+                height += std::sin(wx * frequency) * std::cos(wz * frequency) * amplitude;
+                amplitude *= 0.5f;
+                frequency *= 2.0f;
+            }
+            field.heights[static_cast<size_t>(z) * size + x] = height;
+        }
+    }
+    return field;
+}
+
+// The fixed flight of the terrain benchmarks at t in [0, 1]: diagonally across the field, weaving side to
+// side, 25 units over the ground and looking slightly down.
+static void benchFlight(const Heightfield& field, float t, glm::vec3& eye, glm::vec3& ahead) {
+    const float extent = 0.4f * (field.width - 1);
+    const glm::vec3 ground(-extent + 2.0f * extent * t, 0.0f, -extent + 2.0f * extent * t + 0.2f * extent * std::sin(t * 12.0f));
+    const int sx = std::min(std::max(static_cast<int>(ground.x - field.origin.x), 0), field.width - 1);
+    const int sz = std::min(std::max(static_cast<int>(ground.z - field.origin.y), 0), field.depth - 1);
+    eye = glm::vec3(ground.x, heightAt(field, sx, sz) + 25.0f, ground.z);
+    ahead = glm::normalize(glm::vec3(1.0f, -0.15f, 1.0f + 2.4f * std::cos(t * 12.0f)));
+}
+
+// Chunked terrain on large heightfields: the camera flies a fixed path low over the hills and every frame
+// culls the quadtree and picks its nodes, as main does. Reports what a frame would submit against the
+// same chunks all drawn at full detail, and the GPU memory it takes: the shared template and the height
+// and normal texture, against a vertex per sample and chunk (skirts included) as full-detail chunks of
+// Vertex take.
+static int benchTerrain(int iterations) {
+    const int sizes[] = { 1025, 4097 };
+    const int frames = 240;
+    for (int size : sizes) {
+        const Heightfield field = benchHeightfield(size);
+        TerrainParams params;
+        params.chunkQuads = 64;
+        params.lodLevels = kMaxTerrainLods;
+        params.lodDistance = 96.0f;
+        Terrain terrain;
+        double t0 = nowSeconds();
+        if (!buildTerrain(field, params, terrain)) return 1;
+        const double buildMs = (nowSeconds() - t0) * 1000.0;
+
+        const glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.5f, 2000.0f);
+        const size_t nodeTriangles = terrain.indices.size() / 3;
+        double selectMs = 1e30;
+        size_t draws = 0, maxDraws = 0, fullDetail = 0;
+        for (int it = 0; it < iterations; ++it) {
+            takeTerrainStats(terrain);
+            draws = maxDraws = fullDetail = 0;
+            double frameMs = 0.0;
+            for (int f = 0; f < frames; ++f) {
+                glm::vec3 eye, ahead;
+                benchFlight(field, static_cast<float>(f) / (frames - 1), eye, ahead);
+                const Frustum frustum = extractFrustum(proj * glm::lookAt(eye, eye + ahead, glm::vec3(0.0f, 1.0f, 0.0f)));
+                const double f0 = nowSeconds();
+                selectTerrainChunks(terrain, frustum, eye);
+                frameMs += nowSeconds() - f0;
+                draws += terrain.selection.size();
+                maxDraws = std::max(maxDraws, terrain.selection.size());
+                for (const TerrainSelection& selected : terrain.selection) fullDetail += nodeTriangles << (2 * selected.level);
+            }
+            selectMs = std::min(selectMs, frameMs * 1000.0 / frames);
+        }
+        const TerrainStats stats = takeTerrainStats(terrain);
+        const size_t chunks = static_cast<size_t>(terrain.chunksX) * terrain.chunksZ;
+        const size_t vertexBytes = terrain.templateVertices.size() * sizeof(GridVertex);
+        const size_t heightBytes = static_cast<size_t>(field.width) * field.depth * 2 * sizeof(uint32_t);
+        const size_t chunkVertexBytes = chunks * terrain.templateVertices.size() * sizeof(Vertex);
+        std::cout << size << "x" << size << ": " << chunks << " chunks of " << params.chunkQuads << " quads, "
+            << terrain.levels << " levels, built in " << buildMs << " ms; per frame " << draws / frames << " draws (max "
+            << maxDraws << "), " << stats.triangles / frames << " triangles vs " << fullDetail / frames
+            << " at full detail and " << chunks * nodeTriangles << " for the whole field; " << selectMs
+            << " ms selecting\n  vertex buffer " << vertexBytes / 1024.0 << " KB, indices "
+            << terrain.indices.size() * sizeof(uint16_t) / 1024.0 << " KB, height and normal texture " << heightBytes / 1048576.0
+            << " MB (vertices per chunk would take " << chunkVertexBytes / 1048576.0 << " MB)\n  nodes per level:";
+        for (int l = 0; l < terrain.levels; ++l) std::cout << " " << stats.levelNodes[l] / stats.frames;
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+// FNV-1a over the bits of the heights and normals, to compare generated fields without keeping them.
+static uint64_t fieldChecksum(const Heightfield& field) {
+    uint64_t hash = 1469598103934665603ull;
+    const auto add = [&hash](const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) hash = (hash ^ p[i]) * 1099511628211ull;
+    };
+    add(field.heights.data(), field.heights.size() * sizeof(float));
+    add(field.normals.data(), field.normals.size() * sizeof(glm::vec3));
+    return hash;
+}
+
+// Procedural heightfields of 1K^2, 4K^2 and 16K^2 samples (6 octaves of simplex fBm, one unit per sample),
+// in samples per second with normals. Every SIMD level first runs on one thread over the first strip of
+// up to 1024 rows, checked bit for bit against scalar; the widest level then generates the whole grid
+// strip by strip on every thread (16K^2 heights and normals at once would not fit in memory). Best of
+// N, one pass for 16K^2.
+static int benchHeightGen(int iterations) {
+    const SimdLevel levels[] = { SIMD_SCALAR, SIMD_SSE, SIMD_AVX };
+    const int levelCount = cpuHasAVX() ? 3 : 2;
+    const int sizes[] = { 1024, 4096, 16384 };
+    const int stripRows = 1024;
+    NoiseParams noise;
+    noise.octaves = 6;
+    noise.frequency = 0.002f;
+    noise.amplitude = 200.0f;
+    JobSystem jobs;
+    startJobSystem(jobs);
+    const size_t threads = jobStats(jobs).size();
+    int rc = 0;
+    for (int size : sizes) {
+        const int passes = size > 4096 ? 1 : iterations;
+        Heightfield field;
+        field.width = size;
+        field.spacing = 1.0f;
+        const auto setStrip = [&field, size](int row, int rows) {
+            field.depth = rows;
+            field.origin = glm::vec2(-0.5f * size, -0.5f * size + row);
+        };
+
+        const int firstRows = std::min(size, stripRows);
+        const double firstSamples = static_cast<double>(size) * firstRows;
+        uint64_t reference = 0;
+        double scalarRate = 0.0;
+        std::cout << size << "x" << size << ", first " << firstRows << " rows on one thread:";
+        for (int l = 0; l < levelCount; ++l) {
+            double best = 1e30;
+            for (int it = 0; it < passes; ++it) {
+                setStrip(0, firstRows);
+                const double t0 = nowSeconds();
+                generateHeightfield(field, noise, levels[l]);
+                best = std::min(best, nowSeconds() - t0);
+            }
+            const uint64_t checksum = fieldChecksum(field);
+            const double rate = firstSamples / best;
+            if (l == 0) {
+                reference = checksum;
+                scalarRate = rate;
+            }
+            const bool identical = checksum == reference;
+            if (!identical) rc = 1;
+            std::cout << " " << simdLevelName(levels[l]) << " " << rate / 1e6 << " M samples/s (x" << rate / scalarRate << ")"
+                << (identical ? "" : " MISMATCH") << ";";
+        }
+        std::cout << "\n";
+
+        const SimdLevel widest = levels[levelCount - 1];
+        double best = 1e30;
+        bool identical = true;
+        for (int it = 0; it < passes; ++it) {
+            double seconds = 0.0;
+            for (int row = 0; row < size; row += stripRows) {
+                setStrip(row, std::min(stripRows, size - row));
+                const double t0 = nowSeconds();
+                generateHeightfield(field, noise, jobs, widest);
+                seconds += nowSeconds() - t0;
+                if (row == 0) identical = identical && fieldChecksum(field) == reference;
+            }
+            best = std::min(best, seconds);
+        }
+        if (!identical) rc = 1;
+        const double rate = static_cast<double>(size) * size / best;
+        std::cout << "  whole grid, " << simdLevelName(widest) << " on " << threads << " threads: " << rate / 1e6
+            << " M samples/s (x" << rate / scalarRate << " scalar), " << best * 1000.0 << " ms" << (identical ? "" : ", MISMATCH") << "\n";
+    }
+    stopJobSystem(jobs);
+    return rc;
+}
+
+// CDLOD node selection over a 4097^2 field along the flight of --bench-terrain, for several view
+// distances (far plane; levels are added until the top range reaches it). Best of N per frame.
+static int benchCdlod(int iterations) {
+    const Heightfield field = benchHeightfield(4097);
+    const float viewDistances[] = { 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f };
+    const int frames = 240;
+    for (float viewDistance : viewDistances) {
+        CdlodParams params;
+        params.patchQuads = 32;
+        params.lodDistance = 2.5f * params.patchQuads;
+        params.levels = 1;
+        while (params.levels < 8 && params.lodDistance * static_cast<float>(1 << (params.levels - 1)) < viewDistance) ++params.levels;
+        CdlodTerrain terrain;
+        const double t0 = nowSeconds();
+        if (!buildCdlodTerrain(field, params, terrain)) return 1;
+        const double buildMs = (nowSeconds() - t0) * 1000.0;
+
+        const glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.5f, viewDistance);
+        double selectMs = 1e30;
+        size_t maxTriangles = 0;
+        unsigned int maxDraws = 0;
+        for (int it = 0; it < iterations; ++it) {
+            takeCdlodStats(terrain);
+            double frameMs = 0.0;
+            for (int f = 0; f < frames; ++f) {
+                glm::vec3 eye, ahead;
+                benchFlight(field, static_cast<float>(f) / (frames - 1), eye, ahead);
+                const Frustum frustum = extractFrustum(proj * glm::lookAt(eye, eye + ahead, glm::vec3(0.0f, 1.0f, 0.0f)));
+                const CdlodStats before = terrain.stats;
+                const double f0 = nowSeconds();
+                selectCdlodNodes(terrain, frustum, eye);
+                frameMs += nowSeconds() - f0;
+                maxTriangles = std::max(maxTriangles, terrain.stats.triangles - before.triangles);
+                maxDraws = std::max(maxDraws, terrain.stats.draws - before.draws);
+            }
+            selectMs = std::min(selectMs, frameMs * 1000.0 / frames);
+        }
+        const CdlodStats stats = takeCdlodStats(terrain);
+        std::cout << "view distance " << viewDistance << " (" << params.levels << " levels, quadtree built in "
+            << buildMs << " ms): per frame " << stats.nodesVisited / frames << " nodes visited, " << stats.nodesSelected / frames
+            << " selected, " << stats.draws / frames << " draws (max " << maxDraws << "), " << stats.triangles / frames
+            << " triangles (max " << maxTriangles << "), " << selectMs << " ms selecting\n  nodes per level:";
+        for (int l = 0; l < params.levels; ++l) std::cout << " " << stats.levelNodes[l] / frames;
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+int runBenchmarks(int argc, char** argv) {
+    std::string mode = argv[1];
+    std::vector<const char*> paths;
+    int iterations = 5;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) iterations = std::atoi(argv[++i]);
+        else paths.push_back(argv[i]);
+    }
+    if (iterations < 1) iterations = 1;
+
+    if (mode == "--bench-obj") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchObj(paths, iterations);
+    }
+    if (mode == "--bench-obj-threads") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchObjThreads(paths, iterations);
+    }
+    if (mode == "--bench-weld") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchWeld(paths, iterations);
+    }
+    if (mode == "--bench-vcache") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchVertexCache(paths);
+    }
+    if (mode == "--bench-pack") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchPack(paths);
+    }
+    if (mode == "--bench-materials") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchMaterials(paths);
+    }
+    if (mode == "--bench-compress") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultTextures), std::end(kDefaultTextures));
+        return benchCompress(paths, iterations);
+    }
+    if (mode == "--bench-snow") return benchSnow(iterations);
+    if (mode == "--bench-particles") return benchParticles(iterations);
+    if (mode == "--bench-jobs") return benchJobs(iterations);
+    if (mode == "--bench-snow-gpu") return benchSnowGpu(iterations);
+    if (mode == "--bench-queue") return benchQueue(iterations);
+    if (mode == "--bench-cull") return benchCull(iterations);
+    if (mode == "--bench-terrain") return benchTerrain(iterations);
+    if (mode == "--bench-cdlod") return benchCdlod(iterations);
+    if (mode == "--bench-heightgen") return benchHeightGen(iterations);
+    if (mode == "--bench-wire") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchWire(paths, iterations);
+    }
+    if (mode == "--bench-normals") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultObjs), std::end(kDefaultObjs));
+        return benchNormals(paths, iterations);
+    }
+    if (mode == "--bench-mips") {
+        if (paths.empty()) paths.assign(std::begin(kDefaultTextures), std::begin(kDefaultTextures) + 2);
+        return benchMips(paths, iterations);
+    }
+    std::cerr << "Unknown option: " << mode << "\n"
+        << "Usage: OpenGlLab --bench-obj | --bench-obj-threads | --bench-weld | --bench-vcache | --bench-pack | --bench-materials | --bench-wire | --bench-normals [-n N] [file.obj ...]\n"
+        << "       OpenGlLab --bench-compress | --bench-mips [-n N] [image ...]\n"
+        << "       OpenGlLab --bench-snow | --bench-particles | --bench-jobs | --bench-snow-gpu | --bench-queue | --bench-cull | --bench-terrain | --bench-cdlod | --bench-heightgen [-n N]\n";
+    return 1;
+}
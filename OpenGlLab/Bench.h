@@ -0,0 +1,5 @@
+#pragma once
+
+// Headless benchmarks, selected by the first command-line argument (e.g. --bench-obj).
+// Returns the process exit code.
+int runBenchmarks(int argc, char** argv);
@@ -0,0 +1,214 @@
+#include "Cdlod.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+bool buildCdlodTerrain(const Heightfield& field, const CdlodParams& params, CdlodTerrain& terrain) {
+    const int quads = params.patchQuads;
+    if (quads < 2 || (quads & (quads - 1)) != 0 || quads > 128) {
+        std::cerr << "ERROR: the CDLOD patch must be a power of two up to 128 quads, not " << quads << "\n";
+        return false;
+    }
+    if (params.levels < 1 || params.levels > kMaxCdlodLevels) {
+        std::cerr << "ERROR: CDLOD needs 1 to " << kMaxCdlodLevels << " levels, not " << params.levels << "\n";
+        return false;
+    }
+    const int rootSamples = quads << (params.levels - 1);
+    if (field.width < 2 || field.depth < 2 || (field.width - 1) % rootSamples != 0 || (field.depth - 1) % rootSamples != 0
+        || field.heights.size() != static_cast<size_t>(field.width) * field.depth) {
+        std::cerr << "ERROR: a " << field.width << "x" << field.depth << " heightfield does not split into CDLOD roots of "
+            << rootSamples << " quads\n";
+        return false;
+    }
+
+    terrain = CdlodTerrain();
+    terrain.params = params;
+    terrain.width = field.width;
+    terrain.depth = field.depth;
+    terrain.spacing = field.spacing;
+    terrain.origin = field.origin;
+    terrain.rootsX = (field.width - 1) / rootSamples;
+    terrain.rootsZ = (field.depth - 1) / rootSamples;
+    for (int level = 0; level < params.levels; ++level) terrain.ranges.push_back(params.lodDistance * static_cast<float>(1 << level));
+
+    // Height ranges: the leaves from the samples they cover (borders included), every level above from
+    // its four children.
+    terrain.heightRanges.resize(params.levels);
+    for (int level = 0; level < params.levels; ++level) {
+        const int nodesX = (field.width - 1) / (quads << level), nodesZ = (field.depth - 1) / (quads << level);
+        std::vector<glm::vec2>& ranges = terrain.heightRanges[level];
+        ranges.resize(static_cast<size_t>(nodesX) * nodesZ);
+        for (int nz = 0; nz < nodesZ; ++nz) {
+            for (int nx = 0; nx < nodesX; ++nx) {
+                glm::vec2& r = ranges[static_cast<size_t>(nz) * nodesX + nx];
+                if (level == 0) {
+                    r = glm::vec2(heightAt(field, nx * quads, nz * quads));
+                    for (int z = nz * quads; z <= (nz + 1) * quads; ++z) {
+                        for (int x = nx * quads; x <= (nx + 1) * quads; ++x) {
+                            const float h = heightAt(field, x, z);
+                            r.x = std::min(r.x, h);
+                            r.y = std::max(r.y, h);
+                        }
+                    }
+                    continue;
+                }
+                const std::vector<glm::vec2>& children = terrain.heightRanges[level - 1];
+                const int childrenX = nodesX * 2;
+                r = children[static_cast<size_t>(nz * 2) * childrenX + nx * 2];
+                for (int q = 1; q < 4; ++q) {
+                    const glm::vec2& c = children[static_cast<size_t>(nz * 2 + (q >> 1)) * childrenX + nx * 2 + (q & 1)];
+                    r.x = std::min(r.x, c.x);
+                    r.y = std::max(r.y, c.y);
+                }
+            }
+        }
+    }
+
+    // Patch grid. Cells are split along the (i, j)-(i + 1, j + 1) diagonal: the morph moves odd vertices
+    // towards -x and -z, and with this diagonal every fine triangle collapses onto a coarse one or to nothing.
+    const int side = quads + 1;
+    for (int i = 0; i < side; ++i) {
+        for (int j = 0; j < side; ++j) {
+            const glm::vec2 grid(static_cast<float>(i) / quads, static_cast<float>(j) / quads);
+            terrain.patchVertices.push_back({ glm::vec3(grid.x, 0.0f, grid.y), glm::vec3(0.0f, 1.0f, 0.0f), grid,
+                glm::vec4(1.0f, 0.0f, 0.0f, -1.0f) });
+        }
+    }
+    const int half = quads / 2;
+    for (int q = 0; q < 4; ++q) {
+        SubMesh& range = terrain.quadrantRanges[q];
+        range = { static_cast<uint32_t>(terrain.patchIndices.size()), 0, 0, static_cast<uint32_t>(side * side), -1 };
+        const int i0 = (q & 1) * half, j0 = (q >> 1) * half;
+        for (int i = i0; i < i0 + half; ++i) {
+            for (int j = j0; j < j0 + half; ++j) {
+                const int base = i * side + j;
+                const int tri[6] = { base, base + side + 1, base + side, base, base + 1, base + side + 1 };
+                for (int v : tri) terrain.patchIndices.push_back(static_cast<uint16_t>(v));
+            }
+        }
+        range.indexCount = static_cast<uint32_t>(terrain.patchIndices.size()) - range.indexOffset;
+    }
+    terrain.wholeRange = { 0, static_cast<uint32_t>(terrain.patchIndices.size()), 0, static_cast<uint32_t>(side * side), -1 };
+    return true;
+}
+
+MeshData cdlodPatchMeshData(const CdlodTerrain& terrain) {
+    MeshData mesh;
+    mesh.format = VERTEX_FORMAT_FLOAT;
+    mesh.vertexData = terrain.patchVertices.data();
+    mesh.vertexCount = terrain.patchVertices.size();
+    mesh.vertexStride = sizeof(Vertex);
+    mesh.indexData = terrain.patchIndices.data();
+    mesh.indexCount = terrain.patchIndices.size();
+    mesh.indexSize = 2;
+    mesh.boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+    return mesh;
+}
+
+GLuint createHeightmapTexture(const Heightfield& field) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, field.width, field.depth, 0, GL_RED, GL_FLOAT, field.heights.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void setCdlodConstants(ShaderProgram& program, const CdlodTerrain& terrain, int heightmapUnit) {
+    static const UniformName heightmap = internUniform("uHeightmap");
+    static const UniformName heightfield = internUniform("uHeightfield");
+    static const UniformName heightmapSize = internUniform("uHeightmapSize");
+    static const UniformName patchQuads = internUniform("uPatchQuads");
+    static const UniformName morphStart = internUniform("uMorphStart");
+    setUniform(program, heightmap, heightmapUnit);
+    setUniform(program, heightfield, glm::vec3(terrain.origin.x, terrain.origin.y, terrain.spacing));
+    setUniform(program, heightmapSize, glm::vec2(static_cast<float>(terrain.width), static_cast<float>(terrain.depth)));
+    setUniform(program, patchQuads, static_cast<float>(terrain.params.patchQuads));
+    // As a fraction of the whole range: the band of a level starts at the previous range, half of its own.
+    setUniform(program, morphStart, 0.5f + 0.5f * terrain.params.morphStart);
+}
+
+// Returns false when the node lies beyond its level's range, so the parent has to cover its area.
+static bool selectNode(CdlodTerrain& terrain, const Frustum& frustum, const glm::vec3& eye, int level, int nx, int nz) {
+    ++terrain.stats.nodesVisited;
+    const int samples = terrain.params.patchQuads << level;
+    const int nodesX = (terrain.width - 1) / samples;
+    const glm::vec2 heights = terrain.heightRanges[level][static_cast<size_t>(nz) * nodesX + nx];
+    const float size = samples * terrain.spacing;
+    const float x = terrain.origin.x + nx * size, z = terrain.origin.y + nz * size;
+    const glm::vec3 boundsMin(x, heights.x, z), boundsMax(x + size, heights.y, z + size);
+    const float distance = boxDistance(boundsMin, boundsMax, eye);
+    if (distance > terrain.ranges[level]) return false;
+    if (!boxInFrustum(frustum, boundsMin, boundsMax)) return true;
+
+    uint8_t quadrants = 15;
+    if (level > 0 && distance <= terrain.ranges[level - 1]) {
+        for (int q = 0; q < 4; ++q)
+            if (selectNode(terrain, frustum, eye, level - 1, nx * 2 + (q & 1), nz * 2 + (q >> 1))) quadrants &= ~(1 << q);
+    }
+    if (quadrants)
+        terrain.selection.push_back({ x, z, size, terrain.ranges[level], distance, static_cast<uint8_t>(level), quadrants });
+    return true;
+}
+
+void selectCdlodNodes(CdlodTerrain& terrain, const Frustum& frustum, const glm::vec3& eye) {
+    const auto begin = std::chrono::steady_clock::now();
+    terrain.selection.clear();
+    const int top = terrain.params.levels - 1;
+    for (int rz = 0; rz < terrain.rootsZ; ++rz)
+        for (int rx = 0; rx < terrain.rootsX; ++rx) selectNode(terrain, frustum, eye, top, rx, rz);
+
+    CdlodStats& stats = terrain.stats;
+    ++stats.frames;
+    stats.nodesSelected += static_cast<unsigned int>(terrain.selection.size());
+    for (const CdlodNode& node : terrain.selection) {
+        ++stats.levelNodes[node.level];
+        if (node.quadrants == 15) {
+            ++stats.draws;
+            stats.triangles += terrain.wholeRange.indexCount / 3;
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) {
+            if (!(node.quadrants & (1 << q))) continue;
+            ++stats.draws;
+            stats.triangles += terrain.quadrantRanges[q].indexCount / 3;
+        }
+    }
+    stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void submitCdlodTerrain(RenderQueue& queue, const DrawPacket& packet, const CdlodTerrain& terrain, const MeshDraw& patch) {
+    static const UniformName nodeName = internUniform("uCdlodNode");
+    static const UniformName rangeName = internUniform("uCdlodRange");
+    DrawPacket p = packet;
+    p.decode = &patch;
+    p.indexType = patch.indexType;
+    for (const CdlodNode& node : terrain.selection) {
+        queueUniform(queue, nodeName, glm::vec3(node.x, node.z, node.size));
+        queueUniform(queue, rangeName, node.range);
+        p.materialUniforms = takeUniformSet(queue);
+        p.depth = node.distance;
+        if (node.quadrants == 15) {
+            p.range = terrain.wholeRange;
+            submitDraw(queue, p);
+            continue;
+        }
+        for (int q = 0; q < 4; ++q) {
+            if (!(node.quadrants & (1 << q))) continue;
+            p.range = terrain.quadrantRanges[q];
+            submitDraw(queue, p);
+        }
+    }
+}
+
+CdlodStats takeCdlodStats(CdlodTerrain& terrain) {
+    CdlodStats stats = terrain.stats;
+    terrain.stats = CdlodStats();
+    return stats;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Culling.h"
+#include "MeshPacking.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "Terrain.h"
+#include <cstdint>
+#include <vector>
+
+const int kMaxCdlodLevels = 12;
+
+struct CdlodParams {
+    int patchQuads = 32;                // quads along the patch edge (a power of two up to 128); a leaf spans as many samples
+    int levels = 6;                     // nodes of level l span patchQuads << l samples; level 0 are the leaves
+    float lodDistance = 80.0f;          // range of level 0; level l reaches lodDistance * 2^l, the last level is the
+                                        // view distance. At least 2.5 leaf edges, or a coarse node next to a finer
+                                        // one can already be morphing where they meet (a crack)
+    float morphStart = 0.7f;            // where in its own band (from the previous level's range to its range) a
+                                        // level's vertices start moving onto the next level's grid
+};
+
+// A node picked for this frame, drawn with the patch scaled onto it.
+struct CdlodNode {
+    float x, z, size;                   // terrain-space corner and edge
+    float range;                        // end of the node's level range: fully morphed there
+    float distance;                     // eye to the node's box
+    uint8_t level;
+    uint8_t quadrants;                  // bit q covers the quadrant q & 1 along x, q >> 1 along z; 15 = whole node
+};
+
+struct CdlodStats {
+    unsigned int frames = 0;
+    unsigned int nodesVisited = 0;
+    unsigned int nodesSelected = 0;
+    unsigned int draws = 0;             // one per selected node, or one per quadrant of partly covered ones
+    size_t triangles = 0;
+    unsigned int levelNodes[kMaxCdlodLevels] = {};
+    double ms = 0.0;
+};
+
+// Continuous distance-based LOD (CDLOD) over a heightfield texture: a quadtree of nodes with the height
+// range of every node, one grid patch mesh scaled onto each selected node, and shader.vert (built with
+// TERRAIN_CDLOD) sampling the heights and morphing every vertex onto the next level's grid as it nears
+// the end of its level's range, so levels blend instead of popping. Nothing but the height texture and
+// a small patch depends on the size of the world.
+struct CdlodTerrain {
+    CdlodParams params;
+    int width = 0, depth = 0;
+    float spacing = 1.0f;
+    glm::vec2 origin = glm::vec2(0.0f);
+    int rootsX = 0, rootsZ = 0;
+    std::vector<float> ranges;                          // per level
+    std::vector<std::vector<glm::vec2>> heightRanges;   // per level, per node row by row: min and max height
+
+    // The patch: (patchQuads + 1)^2 vertices on [0, 1]^2 in x and z, quadrants drawn as separate ranges.
+    std::vector<Vertex> patchVertices;
+    std::vector<uint16_t> patchIndices;
+    SubMesh quadrantRanges[4];
+    SubMesh wholeRange;
+
+    // per frame
+    std::vector<CdlodNode> selection;
+    CdlodStats stats;
+};
+
+// The heightfield must be (patchQuads << (levels - 1)) * n + 1 samples along each axis. Prints the reason
+// and returns false otherwise.
+bool buildCdlodTerrain(const Heightfield& field, const CdlodParams& params, CdlodTerrain& terrain);
+MeshData cdlodPatchMeshData(const CdlodTerrain& terrain);
+// R32F texture of the heights, linearly filtered (the morph samples between texels).
+GLuint createHeightmapTexture(const Heightfield& field);
+// Per-terrain uniforms of a TERRAIN_CDLOD program; the program must be current.
+void setCdlodConstants(ShaderProgram& program, const CdlodTerrain& terrain, int heightmapUnit);
+
+// Walks the quadtree into terrain.selection. frustum and eye are in terrain space.
+void selectCdlodNodes(CdlodTerrain& terrain, const Frustum& frustum, const glm::vec3& eye);
+// One packet per selected node (per quadrant for partly covered nodes) with the node's uniforms as the
+// material set; patch is the mesh uploaded from cdlodPatchMeshData.
+void submitCdlodTerrain(RenderQueue& queue, const DrawPacket& packet, const CdlodTerrain& terrain, const MeshDraw& patch);
+
+// Returns and clears the counters.
+CdlodStats takeCdlodStats(CdlodTerrain& terrain);
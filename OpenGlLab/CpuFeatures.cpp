@@ -0,0 +1,36 @@
+#include "CpuFeatures.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+bool cpuHasAVX() {
+#ifdef SIMD_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+    return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+#else
+    return false;
+#endif
+}
+
+SimdLevel bestSimdLevel() {
+#ifdef SIMD_X86
+    static const SimdLevel level = cpuHasAVX() ? SIMD_AVX : SIMD_SSE;
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SIMD_AVX: return "AVX";
+    case SIMD_SSE: return "SSE";
+    default: return "scalar";
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+// x86 SIMD paths are compiled into every build; AVX functions carry TARGET_AVX and are only called
+// when cpuHasAVX() says the CPU and OS support them.
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define SIMD_X86 1
+#ifdef _MSC_VER
+#define TARGET_AVX
+#else
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE = 1,
+    SIMD_AVX = 2
+};
+
+bool cpuHasAVX();
+SimdLevel bestSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// std::vector allocator for SIMD streams (32 bytes = one AVX register; 64 = a cache line).
+template <typename T, size_t Alignment = 32>
+struct AlignedAllocator {
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(Alignment)); }
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
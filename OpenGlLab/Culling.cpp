@@ -0,0 +1,253 @@
+#include "Culling.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+Frustum extractFrustum(const glm::mat4& viewProj) {
+    // Row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]); each plane is row 3 +- row 0..2.
+    const glm::mat4& m = viewProj;
+    Frustum f;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int side = 0; side < 2; ++side) {
+            const float sign = side == 0 ? 1.0f : -1.0f;
+            glm::vec4 p(m[0][3] + sign * m[0][axis], m[1][3] + sign * m[1][axis],
+                m[2][3] + sign * m[2][axis], m[3][3] + sign * m[3][axis]);
+            const float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+            if (length > 0.0f) p = p * (1.0f / length);
+            f.planes[axis * 2 + side] = p;
+        }
+    }
+    return f;
+}
+
+void clearCullBoxes(CullBoxes& boxes) {
+    boxes.cx.clear(); boxes.cy.clear(); boxes.cz.clear();
+    boxes.ex.clear(); boxes.ey.clear(); boxes.ez.clear();
+    boxes.count = 0;
+}
+
+size_t addCullBox(CullBoxes& boxes, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    const size_t index = boxes.count++;
+    const size_t padded = (boxes.count + 7) & ~size_t(7);
+    if (boxes.cx.size() < padded) {
+        for (auto* stream : { &boxes.cx, &boxes.cy, &boxes.cz, &boxes.ex, &boxes.ey, &boxes.ez })
+            stream->resize(padded, 0.0f);
+    }
+    const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    const glm::vec3 extent = (boundsMax - boundsMin) * 0.5f;
+    boxes.cx[index] = center.x; boxes.cy[index] = center.y; boxes.cz[index] = center.z;
+    boxes.ex[index] = extent.x; boxes.ey[index] = extent.y; boxes.ez[index] = extent.z;
+    return index;
+}
+
+void transformBounds(const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax,
+    glm::vec3& worldMin, glm::vec3& worldMax) {
+    // Arvo: per axis, the extremes of the sum are the extremes of each column term.
+    for (int row = 0; row < 3; ++row) {
+        float lo = m[3][row], hi = m[3][row];
+        for (int col = 0; col < 3; ++col) {
+            const float a = m[col][row] * localMin[col];
+            const float b = m[col][row] * localMax[col];
+            lo += std::fmin(a, b);
+            hi += std::fmax(a, b);
+        }
+        worldMin[row] = lo;
+        worldMax[row] = hi;
+    }
+}
+
+// Scalar, SSE and AVX evaluate the same expressions in the same order, so they agree bit for bit.
+static bool boxOutsidePlane(const glm::vec4& p, float cx, float cy, float cz, float ex, float ey, float ez) {
+    const float d = p.x * cx + p.y * cy + p.z * cz + p.w;
+    const float r = std::fabs(p.x) * ex + std::fabs(p.y) * ey + std::fabs(p.z) * ez;
+    return d + r < 0.0f;
+}
+
+static void cullBoxesScalar(const CullBoxes& b, const Frustum& f, size_t begin, size_t end, uint8_t* visible) {
+    for (size_t i = begin; i < end; ++i) {
+        bool inside = true;
+        for (const glm::vec4& p : f.planes)
+            inside = inside && !boxOutsidePlane(p, b.cx[i], b.cy[i], b.cz[i], b.ex[i], b.ey[i], b.ez[i]);
+        visible[i] = inside ? 1 : 0;
+    }
+}
+
+bool boxInFrustum(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    const glm::vec3 c = (boundsMin + boundsMax) * 0.5f, e = (boundsMax - boundsMin) * 0.5f;
+    for (const glm::vec4& p : frustum.planes)
+        if (boxOutsidePlane(p, c.x, c.y, c.z, e.x, e.y, e.z)) return false;
+    return true;
+}
+
+float boxDistance(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& point) {
+    const float dx = std::max(std::max(boundsMin.x - point.x, point.x - boundsMax.x), 0.0f);
+    const float dy = std::max(std::max(boundsMin.y - point.y, point.y - boundsMax.y), 0.0f);
+    const float dz = std::max(std::max(boundsMin.z - point.z, point.z - boundsMax.z), 0.0f);
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+static bool sphereOutsidePlane(const glm::vec4& p, float x, float y, float z, float negRadius) {
+    return p.x * x + p.y * y + p.z * z + p.w < negRadius;
+}
+
+static size_t cullSpheresScalar(const float* x, const float* y, const float* z, size_t begin, size_t end,
+    float radius, const Frustum& f, float* outX, float* outY, float* outZ, size_t n) {
+    for (size_t i = begin; i < end; ++i) {
+        bool inside = true;
+        for (const glm::vec4& p : f.planes) inside = inside && !sphereOutsidePlane(p, x[i], y[i], z[i], -radius);
+        if (inside) {
+            outX[n] = x[i]; outY[n] = y[i]; outZ[n] = z[i];
+            ++n;
+        }
+    }
+    return n;
+}
+
+static void compactMask(const float* x, const float* y, const float* z, size_t base, int mask,
+    float* outX, float* outY, float* outZ, size_t& n) {
+    for (int k = 0; mask; ++k, mask >>= 1) {
+        if (mask & 1) {
+            outX[n] = x[base + k]; outY[n] = y[base + k]; outZ[n] = z[base + k];
+            ++n;
+        }
+    }
+}
+
+#ifdef SIMD_X86
+static void cullBoxesSSE(const CullBoxes& b, const Frustum& f, size_t end, uint8_t* visible) {
+    const __m128 signMask = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps();
+    for (size_t i = 0; i < end; i += 4) {
+        const __m128 cx = _mm_load_ps(&b.cx[i]), cy = _mm_load_ps(&b.cy[i]), cz = _mm_load_ps(&b.cz[i]);
+        const __m128 ex = _mm_load_ps(&b.ex[i]), ey = _mm_load_ps(&b.ey[i]), ez = _mm_load_ps(&b.ez[i]);
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& p : f.planes) {
+            const __m128 px = _mm_set1_ps(p.x), py = _mm_set1_ps(p.y), pz = _mm_set1_ps(p.z);
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+                _mm_mul_ps(pz, cz)), _mm_set1_ps(p.w));
+            const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), ex),
+                _mm_mul_ps(_mm_andnot_ps(signMask, py), ey)), _mm_mul_ps(_mm_andnot_ps(signMask, pz), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        }
+        const int mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; ++k) visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+    }
+}
+
+TARGET_AVX static void cullBoxesAVX(const CullBoxes& b, const Frustum& f, size_t end, uint8_t* visible) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < end; i += 8) {
+        const __m256 cx = _mm256_load_ps(&b.cx[i]), cy = _mm256_load_ps(&b.cy[i]), cz = _mm256_load_ps(&b.cz[i]);
+        const __m256 ex = _mm256_load_ps(&b.ex[i]), ey = _mm256_load_ps(&b.ey[i]), ez = _mm256_load_ps(&b.ez[i]);
+        __m256 outside = _mm256_setzero_ps();
+        for (const glm::vec4& p : f.planes) {
+            const __m256 px = _mm256_set1_ps(p.x), py = _mm256_set1_ps(p.y), pz = _mm256_set1_ps(p.z);
+            const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, cx), _mm256_mul_ps(py, cy)),
+                _mm256_mul_ps(pz, cz)), _mm256_set1_ps(p.w));
+            const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, px), ex),
+                _mm256_mul_ps(_mm256_andnot_ps(signMask, py), ey)), _mm256_mul_ps(_mm256_andnot_ps(signMask, pz), ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+        }
+        const int mask = _mm256_movemask_ps(outside);
+        for (int k = 0; k < 8; ++k) visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+    }
+}
+
+static size_t cullSpheresSSE(const float* x, const float* y, const float* z, size_t end, float radius,
+    const Frustum& f, float* outX, float* outY, float* outZ) {
+    const __m128 negRadius = _mm_set1_ps(-radius);
+    size_t n = 0;
+    for (size_t i = 0; i < end; i += 4) {
+        const __m128 px4 = _mm_loadu_ps(x + i), py4 = _mm_loadu_ps(y + i), pz4 = _mm_loadu_ps(z + i);
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& p : f.planes) {
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), px4),
+                _mm_mul_ps(_mm_set1_ps(p.y), py4)), _mm_mul_ps(_mm_set1_ps(p.z), pz4)), _mm_set1_ps(p.w));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negRadius));
+        }
+        const int visible = ~_mm_movemask_ps(outside) & 0xf;
+        if (visible == 0xf) {
+            _mm_storeu_ps(outX + n, px4); _mm_storeu_ps(outY + n, py4); _mm_storeu_ps(outZ + n, pz4);
+            n += 4;
+        }
+        else {
+            compactMask(x, y, z, i, visible, outX, outY, outZ, n);
+        }
+    }
+    return n;
+}
+
+TARGET_AVX static size_t cullSpheresAVX(const float* x, const float* y, const float* z, size_t end, float radius,
+    const Frustum& f, float* outX, float* outY, float* outZ) {
+    const __m256 negRadius = _mm256_set1_ps(-radius);
+    size_t n = 0;
+    for (size_t i = 0; i < end; i += 8) {
+        const __m256 px8 = _mm256_loadu_ps(x + i), py8 = _mm256_loadu_ps(y + i), pz8 = _mm256_loadu_ps(z + i);
+        __m256 outside = _mm256_setzero_ps();
+        for (const glm::vec4& p : f.planes) {
+            const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), px8),
+                _mm256_mul_ps(_mm256_set1_ps(p.y), py8)), _mm256_mul_ps(_mm256_set1_ps(p.z), pz8)), _mm256_set1_ps(p.w));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, negRadius, _CMP_LT_OQ));
+        }
+        const int visible = ~_mm256_movemask_ps(outside) & 0xff;
+        if (visible == 0xff) {
+            _mm256_storeu_ps(outX + n, px8); _mm256_storeu_ps(outY + n, py8); _mm256_storeu_ps(outZ + n, pz8);
+            n += 8;
+        }
+        else {
+            compactMask(x, y, z, i, visible, outX, outY, outZ, n);
+        }
+    }
+    return n;
+}
+#endif
+
+size_t cullBoxes(const CullBoxes& boxes, const Frustum& frustum, std::vector<uint8_t>& visible, SimdLevel simd,
+    CullStats* stats) {
+    const auto begin = std::chrono::steady_clock::now();
+    // Room for the padding, which the SIMD paths test along with the rest.
+    visible.resize(boxes.cx.size());
+#ifdef SIMD_X86
+    if (simd == SIMD_AVX && cpuHasAVX()) cullBoxesAVX(boxes, frustum, boxes.cx.size(), visible.data());
+    else if (simd != SIMD_SCALAR) cullBoxesSSE(boxes, frustum, boxes.cx.size(), visible.data());
+    else cullBoxesScalar(boxes, frustum, 0, boxes.count, visible.data());
+#else
+    cullBoxesScalar(boxes, frustum, 0, boxes.count, visible.data());
+#endif
+    visible.resize(boxes.count);
+    size_t count = 0;
+    for (uint8_t v : visible) count += v;
+    if (stats) {
+        stats->tested += static_cast<unsigned int>(boxes.count);
+        stats->visible += static_cast<unsigned int>(count);
+        stats->ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+    return count;
+}
+
+size_t cullSpheres(const float* x, const float* y, const float* z, size_t count, float radius,
+    const Frustum& frustum, float* outX, float* outY, float* outZ, SimdLevel simd, CullStats* stats) {
+    const auto begin = std::chrono::steady_clock::now();
+    size_t n = 0, done = 0;
+#ifdef SIMD_X86
+    // Whole registers only; the tail goes through the scalar loop, which keeps the order.
+    if (simd == SIMD_AVX && cpuHasAVX()) {
+        done = count & ~size_t(7);
+        n = cullSpheresAVX(x, y, z, done, radius, frustum, outX, outY, outZ);
+    }
+    else if (simd != SIMD_SCALAR) {
+        done = count & ~size_t(3);
+        n = cullSpheresSSE(x, y, z, done, radius, frustum, outX, outY, outZ);
+    }
+#endif
+    n = cullSpheresScalar(x, y, z, done, count, radius, frustum, outX, outY, outZ, n);
+    if (stats) {
+        stats->tested += static_cast<unsigned int>(count);
+        stats->visible += static_cast<unsigned int>(n);
+        stats->ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+    return n;
+}
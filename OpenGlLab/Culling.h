@@ -0,0 +1,53 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "CpuFeatures.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Planes (a, b, c, d) of a view frustum, normals pointing inwards and normalized: a point is on the
+// inside of a plane when a*x + b*y + c*z + d >= 0. Order: left, right, bottom, top, near, far.
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// From a GL projection * view matrix (clip space -w..w on every axis).
+Frustum extractFrustum(const glm::mat4& viewProj);
+
+// World-space boxes as center/half-extent streams, padded with empty boxes to a multiple of 8 so the
+// SIMD tests run on whole registers.
+struct CullBoxes {
+    std::vector<float, AlignedAllocator<float>> cx, cy, cz, ex, ey, ez;
+    size_t count = 0;
+};
+
+void clearCullBoxes(CullBoxes& boxes);
+// Returns the index of the box, in the order added.
+size_t addCullBox(CullBoxes& boxes, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+// The world-space box around a local box under an affine transform.
+void transformBounds(const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax,
+    glm::vec3& worldMin, glm::vec3& worldMax);
+
+struct CullStats {
+    unsigned int tested = 0;
+    unsigned int visible = 0;
+    double ms = 0.0;
+};
+
+// visible[i] = 1 when box i is inside or crosses the frustum, 0 when it is wholly outside one plane
+// (conservative: a box near a frustum corner may be kept). 8 boxes per step with AVX, 4 with SSE.
+// Returns the number of visible boxes; every SimdLevel gives the same flags.
+size_t cullBoxes(const CullBoxes& boxes, const Frustum& frustum, std::vector<uint8_t>& visible,
+    SimdLevel simd = bestSimdLevel(), CullStats* stats = nullptr);
+
+// The same test for one box, for hierarchies that descend only into visible nodes.
+bool boxInFrustum(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+// Distance from a point to the nearest point of the box; 0 inside it. Level-of-detail ranges are
+// measured with it, so a node is refined as soon as any part of it comes close.
+float boxDistance(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& point);
+
+// Spheres of one radius at (x[i], y[i], z[i]), i < count: copies the centers of the visible ones, in
+// order, to outX/outY/outZ (room for count each) and returns how many there are.
+size_t cullSpheres(const float* x, const float* y, const float* z, size_t count, float radius,
+    const Frustum& frustum, float* outX, float* outY, float* outZ, SimdLevel simd = bestSimdLevel(),
+    CullStats* stats = nullptr);
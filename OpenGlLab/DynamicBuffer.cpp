@@ -0,0 +1,129 @@
+#include "DynamicBuffer.h"
+#include <chrono>
+#include <iostream>
+
+size_t alignBufferOffset(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+double advanceFencedRegion(FencedRegions& ring) {
+    // Every draw that read the current region has been issued by now.
+    if (ring.region >= 0) ring.fences[ring.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring.region = (ring.region + 1) % FencedRegions::kRegions;
+    GLsync& fence = ring.fences[ring.region];
+    if (!fence) return 0.0;
+    const auto waitBegin = std::chrono::steady_clock::now();
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(fence);
+    fence = nullptr;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitBegin).count();
+}
+
+void deleteFences(FencedRegions& ring) {
+    for (GLsync& fence : ring.fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    ring.region = -1;
+}
+
+bool initDynamicBuffer(DynamicBuffer& dynamic, size_t frameBytes, bool persistent) {
+    shutdownDynamicBuffer(dynamic);
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0) dynamic.uniformAlignment = static_cast<size_t>(alignment);
+    // Regions start on the coarsest alignment an allocation may ask for.
+    dynamic.regionSize = alignBufferOffset(frameBytes, dynamic.uniformAlignment);
+
+    glGenBuffers(1, &dynamic.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, dynamic.buffer);
+    if (persistent && GLAD_GL_VERSION_4_4) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = static_cast<GLsizeiptr>(dynamic.regionSize * FencedRegions::kRegions);
+        glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        dynamic.persistentMemory = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (dynamic.persistentMemory) {
+            dynamic.path = DYNAMIC_BUFFER_PERSISTENT;
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return true;
+        }
+        // Immutable storage cannot be respecified for the fallback; start over with a new name.
+        glDeleteBuffers(1, &dynamic.buffer);
+        glGenBuffers(1, &dynamic.buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, dynamic.buffer);
+    }
+    dynamic.path = DYNAMIC_BUFFER_ORPHAN;
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(dynamic.regionSize), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!dynamic.buffer) {
+        std::cerr << "ERROR: could not create the dynamic buffer\n";
+        return false;
+    }
+    dynamic.staging.resize(dynamic.regionSize);
+    return true;
+}
+
+void shutdownDynamicBuffer(DynamicBuffer& dynamic) {
+    deleteFences(dynamic.regions);
+    if (dynamic.persistentMemory) {
+        glBindBuffer(GL_ARRAY_BUFFER, dynamic.buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if (dynamic.buffer) glDeleteBuffers(1, &dynamic.buffer);
+    dynamic = DynamicBuffer();
+}
+
+const char* dynamicBufferPathName(DynamicBufferPath path) {
+    switch (path) {
+    case DYNAMIC_BUFFER_PERSISTENT: return "persistent mapping";
+    default: return "glBufferSubData (orphaning)";
+    }
+}
+
+void beginDynamicFrame(DynamicBuffer& dynamic) {
+    dynamic.used = 0;
+    dynamic.frameMemory = nullptr;
+    if (!dynamic.buffer) return;
+    ++dynamic.stats.frames;
+    if (dynamic.path == DYNAMIC_BUFFER_ORPHAN) {
+        dynamic.regions.region = 0;
+        dynamic.frameMemory = dynamic.staging.data();
+        return;
+    }
+
+    dynamic.stats.waitMs += advanceFencedRegion(dynamic.regions);
+    dynamic.frameMemory = dynamic.persistentMemory + dynamic.regions.region * dynamic.regionSize;
+}
+
+DynamicAllocation allocDynamic(DynamicBuffer& dynamic, size_t bytes, size_t alignment) {
+    DynamicAllocation a;
+    const size_t offset = alignBufferOffset(dynamic.used, alignment);
+    if (!dynamic.frameMemory || offset + bytes > dynamic.regionSize) {
+        ++dynamic.stats.failed;
+        return a;
+    }
+    dynamic.used = offset + bytes;
+    a.data = dynamic.frameMemory + offset;
+    a.buffer = dynamic.buffer;
+    a.offset = dynamic.regions.region * dynamic.regionSize + offset;
+    a.size = bytes;
+    ++dynamic.stats.allocations;
+    dynamic.stats.bytes += bytes;
+    return a;
+}
+
+void endDynamicFrame(DynamicBuffer& dynamic) {
+    if (dynamic.path != DYNAMIC_BUFFER_ORPHAN || dynamic.used == 0) return;
+    // Orphaning hands the storage last frame's draws read to the driver, so the copy never waits.
+    glBindBuffer(GL_ARRAY_BUFFER, dynamic.buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(dynamic.regionSize), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(dynamic.used), dynamic.staging.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+DynamicBufferStats takeDynamicBufferStats(DynamicBuffer& dynamic) {
+    DynamicBufferStats stats = dynamic.stats;
+    dynamic.stats = DynamicBufferStats();
+    return stats;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Regions of a buffer used round-robin, one per frame in flight: a region gets a fence when the ring
+// moves past it and is rewritten only once that fence has signalled. DynamicBuffer and UniformRing
+// (UniformBuffer.h) both sit on it.
+struct FencedRegions {
+    static const int kRegions = 3;
+    GLsync fences[kRegions] = {};
+    int region = -1;                // current region; -1 before the first
+};
+
+// Fences the current region, moves to the next one and waits for its fence; returns the ms blocked.
+double advanceFencedRegion(FencedRegions& ring);
+void deleteFences(FencedRegions& ring);
+// value rounded up to a multiple of alignment.
+size_t alignBufferOffset(size_t value, size_t alignment);
+
+enum DynamicBufferPath {
+    DYNAMIC_BUFFER_PERSISTENT,      // one persistently mapped buffer split into fenced frame regions (GL 4.4)
+    DYNAMIC_BUFFER_ORPHAN           // CPU staging, orphaned with glBufferData and filled with glBufferSubData
+};
+
+// Bytes handed out for this frame: write them through data before endDynamicFrame, then draw from
+// buffer at offset (as vertex attributes or with glBindBufferRange). data is null when the frame is full.
+struct DynamicAllocation {
+    void* data = nullptr;
+    GLuint buffer = 0;
+    size_t offset = 0, size = 0;
+};
+
+struct DynamicBufferStats {
+    unsigned int frames = 0;
+    unsigned int allocations = 0;
+    unsigned int failed = 0;        // allocations that did not fit the frame
+    size_t bytes = 0;               // handed out (and streamed to the GPU)
+    double waitMs = 0.0;            // blocked on a region the GPU was still reading
+};
+
+// Per-frame dynamic data (per-object uniform blocks, instance streams): bump allocation out of one
+// buffer, with a region per frame in flight. On the persistent path allocations point straight into
+// the mapped memory of the frame's fenced region; GL 3.3 contexts stage the frame in memory and upload
+// it in one glBufferSubData after orphaning the buffer.
+// Frame protocol: beginDynamicFrame, allocDynamic and fill, endDynamicFrame, then the draws.
+struct DynamicBuffer {
+    DynamicBufferPath path = DYNAMIC_BUFFER_ORPHAN;
+    GLuint buffer = 0;
+    size_t regionSize = 0;
+    size_t uniformAlignment = 256;  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, for allocations bound as blocks
+    unsigned char* persistentMemory = nullptr;
+    FencedRegions regions;          // region of the current frame; always 0 on the orphaning path
+
+    // current frame
+    unsigned char* frameMemory = nullptr;
+    size_t used = 0;
+    std::vector<unsigned char> staging;
+    DynamicBufferStats stats;
+};
+
+// frameBytes: the most a frame allocates, alignment padding included.
+bool initDynamicBuffer(DynamicBuffer& dynamic, size_t frameBytes, bool persistent = true);
+void shutdownDynamicBuffer(DynamicBuffer& dynamic);
+const char* dynamicBufferPathName(DynamicBufferPath path);
+
+void beginDynamicFrame(DynamicBuffer& dynamic);
+// alignment must be a power of two; use dynamic.uniformAlignment for uniform blocks.
+DynamicAllocation allocDynamic(DynamicBuffer& dynamic, size_t bytes, size_t alignment = 16);
+void endDynamicFrame(DynamicBuffer& dynamic);
+
+// Returns and clears the counters.
+DynamicBufferStats takeDynamicBufferStats(DynamicBuffer& dynamic);
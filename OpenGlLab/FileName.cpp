@@ -6,222 +6,31 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <iostream>
 #include <vector>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <tuple> 
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h" 
-
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
-};
-
-std::tuple<int, int, int> parseFace(const std::string& face) {
-    int vi = -1, ti = -1, ni = -1;
-    size_t slash1 = face.find('/');
-    size_t slash2 = (slash1 != std::string::npos) ? face.find('/', slash1 + 1) : std::string::npos;
-
-    std::string viStr = face.substr(0, slash1 != std::string::npos ? slash1 : face.size());
-    if (!viStr.empty()) {
-        try { vi = std::stoi(viStr) - 1; }
-        catch (...) {}
-    }
-    if (slash1 != std::string::npos) {
-        size_t tiStart = slash1 + 1;
-        size_t tiEnd = (slash2 != std::string::npos) ? slash2 : face.size();
-        if (tiStart < tiEnd) {
-            std::string tiStr = face.substr(tiStart, tiEnd - tiStart);
-            if (!tiStr.empty()) {
-                try { ti = std::stoi(tiStr) - 1; }
-                catch (...) {}
-            }
-        }
-    }
-    if (slash2 != std::string::npos) {
-        std::string niStr = face.substr(slash2 + 1);
-        if (!niStr.empty()) {
-            try { ni = std::stoi(niStr) - 1; }
-            catch (...) {}
-        }
-    }
-    return { vi, ti, ni };
-}
-
-bool loadOBJ(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
-    std::vector<glm::vec3> temp_vertices;
-    std::vector<glm::vec2> temp_texCoords;
-    std::vector<glm::vec3> temp_normals;
-    std::vector<std::string> lines;
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "ERROR: Could not open OBJ file: " << path << std::endl;
-        return false;
-    }
-    std::string line;
-    while (std::getline(file, line)) {
-        lines.push_back(line);
-    }
-    file.close();
-    for (const auto& l : lines) {
-        std::istringstream iss(l);
-        std::string prefix;
-        iss >> prefix;
-        if (prefix == "v") {
-            glm::vec3 pos;
-            iss >> pos.x >> pos.y >> pos.z;
-            temp_vertices.push_back(pos);
-        }
-        else if (prefix == "vt") {
-            glm::vec2 uv;
-            iss >> uv.x >> uv.y;
-            temp_texCoords.push_back(uv);
-        }
-        else if (prefix == "vn") {
-            glm::vec3 normal;
-            iss >> normal.x >> normal.y >> normal.z;
-            temp_normals.push_back(normal);
-        }
-        else if (prefix == "f") {
-            std::vector<std::string> faceVertices;
-            std::string token;
-            iss.clear();
-            iss.seekg(0, std::ios::beg);
-            std::string dummy;
-            iss >> dummy;
-            while (iss >> token) {
-                faceVertices.push_back(token);
-            }
-            if (faceVertices.size() < 3) continue;
-            std::vector<std::tuple<int, int, int>> faceIndices;
-            bool valid = true;
-            for (const auto& fv : faceVertices) {
-                auto result = parseFace(fv);
-                int vi = std::get<0>(result);
-                int ti = std::get<1>(result);
-                int ni = std::get<2>(result);
-                if (vi < 0 || vi >= static_cast<int>(temp_vertices.size())) {
-                    valid = false;
-                    break;
-                }
-                faceIndices.emplace_back(vi, ti, ni);
-            }
-            if (!valid) continue;
-            unsigned int baseIdx = static_cast<unsigned int>(vertices.size());
-            for (size_t i = 0; i < faceIndices.size() - 2; ++i) {
-                auto result0 = faceIndices[0];
-                int vi0 = std::get<0>(result0);
-                int ti0 = std::get<1>(result0);
-                int ni0 = std::get<2>(result0);
-                auto result1 = faceIndices[i + 1];
-                int vi1 = std::get<0>(result1);
-                int ti1 = std::get<1>(result1);
-                int ni1 = std::get<2>(result1);
-                auto result2 = faceIndices[i + 2];
-                int vi2 = std::get<0>(result2);
-                int ti2 = std::get<1>(result2);
-                int ni2 = std::get<2>(result2);
-                ti0 = (ti0 >= 0 && ti0 < static_cast<int>(temp_texCoords.size())) ? ti0 : -1;
-                ti1 = (ti1 >= 0 && ti1 < static_cast<int>(temp_texCoords.size())) ? ti1 : -1;
-                ti2 = (ti2 >= 0 && ti2 < static_cast<int>(temp_texCoords.size())) ? ti2 : -1;
-                ni0 = (ni0 >= 0 && ni0 < static_cast<int>(temp_normals.size())) ? ni0 : -1;
-                ni1 = (ni1 >= 0 && ni1 < static_cast<int>(temp_normals.size())) ? ni1 : -1;
-                ni2 = (ni2 >= 0 && ni2 < static_cast<int>(temp_normals.size())) ? ni2 : -1;
-                if (ni0 < 0) ni0 = 0;
-                if (ni1 < 0) ni1 = 0;
-                if (ni2 < 0) ni2 = 0;
-                vertices.push_back({ temp_vertices[vi0], temp_normals[ni0], ti0 >= 0 ? temp_texCoords[ti0] : glm::vec2(0.0f) });
-                vertices.push_back({ temp_vertices[vi1], temp_normals[ni1], ti1 >= 0 ? temp_texCoords[ti1] : glm::vec2(0.0f) });
-                vertices.push_back({ temp_vertices[vi2], temp_normals[ni2], ti2 >= 0 ? temp_texCoords[ti2] : glm::vec2(0.0f) });
-                indices.push_back(baseIdx + 3 * static_cast<unsigned int>(i));
-                indices.push_back(baseIdx + 3 * static_cast<unsigned int>(i) + 1);
-                indices.push_back(baseIdx + 3 * static_cast<unsigned int>(i) + 2);
-            }
-        }
-    }
-    return true;
-}
-
-unsigned int loadTexture(const char* path) {
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (!data) {
-        std::cerr << "ERROR: Failed to load texture: " << path << std::endl;
-        return 0;
-    }
-    GLenum format = (nrChannels == 3) ? GL_RGB : GL_RGBA;
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    stbi_image_free(data);
-    return textureID;
-}
-
-static std::string loadFile(const char* path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "ERROR: Could not open shader file: " << path << "\n";
-        return "";
-    }
-    std::stringstream ss;
-    ss << file.rdbuf();
-    return ss.str();
-}
-
-static GLuint compileShader(GLenum type, const char* src) {
-    GLuint id = glCreateShader(type);
-    glShaderSource(id, 1, &src, nullptr);
-    glCompileShader(id);
-
-    GLint ok; glGetShaderiv(id, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-        char buf[1024]; glGetShaderInfoLog(id, 1024, nullptr, buf);
-        std::cerr << "Shader compile error: " << buf << std::endl;
-    }
-    return id;
-}
-
-static GLuint createProgram(const char* vs, const char* fs) {
-    GLuint p = glCreateProgram();
-    GLuint a = compileShader(GL_VERTEX_SHADER, vs);
-    GLuint b = compileShader(GL_FRAGMENT_SHADER, fs);
-    glAttachShader(p, a); glAttachShader(p, b);
-    glLinkProgram(p);
-
-    GLint ok; glGetProgramiv(p, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char buf[1024]; glGetProgramInfoLog(p, 1024, nullptr, buf);
-        std::cerr << "Link error: " << buf << std::endl;
-    }
-    glDeleteShader(a); glDeleteShader(b);
-    return p;
-}
-
-static GLuint createProgramWithGS(const char* vs, const char* gs, const char* fs) {
-    GLuint p = glCreateProgram();
-    GLuint a = compileShader(GL_VERTEX_SHADER, vs);
-    GLuint g = compileShader(GL_GEOMETRY_SHADER, gs);
-    GLuint b = compileShader(GL_FRAGMENT_SHADER, fs);
-    glAttachShader(p, a); glAttachShader(p, g); glAttachShader(p, b);
-    glLinkProgram(p);
-
-    GLint ok; glGetProgramiv(p, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char buf[1024]; glGetProgramInfoLog(p, 1024, nullptr, buf);
-        std::cerr << "Link error: " << buf << std::endl;
-    }
-    return p;
-}
-
-void framebuffer_size_callback(GLFWwindow* window, int w, int h) {
+#include "Mesh.h"
+#include "MeshCache.h"
+#include "MeshPacking.h"
+#include "Material.h"
+#include "TextureLoader.h"
+#include "TextureCompress.h"
+#include "Snow.h"
+#include "ShaderProgram.h"
+#include "UniformBuffer.h"
+#include "RenderQueue.h"
+#include "DynamicBuffer.h"
+#include "Culling.h"
+#include "Terrain.h"
+#include "TerrainNoise.h"
+#include "Cdlod.h"
+#include "Bench.h"
+
+void framebuffer_size_callback(GLFWwindow*, int w, int h) {
     glViewport(0, 0, w, h);
 }
 
@@ -233,7 +42,7 @@ float pitch = 0.0f;
 float lastX = 400, lastY = 300;
 bool firstMouse = true;
 
-void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
+void mouse_callback(GLFWwindow*, double xpos, double ypos) {
     if (firstMouse) {
         lastX = xpos;
         lastY = ypos;
@@ -262,6 +71,19 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     cameraFront = glm::normalize(dir);
 }
 
+// Каркас поверх мешей: вторым проходом через wire.gs или в основном проходе по барицентрическим координатам
+enum WireframeMode { WIRE_OFF, WIRE_TWO_PASS, WIRE_SINGLE_PASS, WIRE_MODE_COUNT };
+const char* const kWireframeModeNames[WIRE_MODE_COUNT] = { "off", "two-pass", "single-pass" };
+WireframeMode wireMode = WIRE_TWO_PASS;
+
+// F переключает режим каркаса по кругу
+void key_callback(GLFWwindow*, int key, int, int action, int) {
+    if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        wireMode = static_cast<WireframeMode>((wireMode + 1) % WIRE_MODE_COUNT);
+        std::cout << "Wireframe: " << kWireframeModeNames[wireMode] << "\n";
+    }
+}
+
 void processInput(GLFWwindow* window, float deltaTime) {
     float speed = 2.5f * deltaTime;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -276,7 +98,119 @@ void processInput(GLFWwindow* window, float deltaTime) {
         glfwSetWindowShouldClose(window, true);
 }
 
-int main() {
+// std140 mirrors of the per-frame blocks in the shaders: vec3 is aligned to 16 bytes, and array
+// elements take 16 bytes each.
+enum SceneBlockBinding { BLOCK_CAMERA, BLOCK_LIGHTING, BLOCK_FOG, BLOCK_OBJECT };
+
+struct CameraBlock {
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 skyView;
+    glm::vec3 viewPos;
+    float pad0 = 0.0f;                  // padding is compared too (UniformRing skips unchanged frames)
+};
+
+const int MAX_LIGHTS = 4;
+struct LightingBlock {
+    glm::vec4 positions[MAX_LIGHTS];    // xyz
+    glm::vec4 colors[MAX_LIGHTS];
+    glm::vec3 ambient;
+    int count;
+};
+
+struct FogBlock {
+    glm::vec3 color;
+    int mode;                           // 0 off, 1 linear, 2 exp, 3 exp2
+    float start, end, density;
+    float pad0 = 0.0f;
+};
+
+// Per-draw block, allocated from the frame's DynamicBuffer for every object drawn with shader.vert/frag.
+struct ObjectBlock {
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3];          // std140 mat3: inverseTranspose(mat3(model)), columns padded to vec4
+};
+
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock must match the std140 Camera block");
+static_assert(sizeof(LightingBlock) == 144, "LightingBlock must match the std140 Lighting block");
+static_assert(sizeof(FogBlock) == 32, "FogBlock must match the std140 Fog block");
+static_assert(sizeof(ObjectBlock) == 112, "ObjectBlock must match the std140 Object block");
+
+// Uniforms the render loop sets, interned once.
+struct SceneUniforms {
+    UniformName model = internUniform("uModel");
+    UniformName mode = internUniform("mode");
+    UniformName isTerrain = internUniform("isTerrain");
+    UniformName texture1 = internUniform("texture1");
+    UniformName normalTexture = internUniform("normalTexture");
+    UniformName diffuseColor = internUniform("uDiffuseColor");
+    UniformName invertNormal = internUniform("invertNormal");
+    UniformName currentLightIndex = internUniform("currentLightIndex");
+    UniformName instanced = internUniform("uInstanced");
+    UniformName instanceScale = internUniform("uInstanceScale");
+    UniformName skybox = internUniform("skybox");
+    UniformName cameraBlock = internUniform("Camera");
+    UniformName lightingBlock = internUniform("Lighting");
+    UniformName fogBlock = internUniform("Fog");
+    UniformName objectBlock = internUniform("Object");
+};
+
+int main(int argc, char** argv) {
+    const auto startupBegin = std::chrono::steady_clock::now();
+    ObjLoadOptions objOptions;
+    objOptions.weld = true;
+    objOptions.optimize = true;
+    objOptions.quantize = true;   // 20-byte PackedVertex instead of the 48-byte float layout
+    if (argc > 2 && std::string(argv[1]) == "--convert-obj") {
+        int rc = 0;
+        for (int i = 2; i < argc; ++i) rc |= convertOBJFiles(argv[i], objOptions);
+        return rc;
+    }
+    if (argc > 2 && std::string(argv[1]) == "--compress-textures") {
+        int rc = 0;
+        for (int i = 2; i < argc; ++i) rc |= compressTextureFiles(argv[i]);
+        return rc;
+    }
+    if (argc > 1 && std::string(argv[1]).compare(0, 7, "--bench") == 0) return runBenchmarks(argc, argv);
+    // --sync-textures: decode and upload textures on the main thread, for comparing startup times
+    // --no-pbo, --texture-budget-kb N: texture streaming path and bytes uploaded per frame (0 = unlimited)
+    // --no-compress: upload RGB(A) pixels instead of the BC-compressed .dds caches
+    // --snow N: number of snowflakes (drawn instanced, one call for all of them)
+    // --snow-gpu: keep the snow state in GPU buffers, advanced by transform feedback (no CPU update or upload)
+    // --wireframe off|two-pass|single-pass: initial wireframe overlay (F cycles through them)
+    // --terrain chunked|cdlod: quadtree of chunks with skirts, or CDLOD patches with morphing, both over a
+    //   height texture
+    // --jobs N: worker threads for per-frame work besides the main thread (default: one per other core)
+    bool syncTextures = false;
+    bool compressTextures = true;
+    int snowCount = 500;
+    int jobThreads = -1;
+    bool snowOnGpu = false;
+    bool cdlodMode = false;
+    TextureStreamOptions streamOptions;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sync-textures") syncTextures = true;
+        else if (arg == "--no-pbo") streamOptions.usePbo = false;
+        else if (arg == "--no-compress") compressTextures = false;
+        else if (arg == "--snow" && i + 1 < argc) snowCount = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--snow-gpu") snowOnGpu = true;
+        else if (arg == "--wireframe" && i + 1 < argc) {
+            const std::string name = argv[++i];
+            const auto found = std::find(std::begin(kWireframeModeNames), std::end(kWireframeModeNames), name);
+            if (found == std::end(kWireframeModeNames)) { std::cerr << "Unknown wireframe mode: " << name << "\n"; return 1; }
+            wireMode = static_cast<WireframeMode>(found - std::begin(kWireframeModeNames));
+        }
+        else if (arg == "--terrain" && i + 1 < argc) {
+            const std::string name = argv[++i];
+            if (name != "chunked" && name != "cdlod") { std::cerr << "Unknown terrain renderer: " << name << "\n"; return 1; }
+            cdlodMode = name == "cdlod";
+        }
+        else if (arg == "--jobs" && i + 1 < argc) jobThreads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--texture-budget-kb" && i + 1 < argc) streamOptions.frameBudget = static_cast<size_t>(std::atoi(argv[++i])) * 1024;
+        else { std::cerr << "Unknown option: " << arg << "\n"; return 1; }
+    }
+
     if (!glfwInit()) { std::cerr << "GLFW init failed\n"; return -1; }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -288,36 +222,12 @@ int main() {
     glfwSetFramebufferSizeCallback(win, framebuffer_size_callback);
     glfwSetInputMode(win, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetCursorPosCallback(win, mouse_callback);
+    glfwSetKeyCallback(win, key_callback);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cerr << "GLAD init failed\n"; return -1;
     }
 
-    std::string vsCode = loadFile("shaders/shader.vert");
-    std::string fsCode = loadFile("shaders/shader.frag");
-    GLuint prog = createProgram(vsCode.c_str(), fsCode.c_str());
-
-    std::string wireGs = loadFile("shaders/wire.gs");
-    std::string wireFs = loadFile("shaders/wire.frag");
-    GLuint wireProg = createProgramWithGS(vsCode.c_str(), wireGs.c_str(), wireFs.c_str());
-
-    // Skybox shaders
-    std::string skyVSCode = loadFile("shaders/skybox.vert");
-    std::string skyFSCode = loadFile("shaders/skybox.frag");
-    GLuint skyProg = createProgram(skyVSCode.c_str(), skyFSCode.c_str());
-
-    int fogModeLoc = glGetUniformLocation(prog, "fogMode");
-    int fogColorLoc = glGetUniformLocation(prog, "fogColor");
-    int fogStartLoc = glGetUniformLocation(prog, "fogStart");
-    int fogEndLoc = glGetUniformLocation(prog, "fogEnd");
-    int fogDensityLoc = glGetUniformLocation(prog, "fogDensity");
-    int isTerrainLoc = glGetUniformLocation(prog, "isTerrain");
-    int normalLoc = glGetUniformLocation(prog, "normalTexture");
-    int numLightsLoc = glGetUniformLocation(prog, "numLights");
-    int lightPositionsLoc = glGetUniformLocation(prog, "lightPositions");
-    int lightColorsLoc = glGetUniformLocation(prog, "lightColors");
-    int invertNormalLoc = glGetUniformLocation(prog, "invertNormal");
-
     const char* objPath = "model/Замок3.obj";
     const char* texturePath = "model/Bricks097_1K-PNG/Bricks097_1K-PNG_Color.png";
     const char* texturePathNormal = "model/Bricks097_1K-PNG/Bricks097_1K-PNG_NormalGL.png";
@@ -326,46 +236,21 @@ int main() {
     const char* texturePathSphere = "model/wood/wood_planks_diff_1k.jpg";
     const char* texturePathGrass = "model/grass/Grass002_1K-PNG_Color.png";
     const char* normalPathGlass = "model/grass/Grass002_1K-PNG_NormalGL.png";
-    std::vector<Vertex> modelVertices;
-    std::vector<unsigned int> modelIndices;
-    if (!loadOBJ(objPath, modelVertices, modelIndices)) {
-        std::cerr << "Failed to load OBJ. Exiting.\n";
-        glfwTerminate();
-        return -1;
-    }
 
-    std::vector<Vertex> modelVerticesSphere;
-    std::vector<unsigned int> modelIndicesSphere;
-    if (!loadOBJ(objPathSphere, modelVerticesSphere, modelIndicesSphere)) {
-        std::cerr << "Failed to load OBJ. Exiting.\n";
-        glfwTerminate();
-        return -1;
-    }
-    unsigned int texture = loadTexture(texturePath);
-    if (texture == 0) {
-        std::cerr << "Failed to load texture. Using white.\n";
-    }
-    unsigned int textureSphere = loadTexture(texturePathSphere);
-    if (textureSphere == 0) {
-        std::cerr << "Failed to load texture. Using white.\n";
-    }
-    unsigned int textureGrass = loadTexture(texturePathGrass);
-    if (textureGrass == 0) {
-        std::cerr << "Failed to load texture. Using white.\n";
-    }
-    unsigned int normalTextureCastle = loadTexture(texturePathNormal);
-    if (normalTextureCastle == 0) {
-        std::cerr << "Failed normal castle.\n";
-    }
-    unsigned int normalTextureGrass = loadTexture(normalPathGlass);
-    if (normalTextureGrass == 0) {
-        std::cerr << "Failed normal terrain.\n";
-    }
+    // Текстуры декодируются в фоне, пока компилируются шейдеры и грузятся модели;
+    // до готовности вместо них привязана заглушка 1x1.
+    TextureLoader textureLoader;
+    textureLoader.compress = compressTextures;
+    startTextureLoader(textureLoader, 0, syncTextures, streamOptions);
+    std::cout << "Texture uploads: " << textureUploadPathName(textureLoader.streamer.path) << ", "
+        << textureLoader.streamer.frameBudget / 1024 << " KB/frame, " << (textureLoader.compress ? "BC compressed" : "uncompressed") << "\n";
+    unsigned int texture = loadTextureAsync(textureLoader, texturePath);
+    unsigned int textureSphere = loadTextureAsync(textureLoader, texturePathSphere);
+    unsigned int textureGrass = loadTextureAsync(textureLoader, texturePathGrass);
+    unsigned int normalTextureCastle = loadTextureAsync(textureLoader, texturePathNormal, kPlaceholderNormal);
+    unsigned int normalTextureGrass = loadTextureAsync(textureLoader, normalPathGlass, kPlaceholderNormal);
 
     // Skybox texture loading
-    unsigned int skyboxTexture;
-    glGenTextures(1, &skyboxTexture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
     const char* skyboxFaces[6] = {
         "skybox/px.jpg",  // +X right
         "skybox/nx.jpg",  // -X left
@@ -374,120 +259,173 @@ int main() {
         "skybox/pz.jpg",  // +Z back
         "skybox/nz.jpg"   // -Z front
     };
-    for (unsigned int i = 0; i < 6; i++) {
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(skyboxFaces[i], &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else {
-            std::cout << "Failed to load skybox face: " << skyboxFaces[i] << std::endl;
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    unsigned int skyboxTexture = loadCubeMapAsync(textureLoader, skyboxFaces);
 
-    GLuint modelVAO, modelVBO, modelEBO;
-    glGenVertexArrays(1, &modelVAO);
-    glGenBuffers(1, &modelVBO);
-    glGenBuffers(1, &modelEBO);
-    glBindVertexArray(modelVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, modelVBO);
-    glBufferData(GL_ARRAY_BUFFER, modelVertices.size() * sizeof(Vertex), modelVertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, modelIndices.size() * sizeof(unsigned int), modelIndices.data(), GL_STATIC_DRAW);
+    std::string vsCode = loadShaderSource("shaders/shader.vert");
+    std::string fsCode = loadShaderSource("shaders/shader.frag");
+    GLuint prog = createProgram(vsCode.c_str(), fsCode.c_str());
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindVertexArray(0);
+    std::string wireGs = loadShaderSource("shaders/wire.gs");
+    std::string wireFs = loadShaderSource("shaders/wire.frag");
+    GLuint wireProg = createProgramWithGS(vsCode.c_str(), wireGs.c_str(), wireFs.c_str());
 
-    // Ландшафт
-    const int TERRAIN_SIZE = 64;  // Grid size (вершины: SIZE x SIZE)
-    const float TERRAIN_SCALE = 10.0f; 
-    std::vector<Vertex> terrainVertices;
-    std::vector<unsigned int> terrainIndices;
-
-    for (int i = 0; i < TERRAIN_SIZE; ++i) {
-        for (int j = 0; j < TERRAIN_SIZE; ++j) {
-            float x = (float)i / (TERRAIN_SIZE - 1) * 2.0f - 1.0f;  // [-1,1]
-            float z = (float)j / (TERRAIN_SIZE - 1) * 2.0f - 1.0f;
-            x *= TERRAIN_SCALE;  // Масштаб
-            z *= TERRAIN_SCALE;
-
-            // Procedural height: Многослойный шум (octaves)
-            float height = 0.0f;
-            float amplitude = 1.0f;
-            float frequency = 0.1f;
-            for (int octave = 0; octave < 4; ++octave) {  
-                height += sin(x * frequency) * cos(z * frequency) * amplitude;
-                amplitude *= 0.5f;
-                frequency *= 2.0f;
-            }
-            height *= -0.5f;  // Амплитуда холмов
+    // Основной шейдер с каркасом в том же проходе
+    std::string baryGs = loadShaderSource("shaders/wire_bary.gs");
+    GLuint baryProg = createProgramWithGS(withDefine(vsCode, "WIREFRAME_BARYCENTRIC").c_str(), baryGs.c_str(),
+        withDefine(fsCode, "WIREFRAME_BARYCENTRIC").c_str());
 
-            glm::vec3 pos(x, height, z);
-            glm::vec3 normal(0.0f, 1.0f, 0.0f); 
+    // Ландшафт: тот же шейдер, но высоты берутся из текстуры (TERRAIN_CDLOD или TERRAIN_CHUNKED);
+    // варианты с каркасом тоже
+    const std::string terrainVsCode = withDefine(vsCode, cdlodMode ? "TERRAIN_CDLOD" : "TERRAIN_CHUNKED");
+    GLuint terrainProg = createProgram(terrainVsCode.c_str(), fsCode.c_str());
+    GLuint terrainWireProg = createProgramWithGS(terrainVsCode.c_str(), wireGs.c_str(), wireFs.c_str());
+    GLuint terrainBaryProg = createProgramWithGS(withDefine(terrainVsCode, "WIREFRAME_BARYCENTRIC").c_str(), baryGs.c_str(),
+        withDefine(fsCode, "WIREFRAME_BARYCENTRIC").c_str());
 
-            // UV для текстуры
-            glm::vec2 uv((float)i / (TERRAIN_SIZE - 1), (float)j / (TERRAIN_SIZE - 1));
-            terrainVertices.push_back({ pos, normal, uv });
+    // Skybox shaders
+    std::string skyVSCode = loadShaderSource("shaders/skybox.vert");
+    std::string skyFSCode = loadShaderSource("shaders/skybox.frag");
+    GLuint skyProg = createProgram(skyVSCode.c_str(), skyFSCode.c_str());
 
-        }
+    // Локации uniform-переменных читаются один раз; в цикле повторные значения не отправляются
+    ShaderProgram progShader, wireShader, baryShader, skyShader, terrainShader, terrainWireShader, terrainBaryShader;
+    reflectProgram(progShader, prog);
+    reflectProgram(wireShader, wireProg);
+    reflectProgram(baryShader, baryProg);
+    reflectProgram(skyShader, skyProg);
+    reflectProgram(terrainShader, terrainProg);
+    reflectProgram(terrainWireShader, terrainWireProg);
+    reflectProgram(terrainBaryShader, terrainBaryProg);
+    ShaderProgram* const shaders[] = { &progShader, &wireShader, &baryShader, &skyShader, &terrainShader, &terrainWireShader,
+        &terrainBaryShader };
+    const SceneUniforms u;
+    for (ShaderProgram* shader : shaders) {
+        bindUniformBlock(*shader, u.cameraBlock, BLOCK_CAMERA);
+        bindUniformBlock(*shader, u.lightingBlock, BLOCK_LIGHTING);
+        bindUniformBlock(*shader, u.fogBlock, BLOCK_FOG);
+        bindUniformBlock(*shader, u.objectBlock, BLOCK_OBJECT);
+    }
+    // Сэмплеры и isTerrain не меняются от кадра к кадру
+    for (ShaderProgram* shader : { &progShader, &baryShader, &terrainShader, &terrainBaryShader }) {
+        glUseProgram(shader->id);
+        setUniform(*shader, u.texture1, 0);
+        setUniform(*shader, u.normalTexture, 1);
+        setUniform(*shader, u.isTerrain, 0);
+    }
+    glUseProgram(skyProg);
+    setUniform(skyShader, u.skybox, 0);
+    // Камера, свет и туман пишутся один раз за кадр в общий буфер, а не в каждую программу
+    UniformRing sceneBlocks;
+    initUniformRing(sceneBlocks, sizeof(CameraBlock) + sizeof(LightingBlock) + sizeof(FogBlock), 3);
+
+    // Потоки для покадровой работы; на них же разбираются OBJ и строится карта высот
+    JobSystem jobs;
+    startJobSystem(jobs, jobThreads);
+    objOptions.jobs = &jobs;
+
+    CachedMesh modelMesh;
+    if (!loadMeshCached(objPath, objOptions, modelMesh)) {
+        std::cerr << "Failed to load OBJ. Exiting.\n";
+        stopJobSystem(jobs);
+        stopTextureLoader(textureLoader);
+        glfwTerminate();
+        return -1;
     }
 
-    // Indices для треугольников (grid)
-    for (int i = 0; i < TERRAIN_SIZE - 1; ++i) {
-        for (int j = 0; j < TERRAIN_SIZE - 1; ++j) {
-            unsigned int base = i * TERRAIN_SIZE + j;
-            // Первый треугольник
-            terrainIndices.push_back(base + 1);
-            terrainIndices.push_back(base + TERRAIN_SIZE);
-            terrainIndices.push_back(base);
-            // Второй
-            terrainIndices.push_back(base + 1);
-            terrainIndices.push_back(base + TERRAIN_SIZE + 1);
-            terrainIndices.push_back(base + TERRAIN_SIZE);
+    CachedMesh sphereMesh;
+    if (!loadMeshCached(objPathSphere, objOptions, sphereMesh)) {
+        std::cerr << "Failed to load OBJ. Exiting.\n";
+        stopJobSystem(jobs);
+        stopTextureLoader(textureLoader);
+        glfwTerminate();
+        return -1;
+    }
+    GLuint modelVAO, modelVBO, modelEBO;
+    glGenVertexArrays(1, &modelVAO);
+    glGenBuffers(1, &modelVBO);
+    glGenBuffers(1, &modelEBO);
+    MeshDraw modelDraw = uploadMesh(modelMesh.data, modelVAO, modelVBO, modelEBO);
+    printPackStats("Castle", modelMesh.data);
+    std::vector<Material> modelMaterialDefs = modelMesh.materials;
+    closeCachedMesh(modelMesh);
+
+    // Ландшафт: карта высот TERRAIN_SIZE x TERRAIN_SIZE, разбитая на чанки по TERRAIN_CHUNK квадов
+    const int TERRAIN_SIZE = 257;  // Grid size (вершины: SIZE x SIZE), кратно чанкам + 1
+    const int TERRAIN_CHUNK = 32;
+    const float TERRAIN_SCALE = 10.0f; 
+    Heightfield terrainField;
+    terrainField.width = terrainField.depth = TERRAIN_SIZE;
+    terrainField.spacing = 2.0f * TERRAIN_SCALE / (TERRAIN_SIZE - 1);
+    terrainField.origin = glm::vec2(-TERRAIN_SCALE);  // [-1,1] * Масштаб
+
+    // Procedural height: симплекс-шум, 5 октав fBm; нормали считаются аналитически в том же проходе
+    NoiseParams terrainNoise;
+    terrainNoise.octaves = 5;
+    terrainNoise.frequency = 0.08f;  // ~1.6 ячейки решётки на всю карту: пологие холмы
+    terrainNoise.amplitude = 0.6f;   // Амплитуда холмов
+    const HeightfieldGenStats terrainGen = generateHeightfield(terrainField, terrainNoise, jobs);
+    std::cout << "Terrain: " << terrainGen.samples << " height samples in " << terrainGen.ms << " ms ("
+        << simdLevelName(terrainGen.simd) << ", " << terrainGen.jobs << " jobs)\n";
+
+    // Дальние узлы накрывают 2x2, 4x4, 8x8 чанков с каждой 2-й, 4-й, 8-й вершиной; юбки по краям
+    // закрывают щели между уровнями
+    TerrainParams terrainParams;
+    terrainParams.chunkQuads = TERRAIN_CHUNK;
+    terrainParams.lodLevels = 4;
+    terrainParams.lodDistance = TERRAIN_CHUNK * terrainField.spacing;
+    Terrain terrain;
+    CdlodTerrain cdlod;
+    if (cdlodMode) {
+        // Один патч 16x16 квадов растягивается на узлы квадродерева
+        CdlodParams cdlodParams;
+        cdlodParams.patchQuads = 16;
+        cdlodParams.levels = 5;
+        cdlodParams.lodDistance = 2.5f * cdlodParams.patchQuads * terrainField.spacing;
+        if (!buildCdlodTerrain(terrainField, cdlodParams, cdlod)) {
+            stopJobSystem(jobs);
+            stopTextureLoader(textureLoader);
+            glfwTerminate();
+            return -1;
         }
     }
-
-    const int SNOW_COUNT = 500;
-    std::vector<glm::vec3> snowPositions(SNOW_COUNT);
-    for (int i = 0; i < SNOW_COUNT; ++i) {
-        snowPositions[i] = glm::vec3(
-            (rand() % 2000 - 1000) / 100.0f,
-            (rand() % 1000) / 100.0f,
-            (rand() % 2000 - 1000) / 100.0f
-        );
+    else if (!buildTerrain(terrainField, terrainParams, terrain)) {
+        stopJobSystem(jobs);
+        stopTextureLoader(textureLoader);
+        glfwTerminate();
+        return -1;
+    }
+    // Оба варианта рисуют один шаблон сетки на всех узлах и читают карту из текстуры (юнит 2 больше
+    // никто не занимает): CDLOD — только высоты, чанки — высоты вместе с нормалями из генератора
+    GLuint heightmapTexture = cdlodMode ? createHeightmapTexture(terrainField) : createTerrainTexture(terrainField);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, heightmapTexture);
+    glActiveTexture(GL_TEXTURE0);
+    for (ShaderProgram* shader : { &terrainShader, &terrainWireShader, &terrainBaryShader }) {
+        glUseProgram(shader->id);
+        if (cdlodMode) setCdlodConstants(*shader, cdlod, 2);
+        else setTerrainConstants(*shader, terrain, 2);
     }
 
+    Snowfall snow;
+    initSnowfall(snow, snowCount);
+
 
     // VAO/VBO для ландшафта
     GLuint terrainVAO, terrainVBO, terrainEBO;
     glGenVertexArrays(1, &terrainVAO);
     glGenBuffers(1, &terrainVBO);
     glGenBuffers(1, &terrainEBO);
-    glBindVertexArray(terrainVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
-    glBufferData(GL_ARRAY_BUFFER, terrainVertices.size() * sizeof(Vertex), terrainVertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, terrainIndices.size() * sizeof(unsigned int), terrainIndices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindVertexArray(0);
+    const MeshData terrainMesh = cdlodMode ? cdlodPatchMeshData(cdlod) : terrainMeshData(terrain);
+    MeshDraw terrainDraw = uploadMesh(terrainMesh, terrainVAO, terrainVBO, terrainEBO);
+    printPackStats("Terrain", terrainMesh);
+    if (cdlodMode)
+        std::cout << "Terrain: CDLOD, " << cdlod.rootsX << "x" << cdlod.rootsZ << " roots of " << cdlod.params.levels
+            << " levels, " << TERRAIN_SIZE * TERRAIN_SIZE * sizeof(float) / 1024 << " KB height texture\n";
+    else
+        std::cout << "Terrain: " << terrain.chunksX << "x" << terrain.chunksZ << " chunks, " << terrain.levels
+            << " levels, template " << terrain.templateVertices.size() * sizeof(GridVertex) / 1024 << " KB of vertices and "
+            << terrain.indices.size() * sizeof(uint16_t) / 1024 << " KB of indices, "
+            << TERRAIN_SIZE * TERRAIN_SIZE * 2 * sizeof(uint32_t) / 1024 << " KB height and normal texture\n";
 
     // Конец ландшафта
 
@@ -495,19 +433,32 @@ int main() {
     glGenVertexArrays(1, &sphereVAO);
     glGenBuffers(1, &sphereVBO);
     glGenBuffers(1, &sphereEBO);
-    glBindVertexArray(sphereVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, modelVerticesSphere.size() * sizeof(Vertex), modelVerticesSphere.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, modelIndicesSphere.size() * sizeof(unsigned int), modelIndicesSphere.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindVertexArray(0);
+    MeshDraw sphereDraw = uploadMesh(sphereMesh.data, sphereVAO, sphereVBO, sphereEBO);
+    printPackStats("Sphere", sphereMesh.data);
+    std::vector<Material> sphereMaterialDefs = sphereMesh.materials;
+    closeCachedMesh(sphereMesh);
+
+    // Материалы из MTL: одна текстура на файл, диапазоны отсортированы по текстурам.
+    // Без usemtl или без найденной текстуры используются прежние текстуры объекта.
+    TextureCache textureCache;
+    textureCache.loader = &textureLoader;
+    textureCache.jobs = &jobs;
+    GLuint whiteTexture = createSolidTexture(255, 255, 255);
+    MaterialGL castleFallback;
+    castleFallback.diffuseMap = texture;
+    castleFallback.normalMap = normalTextureCastle;
+    MaterialSet modelMaterials = createMaterialSet(modelMaterialDefs, textureCache, castleFallback, whiteTexture);
+    std::vector<SubMesh> modelOrder = sortByMaterial(modelDraw.subMeshes, modelMaterials);
+    MaterialGL sphereFallback;
+    sphereFallback.diffuseMap = textureSphere;
+    sphereFallback.normalMap = normalTextureCastle;
+    MaterialSet sphereMaterials = createMaterialSet(sphereMaterialDefs, textureCache, sphereFallback, whiteTexture);
+    std::vector<SubMesh> sphereOrder = sortByMaterial(sphereDraw.subMeshes, sphereMaterials);
+    RenderStats castleBefore = countMaterialBinds(modelDraw.subMeshes, modelMaterials, false);
+    RenderStats castleAfter = countMaterialBinds(modelOrder, modelMaterials, true);
+    std::cout << "Castle: " << modelMaterialDefs.size() << " materials, " << modelDraw.subMeshes.size()
+        << " ranges; file order " << castleBefore.drawCalls << " draws / " << castleBefore.textureBinds
+        << " binds, sorted " << castleAfter.drawCalls << " draws / " << castleAfter.textureBinds << " binds\n";
 
     float cubeVertices[] = {
         -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f,
@@ -541,7 +492,7 @@ int main() {
            0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f
     };
 
-    unsigned int cubeIndices[] = {
+    unsigned short cubeIndices[] = {
 
         0, 1, 2, 2, 3, 0,
         4, 5, 6, 6, 7, 4,
@@ -567,6 +518,26 @@ int main() {
 
     glBindVertexArray(0);
 
+    // Снежинки: тот же куб, позиции и масштаб — в instance-буфере
+    if (snowOnGpu && !createSnowfallGPU(snow, "shaders/snow_update.vert", lightVBO, lightEBO, 36, GL_UNSIGNED_SHORT)) {
+        std::cerr << "ERROR: GPU snow unavailable, simulating on the CPU\n";
+        snowOnGpu = false;
+    }
+    if (!snowOnGpu) createSnowfallGL(snow, lightVBO, lightEBO, 36, GL_UNSIGNED_SHORT);
+    std::cout << "Snow: " << snow.count << " flakes on the " << (snowOnGpu ? "GPU (transform feedback)" : "CPU") << "\n";
+    std::cout << "Wireframe: " << kWireframeModeNames[wireMode] << " (F to switch)\n";
+
+    // Данные, которые меняются каждый кадр (матрицы объектов, позиции снежинок), идут через кольцевой буфер
+    const int kMaxObjectsPerFrame = 64;
+    GLint blockAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &blockAlignment);
+    const size_t objectStride = (sizeof(ObjectBlock) + blockAlignment - 1) / blockAlignment * blockAlignment;
+    const size_t snowBytes = snowOnGpu ? 0 : 3 * snow.count * sizeof(float) + 16;
+    DynamicBuffer frameData;
+    initDynamicBuffer(frameData, kMaxObjectsPerFrame * objectStride + snowBytes);
+    std::cout << "Dynamic data: " << dynamicBufferPathName(frameData.path) << ", " << frameData.regionSize / 1024
+        << " KB per frame\n";
+
     // Skybox VAO/VBO/EBO
     GLuint skyboxVAO, skyboxVBO, skyboxEBO;
     glGenVertexArrays(1, &skyboxVAO);
@@ -581,7 +552,6 @@ int main() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);  
     glBindVertexArray(0);
 
-    int skyboxLoc = glGetUniformLocation(skyProg, "skybox");
 
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -593,33 +563,50 @@ int main() {
 
     float lastFrame = 0.0f;
 
-    int modeLoc = glGetUniformLocation(prog, "mode");
-    int textureLoc = glGetUniformLocation(prog, "texture1");
-    int currentLightIndexLoc = glGetUniformLocation(prog, "currentLightIndex");
+    RenderStats shownStats;
+    bool firstFrameShown = false;
+    bool texturesReported = false;
+    float worstLoadingFrame = 0.0f;
+    double cpuFrameMs = 0.0;        // CPU time from the start of the frame to SwapBuffers, summed
+    int cpuFrames = 0;
+    UniformStats uniformTotals;
+    RenderQueue renderQueue;
+    renderQueue.objectBinding = BLOCK_OBJECT;
+    CullBoxes sceneBoxes;
+    std::vector<uint8_t> sceneVisible;
+    CullStats objectCull, flakeCull;
+    float cpuReportTime = 0.0f;
 
     while (!glfwWindowShouldClose(win)) {
+        const auto cpuBegin = std::chrono::steady_clock::now();
         float currentFrame = (float)glfwGetTime();
         float deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        if (firstFrameShown && !texturesReported) worstLoadingFrame = std::max(worstLoadingFrame, deltaTime);
 
         processInput(win, deltaTime);
+        // Снег считается на рабочих потоках, пока главный поток готовит кадр
+        JobCounter snowDone;
+        if (!snowOnGpu) updateSnowfallAsync(snow, deltaTime, jobs, snowDone);
+        pumpTextureUploads(textureLoader);
+        beginDynamicFrame(frameData);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(prog);
+        RenderStats frameStats;
 
         // Fog
-        glUniform1i(fogModeLoc, 1);
-        glm::vec3 fogC(0.8f, 0.9f, 1.0f);
-        glUniform3f(fogColorLoc, fogC.r, fogC.g, fogC.b);
-        glUniform1f(fogStartLoc, 5.0f);
-        glUniform1f(fogEndLoc, 20.0f);
-        glUniform1f(fogDensityLoc, 0.05f);
+        FogBlock fog;
+        fog.mode = 1;
+        fog.color = glm::vec3(0.8f, 0.9f, 1.0f);
+        fog.start = 5.0f;
+        fog.end = 20.0f;
+        fog.density = 0.05f;
 
         // View & Projection
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-        glm::mat4 proj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uView"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uProj"), 1, GL_FALSE, glm::value_ptr(proj));
+        CameraBlock camera;
+        camera.view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+        camera.proj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+        camera.skyView = glm::mat4(glm::mat3(camera.view));
+        camera.viewPos = cameraPos;
 
         // Multi-lights
         const int NUM_LIGHTS = 3;
@@ -633,156 +620,281 @@ int main() {
             glm::vec3(0.0f, 0.0f, 1.0f),
             glm::vec3(1.0f, 0.0f, 0.0f)
         };
-        glUniform1i(numLightsLoc, NUM_LIGHTS);
-        glUniform3fv(lightPositionsLoc, NUM_LIGHTS, (float*)lightPositions);
-        glUniform3fv(lightColorsLoc, NUM_LIGHTS, (float*)lightColors);
-        glUniform3f(glGetUniformLocation(prog, "ambientColor"), 0.1f, 0.1f, 0.1f);
-        glUniform3f(glGetUniformLocation(prog, "viewPos"), cameraPos.x, cameraPos.y, cameraPos.z);
+        LightingBlock lighting;
+        for (int i = 0; i < MAX_LIGHTS; ++i) {
+            lighting.positions[i] = i < NUM_LIGHTS ? glm::vec4(lightPositions[i], 1.0f) : glm::vec4(0.0f);
+            lighting.colors[i] = i < NUM_LIGHTS ? glm::vec4(lightColors[i], 1.0f) : glm::vec4(0.0f);
+        }
+        lighting.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+        lighting.count = NUM_LIGHTS;
+
+        beginUniformFrame(sceneBlocks);
+        stageUniformBlock(sceneBlocks, BLOCK_CAMERA, &camera, sizeof(camera));
+        stageUniformBlock(sceneBlocks, BLOCK_LIGHTING, &lighting, sizeof(lighting));
+        stageUniformBlock(sceneBlocks, BLOCK_FOG, &fog, sizeof(fog));
+        endUniformFrame(sceneBlocks);
+
+        // Все отрисовки кадра идут пакетами в очередь; порядок и лишние переключения состояния
+        // решает executeRenderQueue
+        beginRenderQueue(renderQueue);
+        const auto viewDepth = [&](const glm::vec3& p) { return glm::length(p - cameraPos); };
+        const auto objectBlock = [&](const glm::mat4& m) {
+            DynamicAllocation a = allocDynamic(frameData, sizeof(ObjectBlock), frameData.uniformAlignment);
+            if (a.data) {
+                // Матрица нормалей считается здесь один раз на отрисовку, а не в каждой вершине
+                ObjectBlock* block = static_cast<ObjectBlock*>(a.data);
+                const glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(m));
+                block->model = m;
+                for (int c = 0; c < 3; ++c) block->normalMatrix[c] = glm::vec4(normalMatrix[c], 0.0f);
+            }
+            return a;
+        };
+        // Меши с каркасом в один проход рисуются baryShader, вторые проходы wire — только в WIRE_TWO_PASS
+        ShaderProgram* const meshShader = wireMode == WIRE_SINGLE_PASS ? &baryShader : &progShader;
+        const bool wirePass = wireMode == WIRE_TWO_PASS;
 
-        // === Ландшафт ===
         glm::mat4 terrainModel = glm::mat4(1.0f);
         terrainModel = glm::translate(terrainModel, glm::vec3(0.0f, -0.5f, -3.0f));
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"), 1, GL_FALSE, glm::value_ptr(terrainModel));
-        glUniform1i(modeLoc, 0);
-        glUniform1i(isTerrainLoc, 0);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureGrass);
-        glUniform1i(textureLoc, 0);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normalTextureGrass);
-        glUniform1i(normalLoc, 1);
-
-        glBindVertexArray(terrainVAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(terrainIndices.size()), GL_UNSIGNED_INT, 0);
-
-        // Наложение каркаса на ландшафт
-        glEnable(GL_POLYGON_OFFSET_LINE);
-        glPolygonOffset(-1.0f, -1.0f);
-        glUseProgram(wireProg);
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uModel"), 1, GL_FALSE, glm::value_ptr(terrainModel));
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uView"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uProj"), 1, GL_FALSE, glm::value_ptr(proj));
-        glBindVertexArray(terrainVAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(terrainIndices.size()), GL_UNSIGNED_INT, 0);
-        glDisable(GL_POLYGON_OFFSET_LINE);
-        glUseProgram(prog);  // возвращаемся к основному шейдеру
-
-        // === Замок ===
         glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
         model = glm::translate(model, glm::vec3(0.0f, -1.0f, -3.0f));
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(modeLoc, 0);
-        glUniform1i(isTerrainLoc, 0);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glUniform1i(textureLoc, 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normalTextureCastle);
-        glUniform1i(normalLoc, 1);
-        glBindVertexArray(modelVAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(modelIndices.size()), GL_UNSIGNED_INT, 0);
-
-        // Наложение каркаса на замок
-        glEnable(GL_POLYGON_OFFSET_LINE);
-        glPolygonOffset(-1.0f, -1.0f);
-        glUseProgram(wireProg);
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uModel"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uView"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uProj"), 1, GL_FALSE, glm::value_ptr(proj));
-        glBindVertexArray(modelVAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(modelIndices.size()), GL_UNSIGNED_INT, 0);
-        glDisable(GL_POLYGON_OFFSET_LINE);
-        glUseProgram(prog);
-
-        // === Сфера ===
         glm::mat4 sphereModel = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, -3.0f));
         sphereModel = glm::scale(sphereModel, glm::vec3(0.5f));
-        glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"), 1, GL_FALSE, glm::value_ptr(sphereModel));
-        glUniform1i(modeLoc, 0);
-        glUniform1i(isTerrainLoc, 0);
-        glUniform1i(invertNormalLoc, 1); 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureSphere);
-        glUniform1i(textureLoc, 0);
-        glUniform1i(normalLoc, 1);
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(modelIndicesSphere.size()), GL_UNSIGNED_INT, 0);
-        glUniform1i(invertNormalLoc, 0);
-
-        // Наложение каркаса на сферу
-        glEnable(GL_POLYGON_OFFSET_LINE);
-        glPolygonOffset(-1.0f, -1.0f);
-        glUseProgram(wireProg);
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uModel"), 1, GL_FALSE, glm::value_ptr(sphereModel));
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uView"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(wireProg, "uProj"), 1, GL_FALSE, glm::value_ptr(proj));
-        glBindVertexArray(sphereVAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(modelIndicesSphere.size()), GL_UNSIGNED_INT, 0);
-        glDisable(GL_POLYGON_OFFSET_LINE);
-        glUseProgram(prog);
-        glUniform1i(invertNormalLoc, 0);
-
-        glUseProgram(prog);
-        glUniform1i(modeLoc, 1); // Используем режим ламп для свечения снежинок
-        for (int i = 0; i < SNOW_COUNT; ++i) {
-            snowPositions[i].y -= deltaTime * 1.5f; // Скорость падения
-            if (snowPositions[i].y < -1.0f) snowPositions[i].y = 10.0f;
-
-            glm::mat4 snowModel = glm::translate(glm::mat4(1.0f), snowPositions[i]);
-            snowModel = glm::scale(snowModel, glm::vec3(0.02f));
-            glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"), 1, GL_FALSE, glm::value_ptr(snowModel));
-
-            // Белый цвет для снега (используем первый индекс цвета света)
-            glUniform1i(currentLightIndexLoc, 0);
-
-            glBindVertexArray(lightVAO);
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glm::mat4 lightModels[NUM_LIGHTS];
+        for (int i = 0; i < NUM_LIGHTS; ++i) {
+            lightModels[i] = glm::translate(glm::mat4(1.0f), lightPositions[i]);
+            lightModels[i] = glm::scale(lightModels[i], glm::vec3(0.2f));
+        }
+
+        // Отсечение по пирамиде видимости: мировые AABB всех объектов проверяются одной пачкой,
+        // невидимые объекты (и их каркас) в очередь не попадают. Скайбокс не отсекается
+        const Frustum frustum = extractFrustum(camera.proj * camera.view);
+        clearCullBoxes(sceneBoxes);
+        const auto addObjectBox = [&](const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax) {
+            glm::vec3 worldMin, worldMax;
+            transformBounds(m, localMin, localMax, worldMin, worldMax);
+            return addCullBox(sceneBoxes, worldMin, worldMax);
+        };
+        const size_t castleBox = addObjectBox(model, modelDraw.boundsMin, modelDraw.boundsMax);
+        const size_t sphereBox = addObjectBox(sphereModel, sphereDraw.boundsMin, sphereDraw.boundsMax);
+        size_t lampBoxes[NUM_LIGHTS];
+        for (int i = 0; i < NUM_LIGHTS; ++i) lampBoxes[i] = addObjectBox(lightModels[i], glm::vec3(-0.5f), glm::vec3(0.5f));
+        cullBoxes(sceneBoxes, frustum, sceneVisible, bestSimdLevel(), &objectCull);
+        // Ландшафт отсекается и выбирает уровни детализации в своём пространстве
+        const Frustum terrainFrustum = extractFrustum(camera.proj * camera.view * terrainModel);
+        const glm::vec3 terrainEye = glm::vec3(glm::inverse(terrainModel) * glm::vec4(cameraPos, 1.0f));
+        if (cdlodMode) selectCdlodNodes(cdlod, terrainFrustum, terrainEye);
+        else selectTerrainChunks(terrain, terrainFrustum, terrainEye);
+
+        // Наложение каркаса: тот же VAO, шейдер каркаса со смещением полигонов
+        DrawPacket wire;
+        wire.pass = PASS_OVERLAY;
+        wire.state = RS_POLYGON_OFFSET_LINE;
+        wire.program = &wireShader;
+
+        // === Ландшафт ===
+        if (!terrain.selection.empty() || !cdlod.selection.empty()) {
+            DrawPacket ground;
+            ground.program = wireMode == WIRE_SINGLE_PASS ? &terrainBaryShader : &terrainShader;
+            ground.vao = terrainVAO;
+            ground.textures[0] = textureGrass;
+            ground.textures[1] = normalTextureGrass;
+            ground.object = objectBlock(terrainModel);
+            queueUniform(renderQueue, u.mode, 0);
+            queueUniform(renderQueue, u.invertNormal, 0);
+            queueUniform(renderQueue, u.instanced, 0);
+            queueUniform(renderQueue, u.diffuseColor, glm::vec3(1.0f, 1.0f, 1.0f));
+            ground.uniforms = takeUniformSet(renderQueue);
+            if (cdlodMode) submitCdlodTerrain(renderQueue, ground, cdlod, terrainDraw);
+            else submitTerrain(renderQueue, ground, terrain, terrainDraw);
+
+            if (wirePass) {
+                DrawPacket groundWire = wire;
+                groundWire.vao = terrainVAO;
+                groundWire.object = ground.object;
+                groundWire.program = &terrainWireShader;
+                if (cdlodMode) submitCdlodTerrain(renderQueue, groundWire, cdlod, terrainDraw);
+                else submitTerrain(renderQueue, groundWire, terrain, terrainDraw);
+            }
+        }
+
+        // === Замок ===
+        if (sceneVisible[castleBox]) {
+            DrawPacket castle;
+            castle.program = meshShader;
+            castle.vao = modelVAO;
+            castle.depth = viewDepth(glm::vec3(model[3]));
+            castle.object = objectBlock(model);
+            queueUniform(renderQueue, u.mode, 0);
+            queueUniform(renderQueue, u.invertNormal, 0);
+            queueUniform(renderQueue, u.instanced, 0);
+            castle.uniforms = takeUniformSet(renderQueue);
+            submitMaterials(renderQueue, castle, modelDraw, modelOrder, modelMaterials, u.diffuseColor);
+
+            if (wirePass) {
+                wire.vao = modelVAO;
+                wire.depth = castle.depth;
+                wire.object = castle.object;
+                submitMesh(renderQueue, wire, modelDraw);
+            }
+        }
+
+        // === Сфера ===
+        if (sceneVisible[sphereBox]) {
+            DrawPacket sphere;
+            sphere.program = meshShader;
+            sphere.vao = sphereVAO;
+            sphere.depth = viewDepth(glm::vec3(sphereModel[3]));
+            sphere.object = objectBlock(sphereModel);
+            queueUniform(renderQueue, u.mode, 0);
+            queueUniform(renderQueue, u.invertNormal, 1);
+            queueUniform(renderQueue, u.instanced, 0);
+            sphere.uniforms = takeUniformSet(renderQueue);
+            submitMaterials(renderQueue, sphere, sphereDraw, sphereOrder, sphereMaterials, u.diffuseColor);
+
+            if (wirePass) {
+                wire.vao = sphereVAO;
+                wire.depth = sphere.depth;
+                wire.object = sphere.object;
+                submitMesh(renderQueue, wire, sphereDraw);
+            }
         }
 
+        // === Снег === (снежинки и лампы используют float-вершины куба)
+        // На CPU в поток экземпляров попадают только снежинки внутри пирамиды видимости
+        if (snowOnGpu) updateSnowfallGPU(snow, deltaTime);
+        waitForJobs(jobs, snowDone);
+        if (!snowOnGpu) streamSnowfall(snow, frameData, &frustum, &flakeCull);
+        DrawPacket flakes;
+        flakes.program = &progShader;
+        flakes.object = objectBlock(glm::scale(glm::mat4(1.0f), glm::vec3(snow.params.scale)));
+        queueUniform(renderQueue, u.mode, 1); // Используем режим ламп для свечения снежинок
+        queueUniform(renderQueue, u.currentLightIndex, 0); // Белый цвет для снега (используем первый индекс цвета света)
+        queueUniform(renderQueue, u.invertNormal, 0);
+        queueUniform(renderQueue, u.instanced, 1);
+        queueUniform(renderQueue, u.instanceScale, snow.params.scale);
+        flakes.uniforms = takeUniformSet(renderQueue);
+        submitSnowfall(renderQueue, flakes, snow);
+
         // === Лампы  ===
+        DrawPacket lamp;
+        lamp.state = RS_NO_CULL;
+        lamp.program = &progShader;
+        lamp.vao = lightVAO;
+        lamp.textures[0] = 0;
+        lamp.range.indexCount = 36;
         for (int i = 0; i < NUM_LIGHTS; ++i) {
-            glm::mat4 lightModel = glm::translate(glm::mat4(1.0f), lightPositions[i]);
-            lightModel = glm::scale(lightModel, glm::vec3(0.2f));
-            glUniformMatrix4fv(glGetUniformLocation(prog, "uModel"), 1, GL_FALSE, glm::value_ptr(lightModel));
-            glUniform1i(modeLoc, 1);
-            glUniform1i(currentLightIndexLoc, i);
-
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, 0);
-            glUniform1i(textureLoc, 0);
-
-            glDisable(GL_CULL_FACE);
-            glBindVertexArray(lightVAO);
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-            glEnable(GL_CULL_FACE);
+            if (!sceneVisible[lampBoxes[i]]) continue;
+            lamp.depth = viewDepth(lightPositions[i]);
+            lamp.object = objectBlock(lightModels[i]);
+            queueUniform(renderQueue, u.mode, 1);
+            queueUniform(renderQueue, u.currentLightIndex, i);
+            queueUniform(renderQueue, u.invertNormal, 0);
+            queueUniform(renderQueue, u.instanced, 0);
+            lamp.uniforms = takeUniformSet(renderQueue);
+            submitDraw(renderQueue, lamp);
         }
 
         // === Скайбокс ===
-        glDepthFunc(GL_LEQUAL);
-        glDisable(GL_CULL_FACE);
-
-        glm::mat4 viewNoTrans = glm::mat4(glm::mat3(view));
-        glm::mat4 skyModel = glm::scale(glm::mat4(1.0f), glm::vec3(100.0f));
-        glUseProgram(skyProg);
-        glUniformMatrix4fv(glGetUniformLocation(skyProg, "uModel"), 1, GL_FALSE, glm::value_ptr(skyModel));
-        glUniformMatrix4fv(glGetUniformLocation(skyProg, "uView"), 1, GL_FALSE, glm::value_ptr(viewNoTrans));
-        glUniformMatrix4fv(glGetUniformLocation(skyProg, "uProj"), 1, GL_FALSE, glm::value_ptr(proj));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-        glUniform1i(skyboxLoc, 0);
-        glBindVertexArray(skyboxVAO);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-        glEnable(GL_CULL_FACE);
-        glDepthFunc(GL_LESS);
+        DrawPacket sky;
+        sky.pass = PASS_SKY;
+        sky.state = RS_NO_CULL | RS_DEPTH_LEQUAL;
+        sky.program = &skyShader;
+        sky.vao = skyboxVAO;
+        sky.cubeMap = skyboxTexture;
+        sky.range.indexCount = 36;
+        queueUniform(renderQueue, u.model, glm::scale(glm::mat4(1.0f), glm::vec3(100.0f)));
+        sky.uniforms = takeUniformSet(renderQueue);
+        submitDraw(renderQueue, sky);
+
+        endDynamicFrame(frameData);
+        executeRenderQueue(renderQueue, frameStats);
+
+        if (frameStats.drawCalls != shownStats.drawCalls || frameStats.textureBinds != shownStats.textureBinds) {
+            std::cout << "Frame: " << frameStats.drawCalls << " draw calls, " << frameStats.textureBinds << " texture binds\n";
+            shownStats = frameStats;
+        }
+        const UniformStats frameUniforms = takeUniformStats(shaders, std::end(shaders) - std::begin(shaders));
+        uniformTotals.uploads += frameUniforms.uploads;
+        uniformTotals.skipped += frameUniforms.skipped;
+        cpuFrameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuBegin).count();
+        ++cpuFrames;
+        if (currentFrame - cpuReportTime >= 5.0f) {
+            std::cout << "CPU frame: " << cpuFrameMs / cpuFrames << " ms avg over " << cpuFrames << " frames ("
+                << snow.count << " snowflakes, " << frameStats.drawCalls << " draw calls, "
+                << static_cast<double>(uniformTotals.uploads) / cpuFrames << " uniform uploads, "
+                << static_cast<double>(uniformTotals.skipped) / cpuFrames << " skipped as unchanged)\n";
+            uniformTotals = UniformStats();
+            const UniformRingStats ring = takeUniformRingStats(sceneBlocks);
+            std::cout << "  uniform blocks: " << ring.uploads << " uploads (" << ring.bytes / std::max(1u, ring.uploads)
+                << " bytes each), " << ring.reused << " frames unchanged, " << ring.waitMs << " ms waiting for the GPU\n";
+            const DynamicBufferStats dynamic = takeDynamicBufferStats(frameData);
+            const unsigned int dynamicFrames = std::max(1u, dynamic.frames);
+            std::cout << "  dynamic data: " << dynamic.bytes / dynamicFrames << " bytes and " << dynamic.allocations / dynamicFrames
+                << " allocations per frame, " << dynamic.waitMs / dynamicFrames << " ms per frame waiting on fences"
+                << (dynamic.failed ? ", " + std::to_string(dynamic.failed) + " allocations did not fit" : "") << "\n";
+            const RenderQueueStats rq = takeRenderQueueStats(renderQueue);
+            std::cout << "  render queue: " << rq.draws << " draws, sort " << rq.sortMs << " ms; issued/skipped: programs "
+                << rq.programBinds << "/" << rq.programsSkipped << ", VAOs " << rq.vaoBinds << "/" << rq.vaosSkipped
+                << ", textures " << rq.textureBinds << "/" << rq.texturesSkipped << ", object blocks " << rq.blockBinds
+                << "/" << rq.blocksSkipped << ", states " << rq.stateChanges << "/" << rq.statesSkipped << "\n";
+            const double cullFrames = std::max(1, cpuFrames);
+            std::cout << "  culling (" << simdLevelName(bestSimdLevel()) << "): objects " << objectCull.visible / cullFrames
+                << " visible / " << (objectCull.tested - objectCull.visible) / cullFrames << " culled, flakes "
+                << flakeCull.visible / cullFrames << " / " << (flakeCull.tested - flakeCull.visible) / cullFrames << ", "
+                << (objectCull.ms + flakeCull.ms) / cullFrames << " ms per frame\n";
+            if (cdlodMode) {
+                const CdlodStats cs = takeCdlodStats(cdlod);
+                const double terrainFrames = std::max(1u, cs.frames);
+                std::cout << "  terrain (CDLOD): " << cs.nodesSelected / terrainFrames << " nodes of " << cs.nodesVisited / terrainFrames
+                    << " visited, " << cs.draws / terrainFrames << " draws, " << cs.triangles / terrainFrames << " triangles per frame (levels";
+                for (int l = 0; l < cdlod.params.levels; ++l) std::cout << " " << cs.levelNodes[l] / terrainFrames;
+                std::cout << "), " << cs.ms / terrainFrames << " ms selecting\n";
+            }
+            else {
+                const TerrainStats ts = takeTerrainStats(terrain);
+                const double terrainFrames = std::max(1u, ts.frames);
+                std::cout << "  terrain: " << ts.nodesDrawn / terrainFrames << " nodes drawn of " << ts.nodesVisited / terrainFrames
+                    << " visited, " << ts.nodesCulled / terrainFrames << " culled, " << ts.triangles / terrainFrames
+                    << " triangles per frame (levels";
+                for (int l = 0; l < terrain.levels; ++l) std::cout << " " << ts.levelNodes[l] / terrainFrames;
+                std::cout << "), " << ts.ms / terrainFrames << " ms selecting\n";
+            }
+            objectCull = CullStats();
+            flakeCull = CullStats();
+            const std::vector<JobWorkerStats> workerStats = jobStats(jobs, true);
+            for (size_t w = 0; w < workerStats.size(); ++w)
+                std::cout << "  " << (w == 0 ? "main" : "worker " + std::to_string(w)) << ": " << workerStats[w].jobs
+                    << " jobs, " << workerStats[w].steals << " steals, " << workerStats[w].idleMs << " ms idle\n";
+            cpuFrameMs = 0.0;
+            cpuFrames = 0;
+            cpuReportTime = currentFrame;
+        }
 
         glfwSwapBuffers(win);
         glfwPollEvents();
+
+        if (!firstFrameShown || (!texturesReported && pendingTextures(textureLoader) == 0)) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+            if (!firstFrameShown)
+                std::cout << "Startup to first frame: " << ms << " ms (" << pendingTextures(textureLoader)
+                    << " textures still loading, " << (syncTextures ? "sync" : "async") << ")\n";
+            if (pendingTextures(textureLoader) == 0) {
+                const TextureStreamStats& stream = textureLoader.stats;
+                std::cout << "All textures ready: " << ms << " ms (" << stream.bytes / (1024.0 * 1024.0) << " MB in "
+                    << stream.frames << " frames, max " << stream.maxFrameBytes / 1024 << " KB and "
+                    << stream.maxPumpMs << " ms upload per frame, worst frame " << worstLoadingFrame * 1000.0f << " ms)\n";
+                texturesReported = true;
+            }
+            firstFrameShown = true;
+        }
     }
 
+    shutdownUniformRing(sceneBlocks);
+    shutdownDynamicBuffer(frameData);
     glDeleteVertexArrays(1, &modelVAO);
     glDeleteVertexArrays(1, &lightVAO);
+    stopJobSystem(jobs);
+    destroySnowfallGL(snow);
     glDeleteVertexArrays(1, &sphereVAO);
     glDeleteVertexArrays(1, &terrainVAO);
     glDeleteVertexArrays(1, &skyboxVAO);
@@ -798,10 +910,18 @@ int main() {
     glDeleteBuffers(1, &skyboxEBO);
     if (normalTextureCastle) glDeleteTextures(1, &normalTextureCastle);
     if (normalTextureGrass) glDeleteTextures(1, &normalTextureGrass);
+    deleteTextures(textureCache);
+    glDeleteTextures(1, &whiteTexture);
     glDeleteTextures(1, &skyboxTexture);
     glDeleteProgram(prog);
     glDeleteProgram(skyProg);
+    glDeleteProgram(baryProg);
+    glDeleteProgram(terrainProg);
+    glDeleteProgram(terrainWireProg);
+    glDeleteProgram(terrainBaryProg);
+    glDeleteTextures(1, &heightmapTexture);
     if (texture) glDeleteTextures(1, &texture);
+    stopTextureLoader(textureLoader);
     glfwDestroyWindow(win);
     glDeleteProgram(wireProg);
     glfwTerminate();
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// Xorshift-multiply integer finalizer: every input bit flips each output bit about half the time, so
+// seeds, indices and counters hash to unrelated values.
+inline uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
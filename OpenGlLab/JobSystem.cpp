@@ -0,0 +1,152 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+
+// Queue of the current thread when it is one of jobs' workers.
+static thread_local const JobSystem* tJobSystem = nullptr;
+static thread_local size_t tQueue = 0;
+
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+// Own queue from the back (newest, still in cache), others from the front. False when every queue is empty.
+static bool runOneJob(JobSystem& jobs, size_t self) {
+    std::pair<std::function<void()>, JobCounter*> job;
+    bool found = false, stolen = false;
+    for (size_t k = 0; k < jobs.queues.size() && !found; ++k) {
+        JobQueue& q = *jobs.queues[(self + k) % jobs.queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.jobs.empty()) continue;
+        if (k == 0) {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+        }
+        else {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            stolen = true;
+        }
+        --jobs.queued;
+        found = true;
+    }
+    if (!found) return false;
+
+    job.first();
+    job.second->pending.fetch_sub(1, std::memory_order_release);
+    JobQueue& own = *jobs.queues[self];
+    own.jobsRun.fetch_add(1, std::memory_order_relaxed);
+    if (stolen) own.steals.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+static void workerLoop(JobSystem* jobs, size_t self) {
+    tJobSystem = jobs;
+    tQueue = self;
+    for (;;) {
+        if (runOneJob(*jobs, self)) continue;
+        const auto idleBegin = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(jobs->sleepMutex);
+            jobs->wake.wait(lock, [jobs] { return jobs->stopping || jobs->queued.load() > 0; });
+            if (jobs->stopping && jobs->queued.load() == 0) return;
+        }
+        jobs->queues[self]->idleNs.fetch_add(elapsedNs(idleBegin), std::memory_order_relaxed);
+    }
+}
+
+void startJobSystem(JobSystem& jobs, int threads) {
+    if (threads < 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) - 1;
+    jobs.stopping = false;
+    for (int i = 0; i <= threads; ++i) jobs.queues.emplace_back(new JobQueue());
+    for (int i = 1; i <= threads; ++i) jobs.workers.emplace_back(workerLoop, &jobs, static_cast<size_t>(i));
+}
+
+void stopJobSystem(JobSystem& jobs) {
+    {
+        std::lock_guard<std::mutex> lock(jobs.sleepMutex);
+        jobs.stopping = true;
+    }
+    jobs.wake.notify_all();
+    for (std::thread& t : jobs.workers) t.join();
+    jobs.workers.clear();
+    while (runOneJob(jobs, 0)) {}   // no workers: whatever was left runs here
+    jobs.queues.clear();
+}
+
+static void pushJob(JobSystem& jobs, JobCounter& counter, std::function<void()> job) {
+    size_t queue = 0;
+    if (tJobSystem == &jobs) queue = tQueue;
+    else if (jobs.queues.size() > 1) queue = 1 + jobs.nextQueue++ % (jobs.queues.size() - 1);
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    JobQueue& q = *jobs.queues[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.jobs.emplace_back(std::move(job), &counter);
+    ++jobs.queued;
+}
+
+static void wakeWorkers(JobSystem& jobs, size_t count) {
+    { std::lock_guard<std::mutex> lock(jobs.sleepMutex); }     // a worker between its check and wait sees the jobs
+    if (count == 1) jobs.wake.notify_one();
+    else jobs.wake.notify_all();
+}
+
+void submitJob(JobSystem& jobs, JobCounter& counter, std::function<void()> job) {
+    pushJob(jobs, counter, std::move(job));
+    wakeWorkers(jobs, 1);
+}
+
+void submitRange(JobSystem& jobs, JobCounter& counter, size_t count, size_t grain, size_t alignment,
+    const std::function<void(size_t, size_t)>& fn) {
+    alignment = std::max<size_t>(alignment, 1);
+    grain = std::max(grain, alignment) + alignment - 1;
+    grain -= grain % alignment;
+    size_t ranges = 0;
+    for (size_t begin = 0; begin < count; begin += grain, ++ranges) {
+        const size_t end = std::min(count, begin + grain);
+        pushJob(jobs, counter, [fn, begin, end] { fn(begin, end); });
+    }
+    if (ranges) wakeWorkers(jobs, ranges);
+}
+
+void waitForJobs(JobSystem& jobs, JobCounter& counter) {
+    const size_t self = tJobSystem == &jobs ? tQueue : 0;
+    while (counter.pending.load(std::memory_order_acquire) > 0) {
+        if (runOneJob(jobs, self)) continue;
+        const auto idleBegin = std::chrono::steady_clock::now();
+        std::this_thread::yield();
+        jobs.queues[self]->idleNs.fetch_add(elapsedNs(idleBegin), std::memory_order_relaxed);
+    }
+}
+
+void parallelFor(JobSystem* jobs, unsigned int threads, size_t count, size_t minItems,
+    const std::function<void(size_t, size_t)>& fn) {
+    if (jobs) threads = static_cast<unsigned int>(jobs->queues.size());
+    else if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t ranges = std::max<size_t>(1, std::min<size_t>(threads, count / std::max<size_t>(minItems, 1)));
+    if (ranges == 1) {
+        if (count) fn(0, count);
+        return;
+    }
+    if (jobs) {
+        JobCounter counter;
+        submitRange(*jobs, counter, count, (count + ranges - 1) / ranges, 1, fn);
+        waitForJobs(*jobs, counter);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (size_t r = 1; r < ranges; ++r) workers.emplace_back(fn, count * r / ranges, count * (r + 1) / ranges);
+    fn(0, count / ranges);
+    for (std::thread& t : workers) t.join();
+}
+
+std::vector<JobWorkerStats> jobStats(JobSystem& jobs, bool reset) {
+    std::vector<JobWorkerStats> stats(jobs.queues.size());
+    for (size_t i = 0; i < jobs.queues.size(); ++i) {
+        JobQueue& q = *jobs.queues[i];
+        stats[i].jobs = reset ? q.jobsRun.exchange(0) : q.jobsRun.load();
+        stats[i].steals = reset ? q.steals.exchange(0) : q.steals.load();
+        stats[i].idleMs = (reset ? q.idleNs.exchange(0) : q.idleNs.load()) / 1e6;
+    }
+    return stats;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the jobs of one batch still running; waitForJobs returns when it drops to zero.
+struct JobCounter {
+    std::atomic<int> pending{ 0 };
+};
+
+struct JobWorkerStats {
+    uint64_t jobs = 0;          // jobs run by this worker
+    uint64_t steals = 0;        // of those, taken from another worker's queue
+    double idleMs = 0.0;        // asleep (workers) or spinning in waitForJobs (the calling thread)
+};
+
+struct JobQueue {
+    std::mutex mutex;
+    std::deque<std::pair<std::function<void()>, JobCounter*>> jobs;
+    // Written by the owning thread only, read by jobStats.
+    std::atomic<uint64_t> jobsRun{ 0 }, steals{ 0 }, idleNs{ 0 };
+};
+
+// Work-stealing scheduler for per-frame work. Queue 0 belongs to the thread that started the system
+// (the render thread), which runs jobs too while it waits; queues 1.. belong to the workers. Each thread
+// takes its newest job first and, when its queue is empty, steals the oldest job of another queue, so
+// a batch split into ranges spreads over all threads without a central queue.
+struct JobSystem {
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<JobQueue>> queues;
+    std::atomic<int> queued{ 0 };       // jobs sitting in any queue
+    std::atomic<unsigned int> nextQueue{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+// threads < 0: one worker per hardware thread besides the calling one. With 0 workers every job runs
+// inside waitForJobs.
+void startJobSystem(JobSystem& jobs, int threads = -1);
+// Finishes whatever is queued, then joins the workers.
+void stopJobSystem(JobSystem& jobs);
+
+// Jobs submitted from a job go to its worker's queue; from other threads they are dealt round-robin.
+void submitJob(JobSystem& jobs, JobCounter& counter, std::function<void()> job);
+// [0, count) in ranges of grain items, grain rounded up to a multiple of alignment (so ranges of
+// float streams start on cache lines). fn(begin, end) for every range.
+void submitRange(JobSystem& jobs, JobCounter& counter, size_t count, size_t grain, size_t alignment,
+    const std::function<void(size_t, size_t)>& fn);
+// Runs queued jobs on the calling thread until counter reaches zero.
+void waitForJobs(JobSystem& jobs, JobCounter& counter);
+
+// fn(begin, end) over [0, count) in at most one range per thread, none shorter than minItems, and
+// returns when all are done. With jobs the ranges run as its jobs; without (tools and loaders that run
+// before the frame's JobSystem exists) on threads started for the call, threads of them (0 = every
+// hardware thread). A single range runs on the calling thread either way.
+void parallelFor(JobSystem* jobs, unsigned int threads, size_t count, size_t minItems,
+    const std::function<void(size_t, size_t)>& fn);
+
+// One entry per queue (0 = the calling thread); reset clears the counters afterwards.
+std::vector<JobWorkerStats> jobStats(JobSystem& jobs, bool reset = false);
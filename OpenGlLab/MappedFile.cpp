@@ -0,0 +1,94 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool mapFile(const char* path, MappedFile& file) {
+    file = MappedFile();
+    HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) {
+        std::cerr << "ERROR: Could not open file: " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size)) {
+        std::cerr << "ERROR: Could not stat file: " << path << std::endl;
+        CloseHandle(h);
+        return false;
+    }
+    file.fileHandle = h;
+    file.size = static_cast<size_t>(size.QuadPart);
+    if (file.size == 0) {
+        file.data = "";
+        return true;
+    }
+    HANDLE m = CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) {
+        std::cerr << "ERROR: Could not map file: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    file.mappingHandle = m;
+    file.data = static_cast<const char*>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+    if (!file.data) {
+        std::cerr << "ERROR: Could not map file: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    return true;
+}
+
+void unmapFile(MappedFile& file) {
+    if (file.data && file.size) UnmapViewOfFile(file.data);
+    if (file.mappingHandle) CloseHandle(file.mappingHandle);
+    if (file.fileHandle) CloseHandle(file.fileHandle);
+    file = MappedFile();
+}
+#else
+bool mapFile(const char* path, MappedFile& file) {
+    file = MappedFile();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "ERROR: Could not open file: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "ERROR: Could not stat file: " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    file.fd = fd;
+    file.size = static_cast<size_t>(st.st_size);
+    if (file.size == 0) {
+        file.data = "";
+        return true;
+    }
+    void* p = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "ERROR: Could not map file: " << path << std::endl;
+        unmapFile(file);
+        return false;
+    }
+    madvise(p, file.size, MADV_SEQUENTIAL);
+    file.data = static_cast<const char*>(p);
+    return true;
+}
+
+void unmapFile(MappedFile& file) {
+    if (file.data && file.size) munmap(const_cast<char*>(file.data), file.size);
+    if (file.fd >= 0) close(file.fd);
+    file = MappedFile();
+}
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+
+// Read-only view of a whole file mapped into memory.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// Prints the reason on failure; callers only need to give up.
+bool mapFile(const char* path, MappedFile& file);
+void unmapFile(MappedFile& file);
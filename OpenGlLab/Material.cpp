@@ -0,0 +1,136 @@
+#include "Material.h"
+#include "TextureCompress.h"
+#include "TextureMips.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+unsigned int loadTexture(const char* path, JobSystem* jobs) {
+    static const bool s3tc = hasS3TC();
+    CompressedTexture compressed;
+    if (s3tc && loadTextureCompressed(path, compressed, jobs)) return uploadCompressedTexture(compressed);
+
+    int width, height, nrChannels;
+    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
+    if (!data) {
+        std::cerr << "ERROR: Failed to load texture: " << path << std::endl;
+        return 0;
+    }
+    std::vector<std::vector<unsigned char>> levels(1);
+    levels[0].assign(data, data + static_cast<size_t>(width) * height * nrChannels);
+    stbi_image_free(data);
+    MipOptions mips;
+    mips.content = mipContentForPath(path);
+    mips.jobs = jobs;
+    buildMipChain(levels, width, height, nrChannels, mips);
+
+    GLenum format = (nrChannels == 3) ? GL_RGB : GL_RGBA;
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level < levels.size(); ++level) {
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, std::max(1, width >> level),
+            std::max(1, height >> level), 0, format, GL_UNSIGNED_BYTE, levels[level].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
+
+GLuint createSolidTexture(unsigned char r, unsigned char g, unsigned char b) {
+    const unsigned char pixel[4] = { r, g, b, 255 };
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return textureID;
+}
+
+GLuint getTexture(TextureCache& cache, const std::string& path, const unsigned char placeholder[3]) {
+    auto it = cache.textures.find(path);
+    if (it != cache.textures.end()) return it->second;
+    GLuint texture = cache.loader ? loadTextureAsync(*cache.loader, path.c_str(), placeholder) : loadTexture(path.c_str(), cache.jobs);
+    cache.textures[path] = texture;
+    return texture;
+}
+
+void deleteTextures(TextureCache& cache) {
+    for (auto& entry : cache.textures) {
+        if (entry.second) glDeleteTextures(1, &entry.second);
+    }
+    cache.textures.clear();
+}
+
+MaterialSet createMaterialSet(const std::vector<Material>& materials, TextureCache& cache,
+    const MaterialGL& fallback, GLuint white) {
+    MaterialSet set;
+    set.fallback = fallback;
+    for (const Material& m : materials) {
+        MaterialGL gl;
+        gl.diffuseColor = m.diffuse;
+        gl.diffuseMap = m.diffuseMap.empty() ? white : getTexture(cache, m.diffuseMap);
+        if (!gl.diffuseMap) gl.diffuseMap = fallback.diffuseMap;
+        if (!m.normalMap.empty()) {
+            gl.normalMap = getTexture(cache, m.normalMap, kPlaceholderNormal);
+            if (!gl.normalMap) gl.normalMap = fallback.normalMap;
+        }
+        set.materials.push_back(gl);
+    }
+    return set;
+}
+
+const MaterialGL& getMaterial(const MaterialSet& set, int material) {
+    if (material < 0 || material >= static_cast<int>(set.materials.size())) return set.fallback;
+    return set.materials[material];
+}
+
+std::vector<SubMesh> sortByMaterial(const std::vector<SubMesh>& subMeshes, const MaterialSet& set) {
+    std::vector<SubMesh> order = subMeshes;
+    std::stable_sort(order.begin(), order.end(), [&](const SubMesh& a, const SubMesh& b) {
+        const MaterialGL& ma = getMaterial(set, a.material);
+        const MaterialGL& mb = getMaterial(set, b.material);
+        return std::tie(ma.diffuseMap, ma.normalMap, ma.diffuseColor.x, ma.diffuseColor.y, ma.diffuseColor.z) <
+            std::tie(mb.diffuseMap, mb.normalMap, mb.diffuseColor.x, mb.diffuseColor.y, mb.diffuseColor.z);
+    });
+    return order;
+}
+
+void submitMaterials(RenderQueue& queue, const DrawPacket& packet, const MeshDraw& draw,
+    const std::vector<SubMesh>& order, const MaterialSet& set, UniformName diffuseColor) {
+    DrawPacket p = packet;
+    p.decode = &draw;
+    p.indexType = draw.indexType;
+    for (const SubMesh& sub : order) {
+        const MaterialGL& m = getMaterial(set, sub.material);
+        queueUniform(queue, diffuseColor, m.diffuseColor);
+        p.materialUniforms = takeUniformSet(queue);
+        p.textures[0] = m.diffuseMap;
+        p.textures[1] = m.normalMap;
+        p.range = sub;
+        submitDraw(queue, p);
+    }
+}
+
+RenderStats countMaterialBinds(const std::vector<SubMesh>& order, const MaterialSet& set, bool skipRedundant) {
+    RenderStats stats;
+    GLuint units[2] = { GLuint(-1), GLuint(-1) };
+    for (const SubMesh& sub : order) {
+        const MaterialGL& m = getMaterial(set, sub.material);
+        const GLuint textures[2] = { m.diffuseMap, m.normalMap };
+        for (int unit = 0; unit < 2; ++unit) {
+            if (skipRedundant && units[unit] == textures[unit]) continue;
+            units[unit] = textures[unit];
+            ++stats.textureBinds;
+        }
+        ++stats.drawCalls;
+    }
+    return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include "Mesh.h"
+#include "MeshPacking.h"
+#include "RenderQueue.h"
+#include "TextureLoader.h"
+#include <map>
+#include <string>
+#include <vector>
+
+struct JobSystem;
+
+// Mip chain and compression run as jobs on jobs when given.
+unsigned int loadTexture(const char* path, JobSystem* jobs = nullptr);
+GLuint createSolidTexture(unsigned char r, unsigned char g, unsigned char b);
+
+// Loads every texture file once, however many materials use it. With a loader the textures decode
+// in the background; without one they load synchronously.
+struct TextureCache {
+    std::map<std::string, GLuint> textures;
+    TextureLoader* loader = nullptr;
+    JobSystem* jobs = nullptr;          // for synchronous loads
+};
+// 0 when a synchronous load fails; asynchronous loads keep the placeholder instead.
+GLuint getTexture(TextureCache& cache, const std::string& path, const unsigned char placeholder[3] = kPlaceholderWhite);
+void deleteTextures(TextureCache& cache);
+
+struct MaterialGL {
+    GLuint diffuseMap = 0;
+    GLuint normalMap = 0;       // 0 disables normal mapping in shader.frag
+    glm::vec3 diffuseColor = glm::vec3(1.0f);
+};
+
+// GL materials of one mesh, indexed by SubMesh::material; fallback serves triangles without usemtl.
+struct MaterialSet {
+    std::vector<MaterialGL> materials;
+    MaterialGL fallback;
+};
+
+// Materials without map_Kd draw the white texture tinted by Kd; maps that fail to load use the
+// fallback's textures instead.
+MaterialSet createMaterialSet(const std::vector<Material>& materials, TextureCache& cache,
+    const MaterialGL& fallback, GLuint white);
+const MaterialGL& getMaterial(const MaterialSet& set, int material);
+
+// Sub-meshes ordered by (diffuse map, normal map, color), so consecutive draws share textures.
+std::vector<SubMesh> sortByMaterial(const std::vector<SubMesh>& subMeshes, const MaterialSet& set);
+
+// Queues the sub-meshes in the given order as render queue packets, each with its material: packet
+// supplies everything but the range, the textures (diffuse on unit 0, normal map on unit 1) and the
+// material uniform set (Kd in diffuseColor).
+void submitMaterials(RenderQueue& queue, const DrawPacket& packet, const MeshDraw& draw,
+    const std::vector<SubMesh>& order, const MaterialSet& set, UniformName diffuseColor);
+
+// Draw calls and texture binds drawing that order one sub-mesh after another would take, with or
+// without skipping redundant binds; touches no GL.
+RenderStats countMaterialBinds(const std::vector<SubMesh>& order, const MaterialSet& set, bool skipRedundant);
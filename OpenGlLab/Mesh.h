@@ -0,0 +1,93 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    // xyz along +u, w = +-1 with bitangent = w * cross(Normal, Tangent.xyz) (the MikkTSpace convention).
+    // Loaders leave it zero; computeTangents (MeshTangents.h) fills it.
+    glm::vec4 Tangent = glm::vec4(0.0f);
+};
+
+// Stream loader: getline + istringstream per line.
+bool loadOBJ(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Memory-mapped loader: tokenizes the file in place (no std::string, streams or exceptions).
+// Produces the same vertices/indices as loadOBJ; additionally resolves negative (relative) indices.
+bool loadOBJMapped(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+bool parseOBJ(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+struct JobSystem;
+
+struct ObjLoadOptions {
+    JobSystem* jobs = nullptr;  // chunk passes run as its jobs, one chunk per thread of it; small files use fewer
+    unsigned int threads = 0;   // without jobs: threads started per pass, 0 = every hardware thread
+    bool weld = false;          // share one vertex per distinct (v, vt, vn) corner
+    bool optimize = false;      // with weld: reorder for the post-transform cache and vertex fetch
+    bool quantize = false;      // loadMeshCached only: store PackedVertex instead of Vertex
+};
+
+// Contiguous run of triangles that share one material.
+struct MaterialRange {
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    int material;               // index into ObjMaterialInfo::names, -1 before the first usemtl
+};
+
+// mtllib/usemtl statements of an OBJ.
+struct ObjMaterialInfo {
+    std::vector<std::string> libraries;     // mtllib arguments as written, relative to the OBJ
+    std::vector<std::string> names;         // usemtl names in order of first use
+    std::vector<MaterialRange> ranges;      // one per material, in material order
+};
+
+// Parallel variant of loadOBJMapped: the file is split at newline boundaries, chunks are parsed on
+// worker threads and stitched with prefix sums over the attribute counts, so absolute and relative
+// indices resolve exactly as in the serial pass. Without weld the output is identical to loadOBJMapped;
+// with weld it describes the same triangles through a shared-vertex index buffer.
+// Passing materials groups the triangles by material (stable within a material) and fills the ranges;
+// optimize then works on each range separately.
+bool loadOBJParallel(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+    const ObjLoadOptions& options = ObjLoadOptions(), ObjMaterialInfo* materials = nullptr);
+bool parseOBJParallel(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+    const ObjLoadOptions& options = ObjLoadOptions(), ObjMaterialInfo* materials = nullptr);
+
+struct Material {
+    std::string name;
+    glm::vec3 diffuse = glm::vec3(1.0f);    // Kd
+    std::string diffuseMap;                 // map_Kd, resolved to an existing file or empty
+    std::string normalMap;                  // map_Bump / bump / norm, resolved the same way
+};
+
+// Parses newmtl, Kd, map_Kd and bump maps. Texture paths are looked up as written, then relative to
+// the MTL's directory (also by their last directory + file name, for absolute paths from other machines).
+bool loadMTL(const char* path, std::vector<Material>& materials);
+// Materials for the OBJ's usemtl names, in id order, from its mtllib files. Names that no library
+// defines keep the defaults.
+void loadOBJMaterials(const char* objPath, const std::vector<std::string>& libraries,
+    const std::vector<std::string>& names, std::vector<Material>& materials);
+
+// Vertex/index buffer sizes and post-transform cache behaviour (FIFO cache of cacheSize entries).
+struct MeshStats {
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    size_t vboBytes = 0;
+    size_t eboBytes = 0;
+    float acmr = 0.0f;      // cache misses per triangle (1.0 is ideal for big meshes, 3.0 is worst)
+    float atvr = 0.0f;      // cache misses per vertex (1.0 is ideal)
+    float hitRate = 0.0f;   // fraction of indices served from the cache
+};
+
+// Forsyth-style post-transform cache optimization: greedily emits the triangle with the best score
+// under a simulated 32-entry LRU cache. Rewrites the triangle order in place.
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+// Renumbers vertices in first-use order of the index buffer so fetches walk the VBO linearly.
+// Unreferenced vertices are dropped. Returns the new vertex count.
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+MeshStats computeMeshStats(size_t vertexCount, const std::vector<unsigned int>& indices, unsigned int cacheSize = 32);
+void printMeshStats(const char* label, const MeshStats& stats);
@@ -0,0 +1,280 @@
+#include "MeshCache.h"
+#include "JobSystem.h"
+#include "MeshTangents.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static std::string cachePathFor(const char* objPath) {
+    return std::string(objPath) + ".meshbin";
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// 64-bit multiply/rotate hash over 8-byte words; not cryptographic, only used to detect edits.
+uint64_t hashBytes(const void* data, size_t size) {
+    const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = 0xCBF29CE484222325ull ^ (size * kMul);
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t w;
+        std::memcpy(&w, p + i * 8, 8);
+        h = (h ^ w) * kMul;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + words * 8, size - words * 8);
+    h = (h ^ tail) * kMul;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return h;
+}
+
+static void copyVec3(const glm::vec3& v, float out[3]) {
+    out[0] = v.x; out[1] = v.y; out[2] = v.z;
+}
+
+bool writeMeshCache(const char* cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags,
+    const PackedMesh& mesh, const ObjMaterialInfo& materials) {
+    const MeshData data = mesh.view();
+    const uint64_t vertexBytes = uint64_t(data.vertexCount) * data.vertexStride;
+    const uint64_t indexBytes = uint64_t(data.indexCount) * data.indexSize;
+    const uint64_t subMeshBytes = uint64_t(data.subMeshCount) * sizeof(SubMesh);
+    std::string strings;
+    for (const std::string& library : materials.libraries) strings.append(library).push_back('\0');
+    for (const std::string& name : materials.names) strings.append(name).push_back('\0');
+
+    MeshCacheHeader header = {};
+    header.magic = kMeshCacheMagic;
+    header.version = kMeshCacheVersion;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.flags = flags;
+    header.vertexFormat = data.format;
+    header.vertexStride = data.vertexStride;
+    header.indexSize = data.indexSize;
+    header.vertexCount = static_cast<uint32_t>(data.vertexCount);
+    header.indexCount = static_cast<uint32_t>(data.indexCount);
+    header.subMeshCount = static_cast<uint32_t>(data.subMeshCount);
+    header.libraryCount = static_cast<uint32_t>(materials.libraries.size());
+    header.materialCount = static_cast<uint32_t>(materials.names.size());
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+    header.vertexOffset = alignUp(sizeof(MeshCacheHeader), kMeshCacheAlignment);
+    header.indexOffset = alignUp(header.vertexOffset + vertexBytes, kMeshCacheAlignment);
+    header.subMeshOffset = alignUp(header.indexOffset + indexBytes, kMeshCacheAlignment);
+    header.stringOffset = header.subMeshOffset + subMeshBytes;
+    copyVec3(data.posScale, header.posScale);
+    copyVec3(data.posOffset, header.posOffset);
+    copyVec3(data.boundsMin, header.boundsMin);
+    copyVec3(data.boundsMax, header.boundsMax);
+
+    // Write to a temporary file and rename, so a crash never leaves a half-written cache behind.
+    std::string tmpPath = std::string(cachePath) + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "ERROR: Could not write mesh cache: " << cachePath << std::endl;
+            return false;
+        }
+        static const char zeros[kMeshCacheAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(zeros, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+        out.write(static_cast<const char*>(data.vertexData), static_cast<std::streamsize>(vertexBytes));
+        out.write(zeros, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - vertexBytes));
+        out.write(static_cast<const char*>(data.indexData), static_cast<std::streamsize>(indexBytes));
+        out.write(zeros, static_cast<std::streamsize>(header.subMeshOffset - header.indexOffset - indexBytes));
+        out.write(reinterpret_cast<const char*>(data.subMeshes), static_cast<std::streamsize>(subMeshBytes));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        if (!out.good()) {
+            std::cerr << "ERROR: Could not write mesh cache: " << cachePath << std::endl;
+            out.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, cachePath, ec);
+    if (ec) {
+        std::cerr << "ERROR: Could not write mesh cache: " << cachePath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Splits count NUL-terminated strings off the front of [p, end).
+static bool readStrings(const char*& p, const char* end, uint32_t count, std::vector<std::string>& out) {
+    for (uint32_t i = 0; i < count; ++i) {
+        const char* nul = static_cast<const char*>(std::memchr(p, '\0', static_cast<size_t>(end - p)));
+        if (!nul) return false;
+        out.emplace_back(p, nul);
+        p = nul + 1;
+    }
+    return true;
+}
+
+// Maps cachePath into mesh if it is a complete cache for the given source hash/size and flags.
+static bool mapMeshCache(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags,
+    CachedMesh& mesh, ObjMaterialInfo& materials) {
+    std::error_code ec;
+    if (!fs::exists(cachePath, ec)) return false;
+    MappedFile file;
+    if (!mapFile(cachePath.c_str(), file)) return false;
+
+    MeshCacheHeader header;
+    bool valid = file.size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, file.data, sizeof(header));
+        const uint32_t expectedStride = header.vertexFormat == VERTEX_FORMAT_QUANTIZED ? sizeof(PackedVertex) : sizeof(Vertex);
+        valid = header.magic == kMeshCacheMagic && header.version == kMeshCacheVersion &&
+            header.sourceHash == sourceHash && header.sourceSize == sourceSize && header.flags == flags &&
+            header.vertexFormat <= VERTEX_FORMAT_QUANTIZED && header.vertexStride == expectedStride &&
+            (header.indexSize == 2 || header.indexSize == 4) &&
+            header.vertexOffset % kMeshCacheAlignment == 0 && header.indexOffset % kMeshCacheAlignment == 0 &&
+            header.subMeshOffset % kMeshCacheAlignment == 0 &&
+            header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride <= header.indexOffset &&
+            header.indexOffset + uint64_t(header.indexCount) * header.indexSize <= header.subMeshOffset &&
+            header.subMeshOffset + uint64_t(header.subMeshCount) * sizeof(SubMesh) <= header.stringOffset &&
+            header.stringOffset + header.stringBytes <= file.size;
+    }
+    if (valid) {
+        const char* strings = file.data + header.stringOffset;
+        const char* stringsEnd = strings + header.stringBytes;
+        materials = ObjMaterialInfo();
+        valid = readStrings(strings, stringsEnd, header.libraryCount, materials.libraries) &&
+            readStrings(strings, stringsEnd, header.materialCount, materials.names);
+    }
+    if (!valid) {
+        unmapFile(file);
+        return false;
+    }
+    mesh.file = file;
+    MeshData& data = mesh.data;
+    data.format = static_cast<VertexFormat>(header.vertexFormat);
+    data.vertexData = file.data + header.vertexOffset;
+    data.vertexCount = header.vertexCount;
+    data.vertexStride = header.vertexStride;
+    data.indexData = file.data + header.indexOffset;
+    data.indexCount = header.indexCount;
+    data.indexSize = header.indexSize;
+    data.subMeshes = reinterpret_cast<const SubMesh*>(file.data + header.subMeshOffset);
+    data.subMeshCount = header.subMeshCount;
+    data.posScale = glm::vec3(header.posScale[0], header.posScale[1], header.posScale[2]);
+    data.posOffset = glm::vec3(header.posOffset[0], header.posOffset[1], header.posOffset[2]);
+    data.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    data.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    mesh.fromCache = true;
+    return true;
+}
+
+bool loadMeshCached(const char* objPath, const ObjLoadOptions& options, CachedMesh& mesh) {
+    closeCachedMesh(mesh);
+    MappedFile source;
+    if (!mapFile(objPath, source)) return false;
+    const uint64_t sourceHash = hashBytes(source.data, source.size);
+    const uint64_t sourceSize = source.size;
+    uint32_t flags = 0;
+    if (options.weld) flags |= MESH_CACHE_WELDED;
+    if (options.weld && options.optimize) flags |= MESH_CACHE_OPTIMIZED;
+    if (options.quantize) flags |= MESH_CACHE_QUANTIZED;
+    const std::string cachePath = cachePathFor(objPath);
+
+    ObjMaterialInfo materials;
+    if (mapMeshCache(cachePath, sourceHash, sourceSize, flags, mesh, materials)) {
+        unmapFile(source);
+        loadOBJMaterials(objPath, materials.libraries, materials.names, mesh.materials);
+        return true;
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    bool ok = parseOBJParallel(source.data, source.size, vertices, indices, options, &materials);
+    unmapFile(source);
+    if (!ok) return false;
+    if (options.jobs) {
+        computeTangents(vertices, indices, *options.jobs);
+    }
+    else {
+        JobSystem jobs;
+        startJobSystem(jobs, options.threads ? static_cast<int>(options.threads) - 1 : -1);
+        computeTangents(vertices, indices, jobs);
+        stopJobSystem(jobs);
+    }
+    packMesh(vertices, indices, materials.ranges, options.quantize, mesh.owned);
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+
+    ObjMaterialInfo mapped;
+    if (writeMeshCache(cachePath.c_str(), sourceHash, sourceSize, flags, mesh.owned, materials) &&
+        mapMeshCache(cachePath, sourceHash, sourceSize, flags, mesh, mapped)) {
+        mesh.owned = PackedMesh();
+    }
+    else {
+        // Cache not writable: serve the packed data from memory.
+        mesh.data = mesh.owned.view();
+    }
+    mesh.fromCache = false;
+    loadOBJMaterials(objPath, materials.libraries, materials.names, mesh.materials);
+    return true;
+}
+
+void closeCachedMesh(CachedMesh& mesh) {
+    unmapFile(mesh.file);
+    mesh = CachedMesh();
+}
+
+static bool isObjFile(const fs::path& p) {
+    std::string ext = p.extension().string();
+    return ext == ".obj" || ext == ".OBJ";
+}
+
+int convertOBJFiles(const char* path, const ObjLoadOptions& options) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && isObjFile(it->path())) files.push_back(it->path());
+        }
+    }
+    else {
+        files.push_back(path);
+    }
+    if (files.empty()) {
+        std::cerr << "No OBJ files found in " << path << std::endl;
+        return 1;
+    }
+
+    // One pool for the whole batch instead of threads per file and pass.
+    JobSystem jobs;
+    ObjLoadOptions batchOptions = options;
+    if (!batchOptions.jobs) {
+        startJobSystem(jobs, batchOptions.threads ? static_cast<int>(batchOptions.threads) - 1 : -1);
+        batchOptions.jobs = &jobs;
+    }
+    int failed = 0;
+    for (const fs::path& file : files) {
+        std::string objPath = file.string();
+        auto t0 = std::chrono::steady_clock::now();
+        CachedMesh mesh;
+        if (!loadMeshCached(objPath.c_str(), batchOptions, mesh)) {
+            ++failed;
+            continue;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << objPath << ": " << mesh.data.vertexCount << " vertices, " << mesh.data.indexCount / 3 << " triangles, "
+            << mesh.data.subMeshCount << " sub-meshes, " << (mesh.fromCache ? "cache up to date" : "converted") << " (" << ms << " ms)\n";
+        closeCachedMesh(mesh);
+    }
+    stopJobSystem(jobs);
+    return failed ? 1 : 0;
+}
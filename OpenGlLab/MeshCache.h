@@ -0,0 +1,70 @@
+#pragma once
+#include "Mesh.h"
+#include "MeshPacking.h"
+#include "MappedFile.h"
+#include <cstdint>
+
+// Binary mesh cache (<source>.meshbin):
+//   MeshCacheHeader | vertex blob | index blob | SubMesh[subMeshCount] | strings
+// strings holds the mtllib names followed by the usemtl names, each NUL-terminated.
+// The blobs are already in the packed GPU layout (see MeshPacking.h) and start on
+// kMeshCacheAlignment boundaries, so the mapped file can be handed to glBufferData as-is.
+// The header carries a content hash of the source OBJ; any change invalidates the cache.
+const uint32_t kMeshCacheMagic = 0x4D4C474F;   // "OGLM"
+const uint32_t kMeshCacheVersion = 4;
+const uint32_t kMeshCacheAlignment = 64;
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t flags;             // MESH_CACHE_* load options baked into the blobs
+    uint32_t vertexFormat;      // VertexFormat
+    uint32_t vertexStride;
+    uint32_t indexSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t subMeshCount;
+    uint32_t libraryCount;
+    uint32_t materialCount;
+    uint32_t stringBytes;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t subMeshOffset;
+    uint64_t stringOffset;
+    float posScale[3];
+    float posOffset[3];
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+enum MeshCacheFlags {
+    MESH_CACHE_WELDED = 1,
+    MESH_CACHE_OPTIMIZED = 2,
+    MESH_CACHE_QUANTIZED = 4
+};
+
+// Mesh data either mapped straight from a cache file or, when the cache could not be written,
+// owned in memory. data points at whichever one is in use. materials is indexed by SubMesh::material
+// and is read from the MTL files on every load, so material edits need no cache rebuild.
+struct CachedMesh {
+    MeshData data;
+    std::vector<Material> materials;
+    bool fromCache = false;
+    MappedFile file;
+    PackedMesh owned;
+};
+
+uint64_t hashBytes(const void* data, size_t size);
+
+// Maps objPath's cache when it matches the OBJ contents and options; otherwise parses and packs
+// the OBJ, rewrites the cache and maps that.
+bool loadMeshCached(const char* objPath, const ObjLoadOptions& options, CachedMesh& mesh);
+void closeCachedMesh(CachedMesh& mesh);
+
+bool writeMeshCache(const char* cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t flags,
+    const PackedMesh& mesh, const ObjMaterialInfo& materials);
+
+// Batch converter: writes a cache next to every .obj under path (file or directory, recursive).
+int convertOBJFiles(const char* path, const ObjLoadOptions& options);
@@ -0,0 +1,164 @@
+#include "Mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ---- Vertex cache optimization (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation") ----
+
+const int kForsythCacheSize = 32;
+
+static float forsythVertexScore(int cachePosition, unsigned int liveTriangles) {
+    if (liveTriangles == 0) return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = 0.75f;   // the last triangle's vertices: fixed score so it is not simply repeated
+        }
+        else {
+            float scaler = 1.0f / (kForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+        }
+    }
+    // Favor vertices with few triangles left so they get finished and leave the working set.
+    score += 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+    return score;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Vertex -> triangle adjacency (CSR); each vertex keeps its live triangles in the front of its range.
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices) ++liveTriangles[index];
+    std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t t = 0; t < triangleCount; ++t)
+            for (int k = 0; k < 3; ++k) adjacency[cursor[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = forsythVertexScore(-1, liveTriangles[v]);
+
+    std::vector<char> emitted(triangleCount, 0);
+    long long best = -1;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const unsigned int* tri = &indices[3 * t];
+        float score = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+        if (score > bestScore) { bestScore = score; best = static_cast<long long>(t); }
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    unsigned int cache[kForsythCacheSize + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+
+    for (size_t n = 0; n < triangleCount; ++n) {
+        if (best < 0) {
+            // Nothing in the cache has work left: continue with the next unused triangle.
+            while (emitted[scanCursor]) ++scanCursor;
+            best = static_cast<long long>(scanCursor);
+        }
+        const size_t t = static_cast<size_t>(best);
+        const unsigned int tri[3] = { indices[3 * t], indices[3 * t + 1], indices[3 * t + 2] };
+        output.push_back(tri[0]);
+        output.push_back(tri[1]);
+        output.push_back(tri[2]);
+        emitted[t] = 1;
+
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = tri[k];
+            unsigned int* begin = &adjacency[adjacencyOffset[v]];
+            unsigned int* end = begin + liveTriangles[v];
+            unsigned int* it = std::find(begin, end, static_cast<unsigned int>(t));
+            if (it != end) {
+                std::swap(*it, *(end - 1));
+                --liveTriangles[v];
+            }
+        }
+
+        // New cache: this triangle's vertices in front, then the previous contents minus duplicates.
+        unsigned int newCache[kForsythCacheSize + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k) newCache[newCount++] = tri[k];
+        for (int i = 0; i < cacheCount; ++i) {
+            unsigned int v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+        }
+        for (int i = 0; i < newCount; ++i) {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < kForsythCacheSize ? i : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], liveTriangles[v]);
+        }
+
+        // Rescore triangles touching the cache and pick the best one among them.
+        cacheCount = std::min(newCount, kForsythCacheSize);
+        best = -1;
+        bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; ++i) {
+            unsigned int v = newCache[i];
+            const unsigned int* adj = &adjacency[adjacencyOffset[v]];
+            for (unsigned int a = 0; a < liveTriangles[v]; ++a) {
+                unsigned int other = adj[a];
+                const unsigned int* o = &indices[3 * other];
+                float score = vertexScore[o[0]] + vertexScore[o[1]] + vertexScore[o[2]];
+                if (score > bestScore) { bestScore = score; best = other; }
+            }
+        }
+
+        std::copy(newCache, newCache + cacheCount, cache);
+    }
+    indices.swap(output);
+}
+
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int kUnused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), kUnused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (unsigned int& index : indices) {
+        if (remap[index] == kUnused) {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+    return vertices.size();
+}
+
+MeshStats computeMeshStats(size_t vertexCount, const std::vector<unsigned int>& indices, unsigned int cacheSize) {
+    MeshStats stats;
+    stats.vertexCount = vertexCount;
+    stats.triangleCount = indices.size() / 3;
+    stats.vboBytes = vertexCount * sizeof(Vertex);
+    stats.eboBytes = indices.size() * sizeof(unsigned int);
+    if (indices.empty() || vertexCount == 0) return stats;
+
+    // FIFO cache: a vertex is resident while fewer than cacheSize misses happened since it was loaded.
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    for (unsigned int index : indices) {
+        unsigned int t = loadedAt[index];
+        if (t == 0 || misses + 1 - t > cacheSize) {
+            ++misses;
+            loadedAt[index] = misses;
+        }
+    }
+    stats.acmr = static_cast<float>(misses) / stats.triangleCount;
+    stats.atvr = static_cast<float>(misses) / vertexCount;
+    stats.hitRate = 1.0f - static_cast<float>(misses) / indices.size();
+    return stats;
+}
+
+void printMeshStats(const char* label, const MeshStats& stats) {
+    std::cout << label << ": " << stats.vertexCount << " vertices, " << stats.triangleCount << " triangles, VBO "
+        << stats.vboBytes / 1024 << " KB, EBO " << stats.eboBytes / 1024 << " KB, ACMR " << stats.acmr
+        << ", ATVR " << stats.atvr << ", cache hits " << stats.hitRate * 100.0f << "%\n";
+}
@@ -0,0 +1,318 @@
+#include "MeshPacking.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+const size_t kMaxShortVertices = 65535;
+
+MeshData PackedMesh::view() const {
+    MeshData data;
+    data.format = format;
+    data.vertexData = vertexData.data();
+    data.vertexCount = vertexCount;
+    data.vertexStride = format == VERTEX_FORMAT_QUANTIZED ? sizeof(PackedVertex) : sizeof(Vertex);
+    data.indexData = indexData.data();
+    data.indexCount = indexCount;
+    data.indexSize = indexSize;
+    data.subMeshes = subMeshes.data();
+    data.subMeshCount = subMeshes.size();
+    data.posScale = posScale;
+    data.posOffset = posOffset;
+    data.boundsMin = boundsMin;
+    data.boundsMax = boundsMax;
+    return data;
+}
+
+// Round-to-nearest-even float -> IEEE half.
+static uint16_t floatToHalf(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000u;
+    uint32_t mantissa = x & 0x7FFFFFu;
+    int exponent = static_cast<int>((x >> 23) & 0xFF);
+    if (exponent == 255) return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    int e = exponent - 127 + 15;
+    if (e >= 31) return static_cast<uint16_t>(sign | 0x7C00u);
+    if (e <= 0) {
+        if (e < -10) return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        int shift = 14 - e;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1))) ++half;
+    return static_cast<uint16_t>(sign | half);
+}
+
+static float halfToFloat(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x3FFu;
+    uint32_t x;
+    if (exponent == 0) {
+        float f = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -f : f;
+    }
+    if (exponent == 31) x = sign | 0x7F800000u | (mantissa << 13);
+    else x = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline int16_t quantizeSnorm(float v) {
+    v = std::max(-1.0f, std::min(1.0f, v));
+    return static_cast<int16_t>(std::lround(v * 32767.0f));
+}
+
+void octEncode(const glm::vec3& n, int16_t out[2]) {
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 <= 0.0f) { out[0] = out[1] = 0; return; }
+    float x = n.x / l1;
+    float y = n.y / l1;
+    if (n.z < 0.0f) {
+        float ox = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float oy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = ox;
+        y = oy;
+    }
+    out[0] = quantizeSnorm(x);
+    out[1] = quantizeSnorm(y);
+}
+
+static glm::vec3 octDecode(const int16_t in[2]) {
+    glm::vec3 n(in[0] / 32767.0f, in[1] / 32767.0f, 0.0f);
+    n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+    if (n.z < 0.0f) {
+        float x = (1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        float y = (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        n.x = x;
+        n.y = y;
+    }
+    return glm::normalize(n);
+}
+
+static void appendVertex(const Vertex& v, PackedMesh& out) {
+    if (out.format == VERTEX_FORMAT_FLOAT) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+        out.vertexData.insert(out.vertexData.end(), bytes, bytes + sizeof(Vertex));
+        return;
+    }
+    PackedVertex p;
+    for (int k = 0; k < 3; ++k) {
+        float s = out.posScale[k];
+        p.position[k] = s > 0.0f ? static_cast<int16_t>(std::lround((v.Position[k] - out.posOffset[k]) / s)) : 0;
+    }
+    p.position[3] = v.Tangent.w < 0.0f ? -1 : 1;
+    octEncode(v.Normal, p.normal);
+    p.texCoords[0] = floatToHalf(v.TexCoords.x);
+    p.texCoords[1] = floatToHalf(v.TexCoords.y);
+    octEncode(glm::vec3(v.Tangent), p.tangent);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&p);
+    out.vertexData.insert(out.vertexData.end(), bytes, bytes + sizeof(PackedVertex));
+}
+
+void packMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    const std::vector<MaterialRange>& ranges, bool quantize, PackedMesh& out) {
+    out = PackedMesh();
+    out.format = quantize ? VERTEX_FORMAT_QUANTIZED : VERTEX_FORMAT_FLOAT;
+    out.indexSize = 2;
+    out.indexCount = indices.size();
+
+    if (!vertices.empty()) out.boundsMin = out.boundsMax = vertices[0].Position;
+    for (const Vertex& v : vertices) {
+        out.boundsMin = glm::min(out.boundsMin, v.Position);
+        out.boundsMax = glm::max(out.boundsMax, v.Position);
+    }
+    if (quantize) {
+        out.posOffset = (out.boundsMin + out.boundsMax) * 0.5f;
+        out.posScale = (out.boundsMax - out.boundsMin) * (0.5f / 32767.0f);
+    }
+
+    std::vector<MaterialRange> allRanges = ranges;
+    if (allRanges.empty()) allRanges.push_back({ 0, static_cast<unsigned int>(indices.size()), -1 });
+
+    const size_t vertexStride = quantize ? sizeof(PackedVertex) : sizeof(Vertex);
+    out.vertexData.reserve(vertices.size() * vertexStride);
+    out.indexData.resize(indices.size() * sizeof(uint16_t));
+    uint16_t* shortIndices = reinterpret_cast<uint16_t*>(out.indexData.data());
+
+    if (vertices.size() <= kMaxShortVertices) {
+        for (const Vertex& v : vertices) appendVertex(v, out);
+        for (size_t i = 0; i < indices.size(); ++i) shortIndices[i] = static_cast<uint16_t>(indices[i]);
+        out.vertexCount = vertices.size();
+        for (const MaterialRange& r : allRanges)
+            out.subMeshes.push_back({ r.indexOffset, r.indexCount, 0, static_cast<uint32_t>(vertices.size()), r.material });
+        return;
+    }
+
+    // Split in triangle order into 16-bit windows; vertices shared across a split are duplicated into
+    // both windows. A material change starts a new sub-mesh but keeps the current window.
+    std::vector<int> owner(vertices.size(), -1);
+    std::vector<uint16_t> local(vertices.size(), 0);
+    int window = 0;
+    int32_t windowBase = 0;
+    uint32_t windowCount = 0;
+    for (const MaterialRange& r : allRanges) {
+        SubMesh current = { r.indexOffset, 0, windowBase, 0, r.material };
+        for (size_t t = r.indexOffset; t + 2 < size_t(r.indexOffset) + r.indexCount; t += 3) {
+            uint32_t added = 0;
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[t + k];
+                bool seen = owner[v] == window;
+                for (int j = 0; j < k && !seen; ++j) seen = indices[t + j] == v;
+                if (!seen) ++added;
+            }
+            if (windowCount + added > kMaxShortVertices) {
+                if (current.indexCount) {
+                    current.vertexCount = windowCount;
+                    out.subMeshes.push_back(current);
+                }
+                windowBase += static_cast<int32_t>(windowCount);
+                windowCount = 0;
+                ++window;
+                current = { static_cast<uint32_t>(t), 0, windowBase, 0, r.material };
+            }
+            for (int k = 0; k < 3; ++k) {
+                unsigned int v = indices[t + k];
+                if (owner[v] != window) {
+                    owner[v] = window;
+                    local[v] = static_cast<uint16_t>(windowCount++);
+                    appendVertex(vertices[v], out);
+                }
+                shortIndices[t + k] = local[v];
+            }
+            current.indexCount += 3;
+        }
+        if (current.indexCount) {
+            current.vertexCount = windowCount;
+            out.subMeshes.push_back(current);
+        }
+    }
+    out.vertexCount = out.vertexData.size() / vertexStride;
+}
+
+Vertex unpackVertex(const MeshData& mesh, size_t index) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(mesh.vertexData) + index * mesh.vertexStride;
+    Vertex v;
+    if (mesh.format == VERTEX_FORMAT_FLOAT) {
+        std::memcpy(&v, bytes, sizeof(Vertex));
+        return v;
+    }
+    if (mesh.format == VERTEX_FORMAT_GRID) {
+        GridVertex g;
+        std::memcpy(&g, bytes, sizeof(GridVertex));
+        v.Position = glm::vec3(g.position[0], g.position[1], g.position[2]);
+        v.Normal = glm::vec3(0.0f);
+        v.TexCoords = glm::vec2(0.0f);
+        v.Tangent = glm::vec4(0.0f);
+        return v;
+    }
+    PackedVertex p;
+    std::memcpy(&p, bytes, sizeof(PackedVertex));
+    for (int k = 0; k < 3; ++k) v.Position[k] = p.position[k] * mesh.posScale[k] + mesh.posOffset[k];
+    v.Normal = octDecode(p.normal);
+    v.TexCoords = glm::vec2(halfToFloat(p.texCoords[0]), halfToFloat(p.texCoords[1]));
+    v.Tangent = glm::vec4(octDecode(p.tangent), p.position[3] < 0 ? -1.0f : 1.0f);
+    return v;
+}
+
+void printPackStats(const char* label, const MeshData& packed) {
+    size_t vboBefore = packed.vertexCount * sizeof(Vertex);
+    size_t eboBefore = packed.indexCount * sizeof(unsigned int);
+    size_t vboAfter = packed.vertexCount * packed.vertexStride;
+    size_t eboAfter = packed.indexCount * packed.indexSize;
+    std::cout << label << ": VBO " << vboBefore / 1024 << " KB -> " << vboAfter / 1024 << " KB, EBO "
+        << eboBefore / 1024 << " KB -> " << eboAfter / 1024 << " KB ("
+        << packed.subMeshCount << (packed.subMeshCount == 1 ? " range" : " ranges") << ", "
+        << packed.indexSize * 8 << "-bit), saved " << (vboBefore + eboBefore - vboAfter - eboAfter) / 1024
+        << " KB of VRAM and of vertex fetch per draw\n";
+}
+
+MeshDraw uploadMesh(const MeshData& mesh, GLuint vao, GLuint vbo, GLuint ebo) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * mesh.vertexStride, mesh.vertexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * mesh.indexSize, mesh.indexData, GL_STATIC_DRAW);
+
+    if (mesh.format == VERTEX_FORMAT_QUANTIZED) {
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(6, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+        glEnableVertexAttribArray(6);
+    }
+    else if (mesh.format == VERTEX_FORMAT_GRID) {
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_FALSE, sizeof(GridVertex), (void*)offsetof(GridVertex, position));
+        glEnableVertexAttribArray(0);
+    }
+    else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(6);
+    }
+    glBindVertexArray(0);
+
+    MeshDraw draw;
+    draw.format = mesh.format;
+    draw.indexType = mesh.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    draw.indexCount = static_cast<GLsizei>(mesh.indexCount);
+    draw.subMeshes.assign(mesh.subMeshes, mesh.subMeshes + mesh.subMeshCount);
+    for (const SubMesh& sub : draw.subMeshes) {
+        SubMesh* last = draw.batches.empty() ? nullptr : &draw.batches.back();
+        if (last && last->baseVertex == sub.baseVertex && last->indexOffset + last->indexCount == sub.indexOffset) {
+            last->indexCount += sub.indexCount;
+            last->vertexCount = std::max(last->vertexCount, sub.vertexCount);
+            last->material = -1;
+        }
+        else {
+            draw.batches.push_back(sub);
+        }
+    }
+    draw.posScale = mesh.posScale;
+    draw.posOffset = mesh.posOffset;
+    draw.boundsMin = mesh.boundsMin;
+    draw.boundsMax = mesh.boundsMax;
+    return draw;
+}
+
+void drawSubMesh(const MeshDraw& draw, const SubMesh& sub, RenderStats* stats) {
+    const size_t indexSize = draw.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    const void* offset = (const void*)(sub.indexOffset * indexSize);
+    if (sub.baseVertex == 0)
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(sub.indexCount), draw.indexType, offset);
+    else
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(sub.indexCount), draw.indexType,
+            offset, sub.baseVertex);
+    if (stats) ++stats->drawCalls;
+}
+
+void drawMesh(const MeshDraw& draw, RenderStats* stats) {
+    for (const SubMesh& sub : draw.batches) drawSubMesh(draw, sub, stats);
+}
+
+void setVertexDecode(ShaderProgram& program, const MeshDraw* draw) {
+    static const UniformName posScale = internUniform("uPosScale");
+    static const UniformName posOffset = internUniform("uPosOffset");
+    static const UniformName octNormals = internUniform("uOctNormals");
+    const bool quantized = draw && draw->format == VERTEX_FORMAT_QUANTIZED;
+    setUniform(program, posScale, quantized ? draw->posScale : glm::vec3(1.0f));
+    setUniform(program, posOffset, quantized ? draw->posOffset : glm::vec3(0.0f));
+    setUniform(program, octNormals, quantized ? 1 : 0);
+}
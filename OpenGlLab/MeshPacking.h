@@ -0,0 +1,112 @@
+#pragma once
+#include <glad/glad.h>
+#include "Mesh.h"
+#include "ShaderProgram.h"
+#include <cstdint>
+
+enum VertexFormat : uint32_t {
+    VERTEX_FORMAT_FLOAT = 0,        // Vertex: 3+3+2+4 floats, 48 bytes
+    VERTEX_FORMAT_QUANTIZED = 1,    // PackedVertex, 20 bytes
+    VERTEX_FORMAT_GRID = 2          // GridVertex, 8 bytes
+};
+
+// Compact vertex: position as int16 relative to the mesh bounds (pos = q * posScale + posOffset),
+// octahedral-encoded normal and tangent as two int16 in [-32767, 32767] each, texture coordinates as
+// half floats. Integer attributes are read unnormalized and decoded in shader.vert, so the result does
+// not depend on the driver's snorm conversion rule.
+struct PackedVertex {
+    int16_t position[4];    // w: tangent handedness, +-1
+    int16_t normal[2];
+    uint16_t texCoords[2];
+    int16_t tangent[2];
+};
+
+// Position-only vertex of meshes the vertex shader fills in itself (the chunked terrain's template):
+// int16 position read unnormalized, no other attributes.
+struct GridVertex {
+    int16_t position[4];    // w unused
+};
+
+// Index range drawn with glDrawElementsBaseVertex: one per material, and meshes with more than
+// 65535 vertices are additionally split so every range fits 16-bit indices.
+struct SubMesh {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    int32_t baseVertex;
+    uint32_t vertexCount;
+    int32_t material;       // MaterialRange::material
+};
+
+// Non-owning description of GPU-ready mesh data (a PackedMesh or a mapped cache file).
+struct MeshData {
+    VertexFormat format = VERTEX_FORMAT_FLOAT;
+    const void* vertexData = nullptr;
+    size_t vertexCount = 0;
+    uint32_t vertexStride = 0;
+    const void* indexData = nullptr;
+    size_t indexCount = 0;
+    uint32_t indexSize = 0;         // 2 or 4 bytes
+    const SubMesh* subMeshes = nullptr;
+    size_t subMeshCount = 0;
+    glm::vec3 posScale = glm::vec3(1.0f);
+    glm::vec3 posOffset = glm::vec3(0.0f);
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+struct PackedMesh {
+    VertexFormat format = VERTEX_FORMAT_FLOAT;
+    std::vector<unsigned char> vertexData;
+    size_t vertexCount = 0;
+    std::vector<unsigned char> indexData;
+    size_t indexCount = 0;
+    uint32_t indexSize = 2;
+    std::vector<SubMesh> subMeshes;
+    glm::vec3 posScale = glm::vec3(1.0f);
+    glm::vec3 posOffset = glm::vec3(0.0f);
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    MeshData view() const;
+};
+
+// Picks 16-bit indices (splitting into sub-meshes above 65535 vertices) and optionally converts
+// the vertices to PackedVertex. Every material range becomes at least one sub-mesh; empty ranges
+// mean a single range without material.
+void packMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    const std::vector<MaterialRange>& ranges, bool quantize, PackedMesh& out);
+// Decodes one vertex of a packed mesh back to floats (for error checks).
+Vertex unpackVertex(const MeshData& mesh, size_t index);
+// Buffer sizes against the unpacked layout (48-byte Vertex, 32-bit indices).
+void printPackStats(const char* label, const MeshData& packed);
+
+struct RenderStats {
+    unsigned int drawCalls = 0;
+    unsigned int textureBinds = 0;
+};
+
+// GL side: what a draw needs to know about an uploaded mesh.
+struct MeshDraw {
+    VertexFormat format = VERTEX_FORMAT_FLOAT;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLsizei indexCount = 0;
+    std::vector<SubMesh> subMeshes;
+    std::vector<SubMesh> batches;       // sub-meshes merged across materials, for untextured passes
+    glm::vec3 posScale = glm::vec3(1.0f);
+    glm::vec3 posOffset = glm::vec3(0.0f);
+    glm::vec3 boundsMin = glm::vec3(0.0f);  // model-space box of the positions, for culling
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Octahedral encoding of a unit vector as PackedVertex stores normals and tangents.
+void octEncode(const glm::vec3& n, int16_t out[2]);
+
+// Fills vbo/ebo and sets up the attribute layout of vao (locations 0/1/2 and 6 as in shader.vert).
+MeshDraw uploadMesh(const MeshData& mesh, GLuint vao, GLuint vbo, GLuint ebo);
+// Draws the whole mesh ignoring materials (one call per 16-bit window); the mesh's VAO must be bound.
+void drawMesh(const MeshDraw& draw, RenderStats* stats = nullptr);
+void drawSubMesh(const MeshDraw& draw, const SubMesh& sub, RenderStats* stats = nullptr);
+
+// Sets the shader.vert uniforms that undo the quantization (uPosScale, uPosOffset, uOctNormals) on the
+// current program. draw == nullptr restores the float layout (identity decode).
+void setVertexDecode(ShaderProgram& program, const MeshDraw* draw);
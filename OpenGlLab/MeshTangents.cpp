@@ -0,0 +1,116 @@
+#include "MeshTangents.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+const size_t kTangentJobItems = 16384;         // triangles or vertices per job
+const float kMinUvArea = 1e-12f;                // twice the uv area of a triangle with a usable mapping
+
+struct TriangleFrame {
+    glm::vec3 normal;                   // unit, zero for degenerate triangles
+    glm::vec3 dPdu, dPdv;               // unit directions of increasing u and v; zero without a mapping
+    float angle[3];                     // at each corner
+};
+
+static glm::vec3 normalizeOrZero(const glm::vec3& v) {
+    const float length = glm::length(v);
+    return length > 0.0f ? v / length : glm::vec3(0.0f);
+}
+
+static float cornerAngle(const glm::vec3& a, const glm::vec3& b) {
+    const float lengths = glm::length(a) * glm::length(b);
+    if (!(lengths > 0.0f)) return 0.0f;
+    return std::acos(std::min(std::max(glm::dot(a, b) / lengths, -1.0f), 1.0f));
+}
+
+static TriangleFrame triangleFrame(const Vertex& v0, const Vertex& v1, const Vertex& v2) {
+    TriangleFrame f;
+    const glm::vec3 e1 = v1.Position - v0.Position, e2 = v2.Position - v0.Position, e3 = v2.Position - v1.Position;
+    f.normal = normalizeOrZero(glm::cross(e1, e2));
+    f.angle[0] = cornerAngle(e1, e2);
+    f.angle[1] = cornerAngle(-e1, e3);
+    f.angle[2] = cornerAngle(-e2, -e3);
+    // Solve e = dPdu * du + dPdv * dv for both edges.
+    const glm::vec2 t1 = v1.TexCoords - v0.TexCoords, t2 = v2.TexCoords - v0.TexCoords;
+    const float det = t1.x * t2.y - t1.y * t2.x;
+    if (std::fabs(det) > kMinUvArea) {
+        f.dPdu = normalizeOrZero((e1 * t2.y - e2 * t1.y) / det);
+        f.dPdv = normalizeOrZero((e2 * t1.x - e1 * t2.x) / det);
+    }
+    else {
+        f.dPdu = f.dPdv = glm::vec3(0.0f);
+    }
+    return f;
+}
+
+glm::vec4 tangentFrame(const glm::vec3& normal, const glm::vec3& dPdu, const glm::vec3& dPdv) {
+    glm::vec3 n = normalizeOrZero(normal);
+    if (n == glm::vec3(0.0f)) n = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 t = normalizeOrZero(dPdu - n * glm::dot(n, dPdu));
+    if (t == glm::vec3(0.0f)) {
+        const glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        t = glm::normalize(axis - n * glm::dot(n, axis));
+    }
+    return glm::vec4(t, glm::dot(glm::cross(n, t), dPdv) < 0.0f ? -1.0f : 1.0f);
+}
+
+TangentStats computeTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, JobSystem& jobs) {
+    const auto begin = std::chrono::steady_clock::now();
+    TangentStats stats;
+    stats.vertices = vertices.size();
+    stats.triangles = indices.size() / 3;
+
+    std::vector<TriangleFrame> frames(stats.triangles);
+    JobCounter done;
+    submitRange(jobs, done, stats.triangles, kTangentJobItems, 1, [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; ++t)
+            frames[t] = triangleFrame(vertices[indices[3 * t]], vertices[indices[3 * t + 1]], vertices[indices[3 * t + 2]]);
+    });
+    waitForJobs(jobs, done);
+
+    // Corners of every vertex (triangle * 3 + corner), in triangle order so the sums below always add up
+    // in the same order.
+    std::vector<uint32_t> firstCorner(vertices.size() + 1, 0), corners(stats.triangles * 3);
+    for (size_t i = 0; i < corners.size(); ++i) ++firstCorner[indices[i] + 1];
+    for (size_t v = 0; v < vertices.size(); ++v) firstCorner[v + 1] += firstCorner[v];
+    {
+        std::vector<uint32_t> next(firstCorner.begin(), firstCorner.end() - 1);
+        for (size_t i = 0; i < corners.size(); ++i) corners[next[indices[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    std::atomic<size_t> normalsGenerated{ 0 }, tangentsMadeUp{ 0 };
+    submitRange(jobs, done, vertices.size(), kTangentJobItems, 1, [&](size_t first, size_t last) {
+        size_t generated = 0, madeUp = 0;
+        for (size_t v = first; v < last; ++v) {
+            Vertex& vertex = vertices[v];
+            const uint32_t* c = corners.data() + firstCorner[v];
+            const uint32_t* end = corners.data() + firstCorner[v + 1];
+            if (vertex.Normal == glm::vec3(0.0f)) {
+                glm::vec3 sum(0.0f);
+                for (const uint32_t* k = c; k != end; ++k) sum += frames[*k / 3].angle[*k % 3] * frames[*k / 3].normal;
+                vertex.Normal = normalizeOrZero(sum);
+                ++generated;
+            }
+            const glm::vec3 n = normalizeOrZero(vertex.Normal);
+            glm::vec3 dPdu(0.0f), dPdv(0.0f);
+            for (const uint32_t* k = c; k != end; ++k) {
+                const TriangleFrame& f = frames[*k / 3];
+                const float angle = f.angle[*k % 3];
+                dPdu += angle * normalizeOrZero(f.dPdu - n * glm::dot(n, f.dPdu));
+                dPdv += angle * normalizeOrZero(f.dPdv - n * glm::dot(n, f.dPdv));
+            }
+            if (glm::dot(dPdu, dPdu) <= 0.0f) ++madeUp;
+            vertex.Tangent = tangentFrame(vertex.Normal, dPdu, dPdv);
+        }
+        normalsGenerated += generated;
+        tangentsMadeUp += madeUp;
+    });
+    waitForJobs(jobs, done);
+    stats.normalsGenerated = normalsGenerated;
+    stats.tangentsMadeUp = tangentsMadeUp;
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return stats;
+}
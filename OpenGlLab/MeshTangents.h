@@ -0,0 +1,34 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include <cstddef>
+#include <vector>
+
+struct JobSystem;
+
+struct TangentStats {
+    size_t vertices = 0;
+    size_t triangles = 0;
+    size_t normalsGenerated = 0;        // vertices that came without a normal (no vn in the OBJ)
+    size_t tangentsMadeUp = 0;          // vertices without a usable texture mapping around them
+    double ms = 0.0;
+};
+
+// Mesh-processing pass between loading and packing. Vertices without a normal get a smooth one, the
+// corner-angle weighted average of the faces around them; authored normals are kept, hard edges and
+// all. Every vertex then gets a tangent the MikkTSpace way: the direction of increasing u of each face,
+// projected onto the vertex's tangent plane and weighted by the corner angle, with the handedness of
+// the mapping in w. Vertices are not split where the handedness flips inside one vertex (mirrored
+// UVs without a seam), the one case MikkTSpace handles and this pass does not.
+//
+// Three passes, each over one array in order: a frame per triangle (face normal, directions of u and
+// v, corner angles), the corners of every vertex in triangle order, and a gather per vertex. Only the
+// first and last do real work and both run as jobs over ranges with no shared writes, so the result
+// does not depend on the number of workers; the calling thread takes part and returns when all are
+// done. After optimizeVertexFetch both walk the vertices almost linearly.
+TangentStats computeTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, JobSystem& jobs);
+
+// Tangent of a vertex with the given normal from the surface directions of increasing u and v: dPdu
+// made orthogonal to the normal, w = -1 where cross(normal, tangent) points against dPdv. Without a
+// usable dPdu, some direction in the tangent plane.
+glm::vec4 tangentFrame(const glm::vec3& normal, const glm::vec3& dPdu, const glm::vec3& dPdv);
@@ -0,0 +1,847 @@
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+std::tuple<int, int, int> parseFace(const std::string& face) {
+    int vi = -1, ti = -1, ni = -1;
+    size_t slash1 = face.find('/');
+    size_t slash2 = (slash1 != std::string::npos) ? face.find('/', slash1 + 1) : std::string::npos;
+
+    std::string viStr = face.substr(0, slash1 != std::string::npos ? slash1 : face.size());
+    if (!viStr.empty()) {
+        try { vi = std::stoi(viStr) - 1; }
+        catch (...) {}
+    }
+    if (slash1 != std::string::npos) {
+        size_t tiStart = slash1 + 1;
+        size_t tiEnd = (slash2 != std::string::npos) ? slash2 : face.size();
+        if (tiStart < tiEnd) {
+            std::string tiStr = face.substr(tiStart, tiEnd - tiStart);
+            if (!tiStr.empty()) {
+                try { ti = std::stoi(tiStr) - 1; }
+                catch (...) {}
+            }
+        }
+    }
+    if (slash2 != std::string::npos) {
+        std::string niStr = face.substr(slash2 + 1);
+        if (!niStr.empty()) {
+            try { ni = std::stoi(niStr) - 1; }
+            catch (...) {}
+        }
+    }
+    return { vi, ti, ni };
+}
+
+bool loadOBJ(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::vector<glm::vec3> temp_vertices;
+    std::vector<glm::vec2> temp_texCoords;
+    std::vector<glm::vec3> temp_normals;
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Could not open OBJ file: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    file.close();
+    for (const auto& l : lines) {
+        std::istringstream iss(l);
+        std::string prefix;
+        iss >> prefix;
+        if (prefix == "v") {
+            glm::vec3 pos;
+            iss >> pos.x >> pos.y >> pos.z;
+            temp_vertices.push_back(pos);
+        }
+        else if (prefix == "vt") {
+            glm::vec2 uv;
+            iss >> uv.x >> uv.y;
+            temp_texCoords.push_back(uv);
+        }
+        else if (prefix == "vn") {
+            glm::vec3 normal;
+            iss >> normal.x >> normal.y >> normal.z;
+            temp_normals.push_back(normal);
+        }
+        else if (prefix == "f") {
+            std::vector<std::string> faceVertices;
+            std::string token;
+            iss.clear();
+            iss.seekg(0, std::ios::beg);
+            std::string dummy;
+            iss >> dummy;
+            while (iss >> token) {
+                faceVertices.push_back(token);
+            }
+            if (faceVertices.size() < 3) continue;
+            std::vector<std::tuple<int, int, int>> faceIndices;
+            bool valid = true;
+            for (const auto& fv : faceVertices) {
+                auto result = parseFace(fv);
+                int vi = std::get<0>(result);
+                int ti = std::get<1>(result);
+                int ni = std::get<2>(result);
+                if (vi < 0 || vi >= static_cast<int>(temp_vertices.size())) {
+                    valid = false;
+                    break;
+                }
+                faceIndices.emplace_back(vi, ti, ni);
+            }
+            if (!valid) continue;
+            unsigned int baseIdx = static_cast<unsigned int>(vertices.size());
+            for (size_t i = 0; i < faceIndices.size() - 2; ++i) {
+                auto result0 = faceIndices[0];
+                int vi0 = std::get<0>(result0);
+                int ti0 = std::get<1>(result0);
+                int ni0 = std::get<2>(result0);
+                auto result1 = faceIndices[i + 1];
+                int vi1 = std::get<0>(result1);
+                int ti1 = std::get<1>(result1);
+                int ni1 = std::get<2>(result1);
+                auto result2 = faceIndices[i + 2];
+                int vi2 = std::get<0>(result2);
+                int ti2 = std::get<1>(result2);
+                int ni2 = std::get<2>(result2);
+                ti0 = (ti0 >= 0 && ti0 < static_cast<int>(temp_texCoords.size())) ? ti0 : -1;
+                ti1 = (ti1 >= 0 && ti1 < static_cast<int>(temp_texCoords.size())) ? ti1 : -1;
+                ti2 = (ti2 >= 0 && ti2 < static_cast<int>(temp_texCoords.size())) ? ti2 : -1;
+                ni0 = (ni0 >= 0 && ni0 < static_cast<int>(temp_normals.size())) ? ni0 : -1;
+                ni1 = (ni1 >= 0 && ni1 < static_cast<int>(temp_normals.size())) ? ni1 : -1;
+                ni2 = (ni2 >= 0 && ni2 < static_cast<int>(temp_normals.size())) ? ni2 : -1;
+                if (ni0 < 0) ni0 = 0;
+                if (ni1 < 0) ni1 = 0;
+                if (ni2 < 0) ni2 = 0;
+                vertices.push_back({ temp_vertices[vi0], temp_normals[ni0], ti0 >= 0 ? temp_texCoords[ti0] : glm::vec2(0.0f) });
+                vertices.push_back({ temp_vertices[vi1], temp_normals[ni1], ti1 >= 0 ? temp_texCoords[ti1] : glm::vec2(0.0f) });
+                vertices.push_back({ temp_vertices[vi2], temp_normals[ni2], ti2 >= 0 ? temp_texCoords[ti2] : glm::vec2(0.0f) });
+                indices.push_back(baseIdx + 3 * static_cast<unsigned int>(i));
+                indices.push_back(baseIdx + 3 * static_cast<unsigned int>(i) + 1);
+                indices.push_back(baseIdx + 3 * static_cast<unsigned int>(i) + 2);
+            }
+        }
+    }
+    return true;
+}
+
+// ---- Memory-mapped loader ----
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline bool isDigit(char c) {
+    return static_cast<unsigned>(c - '0') < 10u;
+}
+
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+static inline const char* nextLine(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char*>(nl) + 1 : end;
+}
+
+static const float kPow10f[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+// Scans a decimal float at p. Mantissas up to 2^24 with |exp10| <= 10 are converted with a single
+// exactly-rounded float multiply/divide; anything else goes through strtof on a stack copy, so the
+// result matches what `iss >> f` produces.
+static bool scanFloat(const char*& p, const char* end, float& out) {
+    const char* start = p;
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) { negative = *s == '-'; ++s; }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exp10 = 0;
+    bool exact = true;
+    bool any = false;
+    while (s < end && isDigit(*s)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+            if (mantissa) ++digits;
+        }
+        else {
+            ++exp10;
+            exact = false;
+        }
+        any = true;
+        ++s;
+    }
+    if (s < end && *s == '.') {
+        ++s;
+        while (s < end && isDigit(*s)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+                if (mantissa) ++digits;
+                --exp10;
+            }
+            else {
+                exact = false;
+            }
+            any = true;
+            ++s;
+        }
+    }
+    if (!any) return false;
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool expNegative = false;
+        if (e < end && (*e == '-' || *e == '+')) { expNegative = *e == '-'; ++e; }
+        if (e < end && isDigit(*e)) {
+            int value = 0;
+            while (e < end && isDigit(*e)) {
+                if (value < 100000) value = value * 10 + (*e - '0');
+                ++e;
+            }
+            exp10 += expNegative ? -value : value;
+            s = e;
+        }
+    }
+    p = s;
+    if (exact && mantissa <= (1u << 24) && exp10 >= -10 && exp10 <= 10) {
+        float f = static_cast<float>(mantissa);
+        f = exp10 < 0 ? f / kPow10f[-exp10] : f * kPow10f[exp10];
+        out = negative ? -f : f;
+        return true;
+    }
+    char buf[64];
+    size_t n = static_cast<size_t>(s - start);
+    if (n >= sizeof(buf)) n = sizeof(buf) - 1;
+    std::memcpy(buf, start, n);
+    buf[n] = '\0';
+    out = std::strtof(buf, nullptr);
+    return true;
+}
+
+// Same semantics as std::stoi on the field: optional sign, then digits. No digits -> false.
+static bool scanInt(const char* p, const char* end, int& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) { negative = *p == '-'; ++p; }
+    if (p >= end || !isDigit(*p)) return false;
+    long long value = 0;
+    while (p < end && isDigit(*p)) {
+        value = value * 10 + (*p - '0');
+        if (value > 0x7fffffff) return false;
+        ++p;
+    }
+    out = static_cast<int>(negative ? -value : value);
+    return true;
+}
+
+// Raw OBJ index of one corner field; 0 when the field is absent or not a number.
+static inline int scanRawIndex(const char* b, const char* e) {
+    int raw;
+    return scanInt(b, e, raw) ? raw : 0;
+}
+
+// OBJ index (1-based, or negative relative to the current end) -> 0-based, -1 when absent.
+static inline int resolveIndex(int raw, int count) {
+    if (raw == 0) return -1;
+    return raw > 0 ? raw - 1 : count + raw;
+}
+
+struct FaceCorner {
+    int vi, ti, ni;
+};
+
+// Splits "v", "v/t", "v//n" or "v/t/n" into raw OBJ indices.
+static void scanCorner(const char* b, const char* e, FaceCorner& c) {
+    const char* s1 = static_cast<const char*>(std::memchr(b, '/', static_cast<size_t>(e - b)));
+    const char* s2 = s1 ? static_cast<const char*>(std::memchr(s1 + 1, '/', static_cast<size_t>(e - s1 - 1))) : nullptr;
+    c.vi = scanRawIndex(b, s1 ? s1 : e);
+    c.ti = s1 ? scanRawIndex(s1 + 1, s2 ? s2 : e) : 0;
+    c.ni = s2 ? scanRawIndex(s2 + 1, e) : 0;
+}
+
+// Resolves raw corner indices against the attribute counts seen so far. Returns false when the
+// position index is out of range (the whole face is dropped, as in loadOBJ). Bad texcoords become
+// -1; bad normals fall back to normal 0, or -1 when the file has no normals yet.
+static inline bool resolveCorner(FaceCorner& c, int nv, int nt, int nn) {
+    c.vi = resolveIndex(c.vi, nv);
+    c.ti = resolveIndex(c.ti, nt);
+    c.ni = resolveIndex(c.ni, nn);
+    if (c.ti < 0 || c.ti >= nt) c.ti = -1;
+    if (c.ni < 0 || c.ni >= nn) c.ni = nn ? 0 : -1;
+    return c.vi >= 0 && c.vi < nv;
+}
+
+enum ObjRecord { OBJ_OTHER, OBJ_POSITION, OBJ_TEXCOORD, OBJ_NORMAL, OBJ_FACE, OBJ_USEMTL, OBJ_MTLLIB };
+
+// Classifies the line by its leading keyword; q is left just after the keyword.
+static inline ObjRecord classifyLine(const char* p, const char* lineEnd, const char*& q) {
+    q = skipBlanks(p, lineEnd);
+    const char* kw = q;
+    while (q < lineEnd && !isBlank(*q) && *q != '\n') ++q;
+    size_t len = static_cast<size_t>(q - kw);
+    if (len == 1 && kw[0] == 'v') return OBJ_POSITION;
+    if (len == 1 && kw[0] == 'f') return OBJ_FACE;
+    if (len == 2 && kw[0] == 'v' && kw[1] == 't') return OBJ_TEXCOORD;
+    if (len == 2 && kw[0] == 'v' && kw[1] == 'n') return OBJ_NORMAL;
+    if (len == 6 && std::memcmp(kw, "usemtl", 6) == 0) return OBJ_USEMTL;
+    if (len == 6 && std::memcmp(kw, "mtllib", 6) == 0) return OBJ_MTLLIB;
+    return OBJ_OTHER;
+}
+
+// Rest of the line without surrounding blanks (material names and file names may contain spaces).
+static inline std::string lineArgument(const char* q, const char* lineEnd) {
+    q = skipBlanks(q, lineEnd);
+    const char* e = lineEnd;
+    while (e > q && (isBlank(e[-1]) || e[-1] == '\n')) --e;
+    return std::string(q, e);
+}
+
+// Up to n floats; missing trailing values stay untouched.
+static inline void scanFloats(const char* q, const char* lineEnd, float* out, int n) {
+    for (int k = 0; k < n; ++k) {
+        q = skipBlanks(q, lineEnd);
+        if (!scanFloat(q, lineEnd, out[k])) break;
+    }
+}
+
+// Calls fn(tokenBegin, tokenEnd) for every whitespace-separated token up to the end of the line.
+template <typename Fn>
+static inline void forEachToken(const char* q, const char* lineEnd, Fn fn) {
+    for (;;) {
+        q = skipBlanks(q, lineEnd);
+        if (q >= lineEnd || *q == '\n') break;
+        const char* tok = q;
+        while (q < lineEnd && !isBlank(*q) && *q != '\n') ++q;
+        fn(tok, q);
+    }
+}
+
+static inline Vertex makeVertex(const FaceCorner& c, const glm::vec3* positions,
+    const glm::vec2* texCoords, const glm::vec3* normals) {
+    return { positions[c.vi],
+        c.ni >= 0 ? normals[c.ni] : glm::vec3(0.0f),
+        c.ti >= 0 ? texCoords[c.ti] : glm::vec2(0.0f) };
+}
+
+bool parseOBJ(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::vector<glm::vec3> temp_vertices;
+    std::vector<glm::vec2> temp_texCoords;
+    std::vector<glm::vec3> temp_normals;
+    std::vector<FaceCorner> corners;
+    // Rough guess at attribute counts to avoid most regrowth on big files.
+    temp_vertices.reserve(size / 120);
+    temp_normals.reserve(size / 120);
+    temp_texCoords.reserve(size / 120);
+
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        const char* lineEnd = nextLine(p, end);
+        const char* q;
+        switch (classifyLine(p, lineEnd, q)) {
+        case OBJ_POSITION: {
+            glm::vec3 pos(0.0f);
+            scanFloats(q, lineEnd, &pos.x, 3);
+            temp_vertices.push_back(pos);
+            break;
+        }
+        case OBJ_TEXCOORD: {
+            glm::vec2 uv(0.0f);
+            scanFloats(q, lineEnd, &uv.x, 2);
+            temp_texCoords.push_back(uv);
+            break;
+        }
+        case OBJ_NORMAL: {
+            glm::vec3 normal(0.0f);
+            scanFloats(q, lineEnd, &normal.x, 3);
+            temp_normals.push_back(normal);
+            break;
+        }
+        case OBJ_FACE: {
+            const int nv = static_cast<int>(temp_vertices.size());
+            const int nt = static_cast<int>(temp_texCoords.size());
+            const int nn = static_cast<int>(temp_normals.size());
+            corners.clear();
+            bool valid = true;
+            forEachToken(q, lineEnd, [&](const char* b, const char* e) {
+                FaceCorner c;
+                scanCorner(b, e, c);
+                valid = resolveCorner(c, nv, nt, nn) && valid;
+                corners.push_back(c);
+            });
+            if (corners.size() < 3 || !valid) break;
+
+            for (size_t i = 0; i + 2 < corners.size(); ++i) {
+                unsigned int base = static_cast<unsigned int>(vertices.size());
+                vertices.push_back(makeVertex(corners[0], temp_vertices.data(), temp_texCoords.data(), temp_normals.data()));
+                vertices.push_back(makeVertex(corners[i + 1], temp_vertices.data(), temp_texCoords.data(), temp_normals.data()));
+                vertices.push_back(makeVertex(corners[i + 2], temp_vertices.data(), temp_texCoords.data(), temp_normals.data()));
+                indices.push_back(base);
+                indices.push_back(base + 1);
+                indices.push_back(base + 2);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        p = lineEnd;
+    }
+    return true;
+}
+
+bool loadOBJMapped(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    MappedFile file;
+    if (!mapFile(path, file)) return false;
+    bool ok = parseOBJ(file.data, file.size, vertices, indices);
+    unmapFile(file);
+    return ok;
+}
+
+// ---- Parallel chunked loader ----
+
+struct ObjFace {
+    size_t firstCorner;
+    int cornerCount;       // 0 once the face has been rejected
+    int nv, nt, nn;        // attribute counts inside the chunk when the face was read
+    int material;          // index into the chunk's usemtl list (-1: inherited), global id after resolve
+};
+
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::vector<FaceCorner> corners;   // raw OBJ indices until resolveChunk
+    std::vector<ObjFace> faces;
+    std::vector<std::string> useMaterials;  // usemtl names in chunk order
+    std::vector<int> materialIds;           // global id of each useMaterials entry
+    std::vector<std::string> libraries;
+    int startMaterial = -1;                 // material in effect at the start of the chunk
+    int vBase = 0, tBase = 0, nBase = 0;
+    size_t triBase = 0, triCount = 0;
+};
+
+// Pass 1: attributes and raw face corners, no cross-chunk knowledge needed.
+static void scanChunk(ObjChunk& chunk) {
+    size_t size = static_cast<size_t>(chunk.end - chunk.begin);
+    chunk.positions.reserve(size / 120);
+    chunk.normals.reserve(size / 120);
+    chunk.texCoords.reserve(size / 120);
+    chunk.corners.reserve(size / 40);
+
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* lineEnd = nextLine(p, chunk.end);
+        const char* q;
+        switch (classifyLine(p, lineEnd, q)) {
+        case OBJ_POSITION: {
+            glm::vec3 pos(0.0f);
+            scanFloats(q, lineEnd, &pos.x, 3);
+            chunk.positions.push_back(pos);
+            break;
+        }
+        case OBJ_TEXCOORD: {
+            glm::vec2 uv(0.0f);
+            scanFloats(q, lineEnd, &uv.x, 2);
+            chunk.texCoords.push_back(uv);
+            break;
+        }
+        case OBJ_NORMAL: {
+            glm::vec3 normal(0.0f);
+            scanFloats(q, lineEnd, &normal.x, 3);
+            chunk.normals.push_back(normal);
+            break;
+        }
+        case OBJ_FACE: {
+            ObjFace face;
+            face.firstCorner = chunk.corners.size();
+            face.nv = static_cast<int>(chunk.positions.size());
+            face.nt = static_cast<int>(chunk.texCoords.size());
+            face.nn = static_cast<int>(chunk.normals.size());
+            forEachToken(q, lineEnd, [&](const char* b, const char* e) {
+                FaceCorner c;
+                scanCorner(b, e, c);
+                chunk.corners.push_back(c);
+            });
+            face.cornerCount = static_cast<int>(chunk.corners.size() - face.firstCorner);
+            face.material = static_cast<int>(chunk.useMaterials.size()) - 1;
+            chunk.faces.push_back(face);
+            break;
+        }
+        case OBJ_USEMTL:
+            chunk.useMaterials.push_back(lineArgument(q, lineEnd));
+            break;
+        case OBJ_MTLLIB:
+            chunk.libraries.push_back(lineArgument(q, lineEnd));
+            break;
+        default:
+            break;
+        }
+        p = lineEnd;
+    }
+}
+
+// Pass 2: resolve indices against global counts (chunk base + local count at the face),
+// copy the chunk's attributes into the global arrays and count surviving triangles.
+static void resolveChunk(ObjChunk& chunk, glm::vec3* positions, glm::vec2* texCoords, glm::vec3* normals) {
+    std::copy(chunk.positions.begin(), chunk.positions.end(), positions + chunk.vBase);
+    std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords + chunk.tBase);
+    std::copy(chunk.normals.begin(), chunk.normals.end(), normals + chunk.nBase);
+
+    chunk.triCount = 0;
+    for (ObjFace& face : chunk.faces) {
+        face.material = face.material >= 0 ? chunk.materialIds[face.material] : chunk.startMaterial;
+        const int nv = chunk.vBase + face.nv;
+        const int nt = chunk.tBase + face.nt;
+        const int nn = chunk.nBase + face.nn;
+        bool valid = true;
+        for (int k = 0; k < face.cornerCount; ++k)
+            valid = resolveCorner(chunk.corners[face.firstCorner + k], nv, nt, nn) && valid;
+        if (face.cornerCount < 3 || !valid) face.cornerCount = 0;
+        else chunk.triCount += static_cast<size_t>(face.cornerCount - 2);
+    }
+}
+
+// Pass 3: fan-triangulate into the chunk's slice of the output.
+static void emitChunk(const ObjChunk& chunk, const glm::vec3* positions, const glm::vec2* texCoords,
+    const glm::vec3* normals, Vertex* outVertices, unsigned int* outIndices, unsigned int baseIndex) {
+    size_t tri = chunk.triBase;
+    for (const ObjFace& face : chunk.faces) {
+        const FaceCorner* c = &chunk.corners[face.firstCorner];
+        for (int i = 0; i + 2 < face.cornerCount; ++i, ++tri) {
+            Vertex* v = outVertices + 3 * tri;
+            v[0] = makeVertex(c[0], positions, texCoords, normals);
+            v[1] = makeVertex(c[i + 1], positions, texCoords, normals);
+            v[2] = makeVertex(c[i + 2], positions, texCoords, normals);
+            unsigned int* idx = outIndices + 3 * tri;
+            idx[0] = baseIndex + 3 * static_cast<unsigned int>(tri);
+            idx[1] = idx[0] + 1;
+            idx[2] = idx[0] + 2;
+        }
+    }
+}
+
+static inline uint32_t hashCorner(const FaceCorner& c) {
+    uint32_t h = static_cast<uint32_t>(c.vi) * 0x9E3779B1u;
+    h ^= static_cast<uint32_t>(c.ti) * 0x85EBCA77u;
+    h ^= static_cast<uint32_t>(c.ni) * 0xC2B2AE3Du;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 13;
+    return h;
+}
+
+// Open-addressing (linear probing) table from a resolved (v, vt, vn) corner to its output vertex.
+// Sized once from the corner count, so it never rehashes and never allocates per entry.
+struct CornerWeldTable {
+    struct Slot {
+        int vi, ti, ni;         // vi < 0 marks an empty slot
+        unsigned int index;
+    };
+    std::vector<Slot> slots;
+    size_t mask;
+
+    explicit CornerWeldTable(size_t maxEntries) {
+        size_t capacity = 16;
+        while (capacity < maxEntries * 2) capacity <<= 1;
+        slots.assign(capacity, Slot{ -1, 0, 0, 0 });
+        mask = capacity - 1;
+    }
+
+    // Slot holding c, or the empty slot where it should be inserted.
+    Slot& find(const FaceCorner& c) {
+        size_t i = hashCorner(c) & mask;
+        for (;;) {
+            Slot& slot = slots[i];
+            if (slot.vi < 0 || (slot.vi == c.vi && slot.ti == c.ti && slot.ni == c.ni)) return slot;
+            i = (i + 1) & mask;
+        }
+    }
+};
+
+// Pass 3 (welded): one output vertex per distinct corner, in first-use order.
+static void weldChunks(const std::vector<ObjChunk>& chunks, const glm::vec3* positions, const glm::vec2* texCoords,
+    const glm::vec3* normals, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    size_t corners = 0, triangles = 0;
+    for (const ObjChunk& chunk : chunks) {
+        for (const ObjFace& face : chunk.faces) corners += static_cast<size_t>(face.cornerCount);
+        triangles += chunk.triCount;
+    }
+    CornerWeldTable table(corners);
+    indices.reserve(indices.size() + 3 * triangles);
+
+    std::vector<unsigned int> faceVerts;
+    for (const ObjChunk& chunk : chunks) {
+        for (const ObjFace& face : chunk.faces) {
+            if (face.cornerCount == 0) continue;
+            faceVerts.clear();
+            for (int k = 0; k < face.cornerCount; ++k) {
+                const FaceCorner& c = chunk.corners[face.firstCorner + k];
+                CornerWeldTable::Slot& slot = table.find(c);
+                if (slot.vi < 0) {
+                    slot = { c.vi, c.ti, c.ni, static_cast<unsigned int>(vertices.size()) };
+                    vertices.push_back(makeVertex(c, positions, texCoords, normals));
+                }
+                faceVerts.push_back(slot.index);
+            }
+            for (size_t i = 0; i + 2 < faceVerts.size(); ++i) {
+                indices.push_back(faceVerts[0]);
+                indices.push_back(faceVerts[i + 1]);
+                indices.push_back(faceVerts[i + 2]);
+            }
+        }
+    }
+}
+
+// Material id of every surviving triangle, in emission order (the same for both pass-3 variants).
+static std::vector<int> triangleMaterials(const std::vector<ObjChunk>& chunks) {
+    std::vector<int> materials;
+    for (const ObjChunk& chunk : chunks) {
+        for (const ObjFace& face : chunk.faces) {
+            if (face.cornerCount) materials.insert(materials.end(), static_cast<size_t>(face.cornerCount - 2), face.material);
+        }
+    }
+    return materials;
+}
+
+// Stable counting sort of the triangles from indices[firstIndex] on by material; one range per
+// material that has triangles, triangles without a material first.
+static void groupByMaterial(std::vector<unsigned int>& indices, size_t firstIndex, const std::vector<int>& triMaterials,
+    size_t materialCount, std::vector<MaterialRange>& ranges) {
+    std::vector<size_t> start(materialCount + 2, 0);
+    for (int m : triMaterials) ++start[static_cast<size_t>(m + 1) + 1];
+    for (size_t k = 1; k < start.size(); ++k) start[k] += start[k - 1];
+
+    std::vector<unsigned int> sorted(3 * triMaterials.size());
+    std::vector<size_t> next(start.begin(), start.end() - 1);
+    for (size_t t = 0; t < triMaterials.size(); ++t) {
+        size_t dst = next[static_cast<size_t>(triMaterials[t] + 1)]++;
+        std::copy_n(indices.begin() + firstIndex + 3 * t, 3, sorted.begin() + 3 * dst);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices.begin() + firstIndex);
+
+    ranges.clear();
+    for (size_t k = 0; k + 1 < start.size(); ++k) {
+        if (start[k + 1] == start[k]) continue;
+        ranges.push_back({ static_cast<unsigned int>(firstIndex + 3 * start[k]),
+            static_cast<unsigned int>(3 * (start[k + 1] - start[k])), static_cast<int>(k) - 1 });
+    }
+}
+
+// Runs fn(i) for every chunk, one chunk per job (or per thread without a JobSystem).
+template <typename Fn>
+static void runParallel(const ObjLoadOptions& options, size_t count, Fn fn) {
+    parallelFor(options.jobs, options.threads, count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) fn(i);
+    });
+}
+
+bool parseOBJParallel(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+    const ObjLoadOptions& options, ObjMaterialInfo* materials) {
+    const size_t kMinChunkBytes = 64 * 1024;
+    unsigned int threads = options.jobs ? static_cast<unsigned int>(options.jobs->queues.size()) : options.threads;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threads, size / kMinChunkBytes));
+
+    // Split at newline boundaries.
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char* end = data + size;
+    const char* p = data;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        const char* cut = (i + 1 == chunkCount) ? end : data + size * (i + 1) / chunkCount;
+        if (cut < p) cut = p;
+        if (cut < end) cut = nextLine(cut, end);
+        chunks[i].begin = p;
+        chunks[i].end = cut;
+        p = cut;
+    }
+
+    runParallel(options, chunkCount, [&](size_t i) { scanChunk(chunks[i]); });
+
+    size_t nv = 0, nt = 0, nn = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.vBase = static_cast<int>(nv);
+        chunk.tBase = static_cast<int>(nt);
+        chunk.nBase = static_cast<int>(nn);
+        nv += chunk.positions.size();
+        nt += chunk.texCoords.size();
+        nn += chunk.normals.size();
+    }
+    std::vector<glm::vec3> positions(nv);
+    std::vector<glm::vec2> texCoords(nt);
+    std::vector<glm::vec3> normals(nn);
+
+    // Material names are few, so they get global ids serially; a chunk's leading faces inherit
+    // whatever material the previous chunks ended with.
+    std::vector<std::string> materialNames;
+    std::vector<std::string> libraries;
+    int currentMaterial = -1;
+    for (ObjChunk& chunk : chunks) {
+        chunk.startMaterial = currentMaterial;
+        for (const std::string& name : chunk.useMaterials) {
+            int id = static_cast<int>(std::find(materialNames.begin(), materialNames.end(), name) - materialNames.begin());
+            if (id == static_cast<int>(materialNames.size())) materialNames.push_back(name);
+            chunk.materialIds.push_back(id);
+            currentMaterial = id;
+        }
+        libraries.insert(libraries.end(), chunk.libraries.begin(), chunk.libraries.end());
+    }
+    if (materials) {
+        materials->libraries = libraries;
+        materials->names = materialNames;
+        materials->ranges.clear();
+    }
+
+    runParallel(options, chunkCount, [&](size_t i) {
+        resolveChunk(chunks[i], positions.data(), texCoords.data(), normals.data());
+    });
+
+    const size_t firstIndex = indices.size();
+    if (options.weld) {
+        if (!options.optimize) {
+            weldChunks(chunks, positions.data(), texCoords.data(), normals.data(), vertices, indices);
+            if (materials) groupByMaterial(indices, firstIndex, triangleMaterials(chunks), materialNames.size(), materials->ranges);
+            return true;
+        }
+        // The optimizers work on a standalone mesh, so weld into scratch buffers and append.
+        std::vector<Vertex> meshVertices;
+        std::vector<unsigned int> meshIndices;
+        weldChunks(chunks, positions.data(), texCoords.data(), normals.data(), meshVertices, meshIndices);
+        if (materials) {
+            groupByMaterial(meshIndices, 0, triangleMaterials(chunks), materialNames.size(), materials->ranges);
+            std::vector<unsigned int> rangeIndices;
+            for (MaterialRange& range : materials->ranges) {
+                rangeIndices.assign(meshIndices.begin() + range.indexOffset, meshIndices.begin() + range.indexOffset + range.indexCount);
+                optimizeVertexCache(rangeIndices, meshVertices.size());
+                std::copy(rangeIndices.begin(), rangeIndices.end(), meshIndices.begin() + range.indexOffset);
+                range.indexOffset += static_cast<unsigned int>(firstIndex);
+            }
+        }
+        else {
+            optimizeVertexCache(meshIndices, meshVertices.size());
+        }
+        optimizeVertexFetch(meshVertices, meshIndices);
+        const unsigned int base = static_cast<unsigned int>(vertices.size());
+        vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+        for (unsigned int index : meshIndices) indices.push_back(base + index);
+        return true;
+    }
+
+    size_t triangles = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.triBase = triangles;
+        triangles += chunk.triCount;
+    }
+    const unsigned int baseIndex = static_cast<unsigned int>(vertices.size());
+    const size_t firstVertex = vertices.size();
+    vertices.resize(firstVertex + 3 * triangles);
+    indices.resize(firstIndex + 3 * triangles);
+
+    runParallel(options, chunkCount, [&](size_t i) {
+        emitChunk(chunks[i], positions.data(), texCoords.data(), normals.data(),
+            vertices.data() + firstVertex, indices.data() + firstIndex, baseIndex);
+    });
+    if (materials) groupByMaterial(indices, firstIndex, triangleMaterials(chunks), materialNames.size(), materials->ranges);
+    return true;
+}
+
+bool loadOBJParallel(const char* path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+    const ObjLoadOptions& options, ObjMaterialInfo* materials) {
+    MappedFile file;
+    if (!mapFile(path, file)) return false;
+    bool ok = parseOBJParallel(file.data, file.size, vertices, indices, options, materials);
+    unmapFile(file);
+    return ok;
+}
+
+// ---- MTL ----
+
+namespace fs = std::filesystem;
+
+static inline bool keywordIs(const char* kw, const char* q, const char* name) {
+    size_t len = std::strlen(name);
+    return static_cast<size_t>(q - kw) == len && std::memcmp(kw, name, len) == 0;
+}
+
+// Texture statements may carry options ("-bm 1.0 path"); the file name is the last token.
+static std::string lastToken(const char* q, const char* lineEnd) {
+    std::string token;
+    forEachToken(q, lineEnd, [&](const char* b, const char* e) { token.assign(b, e); });
+    return token;
+}
+
+static std::string resolveTexturePath(const fs::path& mtlDir, const std::string& name) {
+    if (name.empty()) return std::string();
+    std::error_code ec;
+    fs::path path(name);
+    std::vector<fs::path> candidates = { path, mtlDir / path };
+    if (path.has_parent_path()) candidates.push_back(mtlDir / path.parent_path().filename() / path.filename());
+    candidates.push_back(mtlDir / path.filename());
+    for (const fs::path& candidate : candidates) {
+        if (fs::is_regular_file(candidate, ec)) return candidate.generic_string();
+    }
+    std::cerr << "WARNING: Texture not found: " << name << std::endl;
+    return std::string();
+}
+
+bool loadMTL(const char* path, std::vector<Material>& materials) {
+    MappedFile file;
+    if (!mapFile(path, file)) return false;
+    const fs::path mtlDir = fs::path(path).parent_path();
+    Material* current = nullptr;
+    const char* p = file.data;
+    const char* end = file.data + file.size;
+    while (p < end) {
+        const char* lineEnd = nextLine(p, end);
+        const char* kw = skipBlanks(p, lineEnd);
+        const char* q = kw;
+        while (q < lineEnd && !isBlank(*q) && *q != '\n') ++q;
+        if (keywordIs(kw, q, "newmtl")) {
+            materials.push_back(Material());
+            current = &materials.back();
+            current->name = lineArgument(q, lineEnd);
+        }
+        else if (current && keywordIs(kw, q, "Kd")) {
+            scanFloats(q, lineEnd, &current->diffuse.x, 3);
+        }
+        else if (current && keywordIs(kw, q, "map_Kd")) {
+            current->diffuseMap = resolveTexturePath(mtlDir, lastToken(q, lineEnd));
+        }
+        else if (current && (keywordIs(kw, q, "map_Bump") || keywordIs(kw, q, "map_bump") ||
+            keywordIs(kw, q, "bump") || keywordIs(kw, q, "norm"))) {
+            current->normalMap = resolveTexturePath(mtlDir, lastToken(q, lineEnd));
+        }
+        p = lineEnd;
+    }
+    unmapFile(file);
+    return true;
+}
+
+void loadOBJMaterials(const char* objPath, const std::vector<std::string>& libraries,
+    const std::vector<std::string>& names, std::vector<Material>& materials) {
+    std::vector<Material> defined;
+    const fs::path objDir = fs::path(objPath).parent_path();
+    for (const std::string& library : libraries) loadMTL((objDir / library).string().c_str(), defined);
+
+    materials.assign(names.size(), Material());
+    for (size_t i = 0; i < names.size(); ++i) {
+        materials[i].name = names[i];
+        for (const Material& m : defined) {
+            if (m.name == names[i]) { materials[i] = m; break; }
+        }
+    }
+}
@@ -0,0 +1,266 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+void beginRenderQueue(RenderQueue& queue) {
+    queue.packets.clear();
+    queue.uniforms.clear();
+    queue.uniformData.clear();
+    queue.openSet = 0;
+}
+
+static void pushUniform(RenderQueue& queue, UniformName name, DrawUniformType type, const void* words, size_t count) {
+    queue.uniforms.push_back({ name, type, static_cast<uint32_t>(queue.uniformData.size()) });
+    const size_t at = queue.uniformData.size();
+    queue.uniformData.resize(at + count);
+    std::memcpy(queue.uniformData.data() + at, words, count * sizeof(uint32_t));
+}
+
+void queueUniform(RenderQueue& queue, UniformName name, int value) {
+    pushUniform(queue, name, DRAW_UNIFORM_INT, &value, 1);
+}
+
+void queueUniform(RenderQueue& queue, UniformName name, float value) {
+    pushUniform(queue, name, DRAW_UNIFORM_FLOAT, &value, 1);
+}
+
+void queueUniform(RenderQueue& queue, UniformName name, const glm::vec3& value) {
+    const float v[3] = { value.x, value.y, value.z };
+    pushUniform(queue, name, DRAW_UNIFORM_VEC3, v, 3);
+}
+
+void queueUniform(RenderQueue& queue, UniformName name, const glm::mat4& value) {
+    float m[16];
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r) m[c * 4 + r] = value[c][r];
+    pushUniform(queue, name, DRAW_UNIFORM_MAT4, m, 16);
+}
+
+UniformSet takeUniformSet(RenderQueue& queue) {
+    UniformSet set;
+    set.first = queue.openSet;
+    set.count = static_cast<uint32_t>(queue.uniforms.size()) - queue.openSet;
+    queue.openSet = static_cast<uint32_t>(queue.uniforms.size());
+    return set;
+}
+
+void submitDraw(RenderQueue& queue, const DrawPacket& packet) {
+    queue.packets.push_back(packet);
+}
+
+void submitMesh(RenderQueue& queue, const DrawPacket& packet, const MeshDraw& draw) {
+    DrawPacket p = packet;
+    p.decode = &draw;
+    p.indexType = draw.indexType;
+    for (const SubMesh& batch : draw.batches) {
+        p.range = batch;
+        submitDraw(queue, p);
+    }
+}
+
+uint64_t renderSortKey(const RenderQueue& queue, const DrawPacket& packet) {
+    const GLuint diffuse = packet.cubeMap ? packet.cubeMap : packet.textures[0] == kAnyTexture ? 0 : packet.textures[0];
+    const GLuint normal = packet.textures[1] == kAnyTexture ? 0 : packet.textures[1];
+    const uint64_t program = packet.program ? packet.program->id & 0xff : 0;
+    const uint64_t material = (diffuse & 0xff) << 8 | (normal & 0xff);
+    const float depth = std::min(std::max(packet.depth / queue.farPlane, 0.0f), 1.0f);
+    return static_cast<uint64_t>(packet.pass & 3) << 62 | program << 54 | material << 38
+        | static_cast<uint64_t>(packet.vao & 0x3fff) << 24 | static_cast<uint64_t>(depth * 16777215.0f);
+}
+
+void radixSortKeys(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    if (entries.size() < 2) return;
+    // All eight histograms in one read of the keys.
+    std::vector<size_t> counts(8 * 256, 0);
+    for (const SortEntry& e : entries)
+        for (int b = 0; b < 8; ++b) ++counts[b * 256 + ((e.key >> (b * 8)) & 0xff)];
+    scratch.resize(entries.size());
+    for (int b = 0; b < 8; ++b) {
+        size_t* count = &counts[b * 256];
+        const int shift = b * 8;
+        if (count[(entries[0].key >> shift) & 0xff] == entries.size()) continue;
+        size_t sum = 0;
+        for (int i = 0; i < 256; ++i) {
+            const size_t c = count[i];
+            count[i] = sum;
+            sum += c;
+        }
+        for (const SortEntry& e : entries) scratch[count[(e.key >> shift) & 0xff]++] = e;
+        entries.swap(scratch);
+    }
+}
+
+// What the backend last set; known == false means "must set before relying on it". The fixed-function
+// flags start at the defaults executeRenderQueue leaves behind.
+struct BackendState {
+    ShaderProgram* program = nullptr;
+    bool vaoKnown = false;
+    GLuint vao = 0;
+    bool textureKnown[2] = { false, false };
+    GLuint textures[2] = { 0, 0 };
+    bool cubeKnown = false;
+    GLuint cubeMap = 0;
+    int activeUnit = -1;
+    uint32_t state = 0;
+    bool objectKnown = false;
+    DynamicAllocation object;
+};
+
+static const uint32_t kAllStates = RS_NO_CULL | RS_DEPTH_LEQUAL | RS_POLYGON_OFFSET_LINE;
+
+static void applyState(BackendState& b, uint32_t wanted, RenderQueueStats& stats) {
+    const uint32_t changed = (b.state ^ wanted) & kAllStates;
+    for (uint32_t flag = 1; flag & kAllStates; flag <<= 1) {
+        if (!(changed & flag)) {
+            ++stats.statesSkipped;
+            continue;
+        }
+        const bool on = (wanted & flag) != 0;
+        if (flag == RS_NO_CULL) {
+            if (on) glDisable(GL_CULL_FACE);
+            else glEnable(GL_CULL_FACE);
+        }
+        else if (flag == RS_DEPTH_LEQUAL) {
+            glDepthFunc(on ? GL_LEQUAL : GL_LESS);
+        }
+        else if (on) {
+            glEnable(GL_POLYGON_OFFSET_LINE);
+            glPolygonOffset(-1.0f, -1.0f);
+        }
+        else {
+            glDisable(GL_POLYGON_OFFSET_LINE);
+        }
+        ++stats.stateChanges;
+    }
+    b.state = wanted;
+}
+
+static void bindTextureUnit(BackendState& b, int unit, GLenum target, GLuint texture, bool& known, GLuint& bound,
+    RenderQueueStats& stats, RenderStats& frameStats) {
+    if (known && bound == texture) {
+        ++stats.texturesSkipped;
+        return;
+    }
+    if (b.activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        b.activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    known = true;
+    bound = texture;
+    ++stats.textureBinds;
+    ++frameStats.textureBinds;
+}
+
+static void applyUniforms(const RenderQueue& queue, const DrawPacket& p, UniformSet set) {
+    for (uint32_t i = set.first; i < set.first + set.count; ++i) {
+        const DrawUniform& u = queue.uniforms[i];
+        const uint32_t* words = queue.uniformData.data() + u.offset;
+        switch (u.type) {
+        case DRAW_UNIFORM_INT: {
+            int v;
+            std::memcpy(&v, words, sizeof(v));
+            setUniform(*p.program, u.name, v);
+            break;
+        }
+        case DRAW_UNIFORM_FLOAT: {
+            float v;
+            std::memcpy(&v, words, sizeof(v));
+            setUniform(*p.program, u.name, v);
+            break;
+        }
+        case DRAW_UNIFORM_VEC3: {
+            float v[3];
+            std::memcpy(v, words, sizeof(v));
+            setUniform(*p.program, u.name, glm::vec3(v[0], v[1], v[2]));
+            break;
+        }
+        case DRAW_UNIFORM_MAT4: {
+            float v[16];
+            std::memcpy(v, words, sizeof(v));
+            glm::mat4 m(1.0f);
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r) m[c][r] = v[c * 4 + r];
+            setUniform(*p.program, u.name, m);
+            break;
+        }
+        }
+    }
+}
+
+void executeRenderQueue(RenderQueue& queue, RenderStats& frameStats) {
+    const auto sortBegin = std::chrono::steady_clock::now();
+    queue.order.resize(queue.packets.size());
+    for (size_t i = 0; i < queue.packets.size(); ++i)
+        queue.order[i] = { renderSortKey(queue, queue.packets[i]), static_cast<uint32_t>(i) };
+    radixSortKeys(queue.order, queue.scratch);
+    RenderQueueStats& stats = queue.stats;
+    stats.sortMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortBegin).count();
+
+    BackendState b;
+    for (const SortEntry& entry : queue.order) {
+        const DrawPacket& p = queue.packets[entry.packet];
+        applyState(b, p.state, stats);
+
+        if (p.program != b.program) {
+            glUseProgram(p.program->id);
+            b.program = p.program;
+            ++stats.programBinds;
+        }
+        else {
+            ++stats.programsSkipped;
+        }
+        if (p.object.size) {
+            if (!b.objectKnown || b.object.buffer != p.object.buffer || b.object.offset != p.object.offset
+                || b.object.size != p.object.size) {
+                glBindBufferRange(GL_UNIFORM_BUFFER, queue.objectBinding, p.object.buffer,
+                    static_cast<GLintptr>(p.object.offset), static_cast<GLsizeiptr>(p.object.size));
+                b.object = p.object;
+                b.objectKnown = true;
+                ++stats.blockBinds;
+            }
+            else {
+                ++stats.blocksSkipped;
+            }
+        }
+        applyUniforms(queue, p, p.uniforms);
+        applyUniforms(queue, p, p.materialUniforms);
+        setVertexDecode(*p.program, p.decode);
+
+        if (!b.vaoKnown || b.vao != p.vao) {
+            glBindVertexArray(p.vao);
+            b.vao = p.vao;
+            b.vaoKnown = true;
+            ++stats.vaoBinds;
+        }
+        else {
+            ++stats.vaosSkipped;
+        }
+
+        for (int unit = 0; unit < 2; ++unit) {
+            if (p.textures[unit] != kAnyTexture)
+                bindTextureUnit(b, unit, GL_TEXTURE_2D, p.textures[unit], b.textureKnown[unit], b.textures[unit], stats, frameStats);
+        }
+        if (p.cubeMap) bindTextureUnit(b, 0, GL_TEXTURE_CUBE_MAP, p.cubeMap, b.cubeKnown, b.cubeMap, stats, frameStats);
+
+        const size_t indexSize = p.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+        const void* offset = (const void*)(p.range.indexOffset * indexSize);
+        const GLsizei count = static_cast<GLsizei>(p.range.indexCount);
+        if (p.instances > 0)
+            glDrawElementsInstanced(GL_TRIANGLES, count, p.indexType, offset, p.instances);
+        else if (p.range.baseVertex == 0)
+            glDrawElements(GL_TRIANGLES, count, p.indexType, offset);
+        else
+            glDrawElementsBaseVertex(GL_TRIANGLES, count, p.indexType, offset, p.range.baseVertex);
+        ++stats.draws;
+        ++frameStats.drawCalls;
+    }
+    applyState(b, 0, stats);
+}
+
+RenderQueueStats takeRenderQueueStats(RenderQueue& queue) {
+    RenderQueueStats stats = queue.stats;
+    queue.stats = RenderQueueStats();
+    return stats;
+}
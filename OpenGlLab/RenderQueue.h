@@ -0,0 +1,112 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "DynamicBuffer.h"
+#include "MeshPacking.h"
+#include "ShaderProgram.h"
+#include <cstdint>
+#include <vector>
+
+// Passes run in this order; the pass is the top of the sort key.
+enum RenderPass : uint32_t {
+    PASS_OPAQUE = 0,
+    PASS_OVERLAY = 1,       // wireframes over the opaque pass (polygon offset)
+    PASS_SKY = 2            // depth LEQUAL at the far plane, fills what is left
+};
+
+// Fixed-function state a packet needs; everything off is the default (cull back faces, depth LESS).
+enum RenderStateFlags : uint32_t {
+    RS_NO_CULL = 1,
+    RS_DEPTH_LEQUAL = 2,
+    RS_POLYGON_OFFSET_LINE = 4  // glPolygonOffset(-1, -1) on lines
+};
+
+// Texture name meaning "this draw does not sample the unit": whatever is bound stays.
+const GLuint kAnyTexture = GLuint(-1);
+
+// Uniforms queued with queueUniform and closed with takeUniformSet; any number of packets may share one.
+struct UniformSet {
+    uint32_t first = 0, count = 0;
+};
+
+// One draw. Packets run in sorted order, so between them they must set every per-draw uniform their
+// program reads (the object's set, then the material's).
+struct DrawPacket {
+    RenderPass pass = PASS_OPAQUE;
+    uint32_t state = 0;                 // RenderStateFlags
+    ShaderProgram* program = nullptr;
+    GLuint vao = 0;
+    GLuint textures[2] = { kAnyTexture, kAnyTexture };  // GL_TEXTURE_2D on units 0/1
+    GLuint cubeMap = 0;                 // GL_TEXTURE_CUBE_MAP on unit 0, if any
+    const MeshDraw* decode = nullptr;   // vertex decode (setVertexDecode); nullptr = float layout
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    SubMesh range = SubMesh();
+    GLsizei instances = 0;              // > 0: glDrawElementsInstanced (baseVertex must be 0)
+    float depth = 0.0f;                 // view distance; sorts front to back within equal state
+    UniformSet uniforms;
+    UniformSet materialUniforms;
+    DynamicAllocation object;           // per-object uniform block bound at RenderQueue::objectBinding, if size > 0
+};
+
+enum DrawUniformType : uint32_t { DRAW_UNIFORM_INT, DRAW_UNIFORM_FLOAT, DRAW_UNIFORM_VEC3, DRAW_UNIFORM_MAT4 };
+
+struct DrawUniform {
+    UniformName name;
+    DrawUniformType type;
+    uint32_t offset;                    // into RenderQueue::uniformData (raw 32-bit words)
+};
+
+struct SortEntry {
+    uint64_t key;
+    uint32_t packet;
+};
+
+struct RenderQueueStats {
+    unsigned int draws = 0;
+    unsigned int programBinds = 0, programsSkipped = 0;
+    unsigned int vaoBinds = 0, vaosSkipped = 0;
+    unsigned int textureBinds = 0, texturesSkipped = 0;     // glBindTexture; glActiveTexture is not counted
+    unsigned int stateChanges = 0, statesSkipped = 0;       // glEnable/glDisable/glDepthFunc/glPolygonOffset
+    unsigned int blockBinds = 0, blocksSkipped = 0;         // glBindBufferRange of the object block
+    double sortMs = 0.0;
+};
+
+// Frame protocol: beginRenderQueue, queueUniform/takeUniformSet/submitDraw for every draw in any
+// order, executeRenderQueue. Packets are ordered by a 64-bit key
+//   pass:2 | program:8 | material:16 | vao:14 | depth:24
+// (program, textures and VAO are their GL names folded into the field, so a collision only costs a
+// redundant bind) with a radix sort, then replayed by a backend that remembers the GL state it set
+// and skips binds and enables that would not change it.
+struct RenderQueue {
+    std::vector<DrawPacket> packets;
+    std::vector<DrawUniform> uniforms;
+    std::vector<uint32_t> uniformData;
+    uint32_t openSet = 0;               // first uniform not yet taken into a set
+    std::vector<SortEntry> order, scratch;
+    float farPlane = 100.0f;            // depth is quantized over [0, farPlane]
+    GLuint objectBinding = 0;           // uniform buffer binding index of DrawPacket::object
+    RenderQueueStats stats;             // summed over frames; see takeRenderQueueStats
+};
+
+void beginRenderQueue(RenderQueue& queue);
+void queueUniform(RenderQueue& queue, UniformName name, int value);
+void queueUniform(RenderQueue& queue, UniformName name, float value);
+void queueUniform(RenderQueue& queue, UniformName name, const glm::vec3& value);
+void queueUniform(RenderQueue& queue, UniformName name, const glm::mat4& value);
+// The uniforms queued since the previous call.
+UniformSet takeUniformSet(RenderQueue& queue);
+void submitDraw(RenderQueue& queue, const DrawPacket& packet);
+// A whole mesh ignoring materials (as drawMesh): one packet per batch, decoded as draw.
+void submitMesh(RenderQueue& queue, const DrawPacket& packet, const MeshDraw& draw);
+uint64_t renderSortKey(const RenderQueue& queue, const DrawPacket& packet);
+
+// LSD radix sort on the keys, 8 bits per pass; passes where every key has the same byte are skipped.
+// Stable, so equal keys keep their submission order.
+void radixSortKeys(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+// Sorts and issues every packet. Bindings (program, VAO, textures, object block) are assumed unknown on
+// entry, since other code binds freely between frames; the RenderStateFlags state must be at the
+// defaults (culling on, depth LESS, no polygon offset) and is left that way.
+void executeRenderQueue(RenderQueue& queue, RenderStats& frameStats);
+
+RenderQueueStats takeRenderQueueStats(RenderQueue& queue);
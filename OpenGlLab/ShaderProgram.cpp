@@ -0,0 +1,245 @@
+#include "ShaderProgram.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+struct UniformNames {
+    std::mutex mutex;
+    std::unordered_map<std::string, UniformName> ids;
+    std::deque<std::string> strings;    // [id - 1]; a deque keeps c_str() pointers valid as it grows
+};
+
+static UniformNames& uniformNames() {
+    static UniformNames names;
+    return names;
+}
+
+UniformName internUniform(const char* name) {
+    UniformNames& names = uniformNames();
+    std::lock_guard<std::mutex> lock(names.mutex);
+    auto it = names.ids.find(name);
+    if (it != names.ids.end()) return it->second;
+    names.strings.emplace_back(name);
+    const UniformName id = static_cast<UniformName>(names.strings.size());
+    names.ids.emplace(name, id);
+    return id;
+}
+
+const char* uniformNameString(UniformName name) {
+    UniformNames& names = uniformNames();
+    std::lock_guard<std::mutex> lock(names.mutex);
+    return name && name <= names.strings.size() ? names.strings[name - 1].c_str() : "";
+}
+
+static uint32_t tableHash(UniformName name) {
+    uint32_t h = name * 0x9e3779b1u;
+    return h ^ (h >> 16);
+}
+
+void reflectProgram(ShaderProgram& program, GLuint id) {
+    program = ShaderProgram();
+    program.id = id;
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buf(std::max(maxLength, 1) + 1);
+    for (GLint i = 0; i < count; ++i) {
+        UniformSlot slot;
+        GLsizei length = 0;
+        glGetActiveUniform(id, static_cast<GLuint>(i), static_cast<GLsizei>(buf.size()), &length, &slot.size, &slot.type, buf.data());
+        std::string name(buf.data(), length);
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) name.resize(name.size() - 3);
+        slot.location = glGetUniformLocation(id, name.c_str());
+        if (slot.location < 0) continue;    // member of a uniform block
+        slot.name = internUniform(name.c_str());
+        program.uniforms.push_back(slot);
+    }
+
+    size_t tableSize = 16;
+    while (tableSize < program.uniforms.size() * 2) tableSize *= 2;
+    program.table.assign(tableSize, -1);
+    for (size_t i = 0; i < program.uniforms.size(); ++i) {
+        size_t t = tableHash(program.uniforms[i].name) & (tableSize - 1);
+        while (program.table[t] >= 0) t = (t + 1) & (tableSize - 1);
+        program.table[t] = static_cast<int32_t>(i);
+    }
+
+    GLint blockCount = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    for (GLint i = 0; i < blockCount; ++i) {
+        char name[256];
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(id, static_cast<GLuint>(i), sizeof(name), &length, name);
+        UniformBlockInfo block;
+        block.name = internUniform(name);
+        block.index = static_cast<GLuint>(i);
+        glGetActiveUniformBlockiv(id, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+        program.blocks.push_back(block);
+    }
+}
+
+static const UniformSlot* findSlot(const ShaderProgram& program, UniformName name) {
+    if (program.table.empty()) return nullptr;
+    const size_t mask = program.table.size() - 1;
+    for (size_t t = tableHash(name) & mask;; t = (t + 1) & mask) {
+        const int32_t i = program.table[t];
+        if (i < 0) return nullptr;
+        if (program.uniforms[i].name == name) return &program.uniforms[i];
+    }
+}
+
+static UniformSlot* findSlot(ShaderProgram& program, UniformName name) {
+    return const_cast<UniformSlot*>(findSlot(static_cast<const ShaderProgram&>(program), name));
+}
+
+GLint uniformLocation(const ShaderProgram& program, UniformName name) {
+    const UniformSlot* slot = findSlot(program, name);
+    return slot ? slot->location : -1;
+}
+
+GLuint uniformBlockIndex(const ShaderProgram& program, UniformName name) {
+    for (const UniformBlockInfo& block : program.blocks)
+        if (block.name == name) return block.index;
+    return GL_INVALID_INDEX;
+}
+
+bool bindUniformBlock(ShaderProgram& program, UniformName name, GLuint binding) {
+    const GLuint index = uniformBlockIndex(program, name);
+    if (index == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(program.id, index, binding);
+    return true;
+}
+
+// Slot to upload into, or nullptr when the uniform is missing or already holds the value.
+static UniformSlot* changedSlot(ShaderProgram& program, UniformName name, const void* value, size_t bytes) {
+    UniformSlot* slot = findSlot(program, name);
+    if (!slot) return nullptr;
+    if (bytes > sizeof(slot->value)) {
+        slot->cached = false;
+    }
+    else {
+        if (slot->cached && std::memcmp(slot->value, value, bytes) == 0) {
+            ++program.stats.skipped;
+            return nullptr;
+        }
+        std::memcpy(slot->value, value, bytes);
+        slot->cached = true;
+    }
+    ++program.stats.uploads;
+    return slot;
+}
+
+void setUniform(ShaderProgram& program, UniformName name, int value) {
+    if (UniformSlot* slot = changedSlot(program, name, &value, sizeof(value))) glUniform1i(slot->location, value);
+}
+
+void setUniform(ShaderProgram& program, UniformName name, unsigned int value) {
+    if (UniformSlot* slot = changedSlot(program, name, &value, sizeof(value))) glUniform1ui(slot->location, value);
+}
+
+void setUniform(ShaderProgram& program, UniformName name, float value) {
+    if (UniformSlot* slot = changedSlot(program, name, &value, sizeof(value))) glUniform1f(slot->location, value);
+}
+
+void setUniform(ShaderProgram& program, UniformName name, const glm::vec2& value) {
+    const float v[2] = { value.x, value.y };
+    if (UniformSlot* slot = changedSlot(program, name, v, sizeof(v))) glUniform2fv(slot->location, 1, v);
+}
+
+void setUniform(ShaderProgram& program, UniformName name, const glm::vec3& value) {
+    const float v[3] = { value.x, value.y, value.z };
+    if (UniformSlot* slot = changedSlot(program, name, v, sizeof(v))) glUniform3fv(slot->location, 1, v);
+}
+
+void setUniform(ShaderProgram& program, UniformName name, const glm::mat4& value) {
+    float m[16];
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r) m[c * 4 + r] = value[c][r];
+    if (UniformSlot* slot = changedSlot(program, name, m, sizeof(m))) glUniformMatrix4fv(slot->location, 1, GL_FALSE, m);
+}
+
+void setUniformArray(ShaderProgram& program, UniformName name, const glm::vec3* values, int count) {
+    const float* v = &values[0].x;      // glm::vec3 is three packed floats
+    if (UniformSlot* slot = changedSlot(program, name, v, count * 3 * sizeof(float))) glUniform3fv(slot->location, count, v);
+}
+
+UniformStats takeUniformStats(ShaderProgram* const* programs, size_t count) {
+    UniformStats total;
+    for (size_t i = 0; i < count; ++i) {
+        total.uploads += programs[i]->stats.uploads;
+        total.skipped += programs[i]->stats.skipped;
+        programs[i]->stats = UniformStats();
+    }
+    return total;
+}
+
+std::string loadShaderSource(const char* path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Could not open shader file: " << path << "\n";
+        return "";
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+std::string withDefine(const std::string& source, const char* name) {
+    size_t at = 0;
+    if (source.compare(0, 8, "#version") == 0) {
+        at = source.find('\n');
+        at = at == std::string::npos ? source.size() : at + 1;
+    }
+    std::string out = source.substr(0, at);
+    if (at == source.size() && (at == 0 || source[at - 1] != '\n')) out += '\n';
+    out += "#define ";
+    out += name;
+    out += '\n';
+    out.append(source, at, std::string::npos);
+    return out;
+}
+
+static GLuint compileShader(GLenum type, const char* src) {
+    GLuint id = glCreateShader(type);
+    glShaderSource(id, 1, &src, nullptr);
+    glCompileShader(id);
+
+    GLint ok; glGetShaderiv(id, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char buf[1024]; glGetShaderInfoLog(id, 1024, nullptr, buf);
+        std::cerr << "Shader compile error: " << buf << std::endl;
+    }
+    return id;
+}
+
+static GLuint linkProgram(const GLuint* shaders, int count) {
+    GLuint p = glCreateProgram();
+    for (int i = 0; i < count; ++i) glAttachShader(p, shaders[i]);
+    glLinkProgram(p);
+
+    GLint ok; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char buf[1024]; glGetProgramInfoLog(p, 1024, nullptr, buf);
+        std::cerr << "Link error: " << buf << std::endl;
+    }
+    for (int i = 0; i < count; ++i) glDeleteShader(shaders[i]);
+    return p;
+}
+
+GLuint createProgram(const char* vs, const char* fs) {
+    const GLuint shaders[] = { compileShader(GL_VERTEX_SHADER, vs), compileShader(GL_FRAGMENT_SHADER, fs) };
+    return linkProgram(shaders, 2);
+}
+
+GLuint createProgramWithGS(const char* vs, const char* gs, const char* fs) {
+    const GLuint shaders[] = { compileShader(GL_VERTEX_SHADER, vs), compileShader(GL_GEOMETRY_SHADER, gs),
+        compileShader(GL_FRAGMENT_SHADER, fs) };
+    return linkProgram(shaders, 3);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Interned uniform name: the same string always gives the same id, so per-frame lookups hash a small
+// integer instead of a string. 0 is never a valid name.
+typedef uint32_t UniformName;
+UniformName internUniform(const char* name);
+const char* uniformNameString(UniformName name);
+
+struct UniformSlot {
+    UniformName name = 0;
+    GLint location = -1;
+    GLenum type = 0;
+    GLint size = 1;                     // array length
+    bool cached = false;                // value holds what the program has now
+    uint32_t value[16];                 // last upload (up to a mat4 or 16 scalars); raw bits
+};
+
+struct UniformBlockInfo {
+    UniformName name = 0;
+    GLuint index = GL_INVALID_INDEX;
+    GLint dataSize = 0;
+};
+
+struct UniformStats {
+    unsigned int uploads = 0;           // glUniform* calls made
+    unsigned int skipped = 0;           // setter calls with the value the program already had
+};
+
+// Everything a linked program exposes, read once after linking (reflectProgram). Uniforms are found
+// through a flat open-addressing table keyed by UniformName; setters remember the last value per
+// uniform (uniforms are program state, so that stays exact across glUseProgram) and skip the call when
+// nothing changed. Setters act on the current program, which must be this one.
+struct ShaderProgram {
+    GLuint id = 0;
+    std::vector<UniformSlot> uniforms;
+    std::vector<int32_t> table;         // power of two; index into uniforms or -1
+    std::vector<UniformBlockInfo> blocks;
+    UniformStats stats;
+};
+
+// Enumerates active uniforms (arrays under their base name, without "[0]") and uniform blocks.
+void reflectProgram(ShaderProgram& program, GLuint id);
+// -1 when the program has no such active uniform; setters ignore those, as glUniform* does.
+GLint uniformLocation(const ShaderProgram& program, UniformName name);
+GLuint uniformBlockIndex(const ShaderProgram& program, UniformName name);
+// Points a uniform block at a buffer binding index (GLSL 330 has no layout(binding)). False when the
+// program has no such active block.
+bool bindUniformBlock(ShaderProgram& program, UniformName name, GLuint binding);
+
+void setUniform(ShaderProgram& program, UniformName name, int value);
+void setUniform(ShaderProgram& program, UniformName name, unsigned int value);
+void setUniform(ShaderProgram& program, UniformName name, float value);
+void setUniform(ShaderProgram& program, UniformName name, const glm::vec2& value);
+void setUniform(ShaderProgram& program, UniformName name, const glm::vec3& value);
+void setUniform(ShaderProgram& program, UniformName name, const glm::mat4& value);
+void setUniformArray(ShaderProgram& program, UniformName name, const glm::vec3* values, int count);
+
+// Shader sources are read from files relative to the working directory; "" (and a message) when missing.
+std::string loadShaderSource(const char* path);
+// source with "#define name" after its #version line, for building variants of one shader file.
+std::string withDefine(const std::string& source, const char* name);
+// Compile errors and link errors go to std::cerr; the program name is returned either way.
+GLuint createProgram(const char* vs, const char* fs);
+GLuint createProgramWithGS(const char* vs, const char* gs, const char* fs);
+
+// Sums and clears the counters of the given programs (once per frame).
+UniformStats takeUniformStats(ShaderProgram* const* programs, size_t count);
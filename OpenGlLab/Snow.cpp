@@ -0,0 +1,469 @@
+#include "Snow.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+const size_t kSnowLanes = 8;    // streams are padded to whole AVX registers
+
+// ---- random numbers ----
+
+// Counter-based: a respawn draws from hash(seed, flake, step), so the result does not depend on the order
+// flakes are visited in (or on which kernel visits them).
+struct FlakeRandom {
+    uint32_t state;
+    FlakeRandom(uint32_t seed, uint32_t flake, uint32_t step) : state(hash32(seed ^ hash32(flake ^ hash32(step)))) {}
+    float next() {  // [0, 1)
+        state += 0x9e3779b9u;
+        return static_cast<float>(hash32(state) >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+static void spawnFlake(Snowfall& snow, size_t i, bool anyHeight) {
+    const SnowParams& p = snow.params;
+    FlakeRandom rnd(p.seed, static_cast<uint32_t>(i), anyHeight ? 0 : snow.step);
+    snow.x[i] = (rnd.next() * 2.0f - 1.0f) * p.extent;
+    snow.z[i] = (rnd.next() * 2.0f - 1.0f) * p.extent;
+    const float h = rnd.next();
+    snow.y[i] = anyHeight ? p.bottom + h * (p.top - p.bottom) : p.top;
+    snow.vx[i] = p.wind.x;
+    snow.vy[i] = p.wind.y - p.gravity / p.drag;
+    snow.vz[i] = p.wind.z;
+    snow.life[i] = p.lifeMin + rnd.next() * (p.lifeMax - p.lifeMin);
+    snow.phase[i] = rnd.next() * 6.2831853f;
+}
+
+void initSnowfall(Snowfall& snow, size_t count, const SnowParams& params) {
+    snow.params = params;
+    snow.count = count;
+    snow.time = 0.0f;
+    snow.step = 0;
+    const size_t padded = (count + kSnowLanes - 1) / kSnowLanes * kSnowLanes;
+    for (AlignedFloats* s : { &snow.x, &snow.y, &snow.z, &snow.vx, &snow.vy, &snow.vz, &snow.life, &snow.phase })
+        s->assign(padded, 0.0f);
+    for (size_t i = 0; i < padded; ++i) spawnFlake(snow, i, true);
+}
+
+// ---- integration ----
+
+// Per-update constants, shared by every kernel.
+struct SnowStep {
+    float dt, dragDt, gravityDt;
+    float windX, windY, windZ, turbulence;
+    float angle;            // turbulence angle without the per-flake phase
+    float extent, bottom;
+};
+
+// sin on any angle: reduce to [-pi, pi], parabola, one refinement step (error below 0.001). Every kernel
+// spells out the same operations in the same order, so all of them produce bit-identical results.
+const float kInvTwoPi = 0.15915494f, kTwoPi = 6.2831853f;
+const float kSinB = 1.2732395f, kSinC = -0.40528473f, kSinP = 0.225f;
+const float kGustRatio = 1.37f, kGustShift = 1.7f;     // z gusts: another frequency, so paths are not lines
+
+static float fastSin(float a) {
+    a = a - std::nearbyint(a * kInvTwoPi) * kTwoPi;
+    float s = a * (kSinB + kSinC * std::fabs(a));
+    return s + kSinP * (s * std::fabs(s) - s);
+}
+
+// Advances one flake; true when it has to respawn.
+static bool integrateScalar(Snowfall& snow, const SnowStep& st, size_t i) {
+    const float a = st.angle + snow.phase[i];
+    const float tx = st.windX + st.turbulence * fastSin(a);
+    const float tz = st.windZ + st.turbulence * fastSin(a * kGustRatio + kGustShift);
+    const float vx = snow.vx[i] + st.dragDt * (tx - snow.vx[i]);
+    const float vy = snow.vy[i] + (st.dragDt * (st.windY - snow.vy[i]) - st.gravityDt);
+    const float vz = snow.vz[i] + st.dragDt * (tz - snow.vz[i]);
+    const float x = snow.x[i] + vx * st.dt;
+    const float y = snow.y[i] + vy * st.dt;
+    const float z = snow.z[i] + vz * st.dt;
+    const float life = snow.life[i] - st.dt;
+    snow.vx[i] = vx; snow.vy[i] = vy; snow.vz[i] = vz;
+    snow.x[i] = x; snow.y[i] = y; snow.z[i] = z;
+    snow.life[i] = life;
+    return y < st.bottom || life <= 0.0f || std::fabs(x) > st.extent || std::fabs(z) > st.extent;
+}
+
+static void respawnMask(Snowfall& snow, size_t base, int mask) {
+    for (int k = 0; mask; ++k, mask >>= 1)
+        if (mask & 1) spawnFlake(snow, base + k, false);
+}
+
+static void simulateScalar(Snowfall& snow, const SnowStep& st, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+        if (integrateScalar(snow, st, i)) spawnFlake(snow, i, false);
+}
+
+#ifdef SIMD_X86
+static __m128 fastSinSSE(__m128 a) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    a = _mm_sub_ps(a, _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps(kInvTwoPi)))), _mm_set1_ps(kTwoPi)));
+    const __m128 s = _mm_mul_ps(a, _mm_add_ps(_mm_set1_ps(kSinB), _mm_mul_ps(_mm_set1_ps(kSinC), _mm_andnot_ps(signMask, a))));
+    return _mm_add_ps(s, _mm_mul_ps(_mm_set1_ps(kSinP), _mm_sub_ps(_mm_mul_ps(s, _mm_andnot_ps(signMask, s)), s)));
+}
+
+static void simulateSSE(Snowfall& snow, const SnowStep& st, size_t begin, size_t end) {
+    const __m128 dt = _mm_set1_ps(st.dt), dragDt = _mm_set1_ps(st.dragDt), gravityDt = _mm_set1_ps(st.gravityDt);
+    const __m128 windX = _mm_set1_ps(st.windX), windY = _mm_set1_ps(st.windY), windZ = _mm_set1_ps(st.windZ);
+    const __m128 turbulence = _mm_set1_ps(st.turbulence), angle = _mm_set1_ps(st.angle);
+    const __m128 extent = _mm_set1_ps(st.extent), bottom = _mm_set1_ps(st.bottom);
+    const __m128 signMask = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps();
+    for (size_t i = begin; i < end; i += 4) {
+        const __m128 a = _mm_add_ps(angle, _mm_load_ps(&snow.phase[i]));
+        const __m128 tx = _mm_add_ps(windX, _mm_mul_ps(turbulence, fastSinSSE(a)));
+        const __m128 tz = _mm_add_ps(windZ, _mm_mul_ps(turbulence,
+            fastSinSSE(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(kGustRatio)), _mm_set1_ps(kGustShift)))));
+        __m128 vx = _mm_load_ps(&snow.vx[i]), vy = _mm_load_ps(&snow.vy[i]), vz = _mm_load_ps(&snow.vz[i]);
+        vx = _mm_add_ps(vx, _mm_mul_ps(dragDt, _mm_sub_ps(tx, vx)));
+        vy = _mm_add_ps(vy, _mm_sub_ps(_mm_mul_ps(dragDt, _mm_sub_ps(windY, vy)), gravityDt));
+        vz = _mm_add_ps(vz, _mm_mul_ps(dragDt, _mm_sub_ps(tz, vz)));
+        const __m128 x = _mm_add_ps(_mm_load_ps(&snow.x[i]), _mm_mul_ps(vx, dt));
+        const __m128 y = _mm_add_ps(_mm_load_ps(&snow.y[i]), _mm_mul_ps(vy, dt));
+        const __m128 z = _mm_add_ps(_mm_load_ps(&snow.z[i]), _mm_mul_ps(vz, dt));
+        const __m128 life = _mm_sub_ps(_mm_load_ps(&snow.life[i]), dt);
+        _mm_store_ps(&snow.vx[i], vx); _mm_store_ps(&snow.vy[i], vy); _mm_store_ps(&snow.vz[i], vz);
+        _mm_store_ps(&snow.x[i], x); _mm_store_ps(&snow.y[i], y); _mm_store_ps(&snow.z[i], z);
+        _mm_store_ps(&snow.life[i], life);
+        const __m128 dead = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(y, bottom), _mm_cmple_ps(life, zero)),
+            _mm_or_ps(_mm_cmpgt_ps(_mm_andnot_ps(signMask, x), extent), _mm_cmpgt_ps(_mm_andnot_ps(signMask, z), extent)));
+        if (int mask = _mm_movemask_ps(dead)) respawnMask(snow, i, mask);
+    }
+}
+
+TARGET_AVX static __m256 fastSinAVX(__m256 a) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    a = _mm256_sub_ps(a, _mm256_mul_ps(_mm256_round_ps(_mm256_mul_ps(a, _mm256_set1_ps(kInvTwoPi)),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC), _mm256_set1_ps(kTwoPi)));
+    const __m256 s = _mm256_mul_ps(a, _mm256_add_ps(_mm256_set1_ps(kSinB), _mm256_mul_ps(_mm256_set1_ps(kSinC), _mm256_andnot_ps(signMask, a))));
+    return _mm256_add_ps(s, _mm256_mul_ps(_mm256_set1_ps(kSinP), _mm256_sub_ps(_mm256_mul_ps(s, _mm256_andnot_ps(signMask, s)), s)));
+}
+
+TARGET_AVX static void simulateAVX(Snowfall& snow, const SnowStep& st, size_t begin, size_t end) {
+    const __m256 dt = _mm256_set1_ps(st.dt), dragDt = _mm256_set1_ps(st.dragDt), gravityDt = _mm256_set1_ps(st.gravityDt);
+    const __m256 windX = _mm256_set1_ps(st.windX), windY = _mm256_set1_ps(st.windY), windZ = _mm256_set1_ps(st.windZ);
+    const __m256 turbulence = _mm256_set1_ps(st.turbulence), angle = _mm256_set1_ps(st.angle);
+    const __m256 extent = _mm256_set1_ps(st.extent), bottom = _mm256_set1_ps(st.bottom);
+    const __m256 signMask = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+    for (size_t i = begin; i < end; i += 8) {
+        const __m256 a = _mm256_add_ps(angle, _mm256_load_ps(&snow.phase[i]));
+        const __m256 tx = _mm256_add_ps(windX, _mm256_mul_ps(turbulence, fastSinAVX(a)));
+        const __m256 tz = _mm256_add_ps(windZ, _mm256_mul_ps(turbulence,
+            fastSinAVX(_mm256_add_ps(_mm256_mul_ps(a, _mm256_set1_ps(kGustRatio)), _mm256_set1_ps(kGustShift)))));
+        __m256 vx = _mm256_load_ps(&snow.vx[i]), vy = _mm256_load_ps(&snow.vy[i]), vz = _mm256_load_ps(&snow.vz[i]);
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(dragDt, _mm256_sub_ps(tx, vx)));
+        vy = _mm256_add_ps(vy, _mm256_sub_ps(_mm256_mul_ps(dragDt, _mm256_sub_ps(windY, vy)), gravityDt));
+        vz = _mm256_add_ps(vz, _mm256_mul_ps(dragDt, _mm256_sub_ps(tz, vz)));
+        const __m256 x = _mm256_add_ps(_mm256_load_ps(&snow.x[i]), _mm256_mul_ps(vx, dt));
+        const __m256 y = _mm256_add_ps(_mm256_load_ps(&snow.y[i]), _mm256_mul_ps(vy, dt));
+        const __m256 z = _mm256_add_ps(_mm256_load_ps(&snow.z[i]), _mm256_mul_ps(vz, dt));
+        const __m256 life = _mm256_sub_ps(_mm256_load_ps(&snow.life[i]), dt);
+        _mm256_store_ps(&snow.vx[i], vx); _mm256_store_ps(&snow.vy[i], vy); _mm256_store_ps(&snow.vz[i], vz);
+        _mm256_store_ps(&snow.x[i], x); _mm256_store_ps(&snow.y[i], y); _mm256_store_ps(&snow.z[i], z);
+        _mm256_store_ps(&snow.life[i], life);
+        const __m256 dead = _mm256_or_ps(
+            _mm256_or_ps(_mm256_cmp_ps(y, bottom, _CMP_LT_OQ), _mm256_cmp_ps(life, zero, _CMP_LE_OQ)),
+            _mm256_or_ps(_mm256_cmp_ps(_mm256_andnot_ps(signMask, x), extent, _CMP_GT_OQ),
+                _mm256_cmp_ps(_mm256_andnot_ps(signMask, z), extent, _CMP_GT_OQ)));
+        if (int mask = _mm256_movemask_ps(dead)) respawnMask(snow, i, mask);
+    }
+}
+#endif
+
+static SnowStep beginStep(Snowfall& snow, float deltaTime) {
+    const SnowParams& p = snow.params;
+    ++snow.step;
+    SnowStep st;
+    st.dt = deltaTime;
+    st.dragDt = p.drag * deltaTime;
+    st.gravityDt = p.gravity * deltaTime;
+    st.windX = p.wind.x;
+    st.windY = p.wind.y;
+    st.windZ = p.wind.z;
+    st.turbulence = p.turbulence;
+    st.angle = snow.time * p.turbulenceFrequency;
+    st.extent = p.extent;
+    st.bottom = p.bottom;
+    snow.time += deltaTime;
+    return st;
+}
+
+// begin and end are multiples of kSnowLanes.
+static void simulateRange(Snowfall& snow, const SnowStep& st, size_t begin, size_t end) {
+#ifdef SIMD_X86
+    if (snow.simd == SIMD_AVX && cpuHasAVX()) { simulateAVX(snow, st, begin, end); return; }
+    if (snow.simd != SIMD_SCALAR) { simulateSSE(snow, st, begin, end); return; }
+#endif
+    simulateScalar(snow, st, begin, end);
+}
+
+void updateSnowfall(Snowfall& snow, float deltaTime) {
+    const SnowStep st = beginStep(snow, deltaTime);
+    simulateRange(snow, st, 0, snow.x.size());
+}
+
+const size_t kSnowJobFlakes = 16384;    // 64 KB of every stream per job
+const size_t kSnowJobAlignment = 16;    // one cache line of floats
+
+void updateSnowfallAsync(Snowfall& snow, float deltaTime, JobSystem& jobs, JobCounter& done) {
+    const SnowStep st = beginStep(snow, deltaTime);
+    Snowfall* s = &snow;
+    submitRange(jobs, done, snow.x.size(), kSnowJobFlakes, kSnowJobAlignment,
+        [s, st](size_t begin, size_t end) { simulateRange(*s, st, begin, end); });
+}
+
+// ---- GL ----
+
+// Instance attributes 3..5 of the bound snow VAO: the x, y and z streams back to back from offset.
+static void pointInstanceStreams(const Snowfall& snow, GLuint buffer, size_t offset) {
+    const size_t stream = snow.count * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint k = 0; k < 3; ++k)
+        glVertexAttribPointer(3 + k, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(offset + k * stream));
+}
+
+void createSnowfallGL(Snowfall& snow, GLuint meshVBO, GLuint meshEBO, GLsizei indexCount, GLenum indexType) {
+    snow.indexCount = indexCount;
+    snow.indexType = indexType;
+    glGenVertexArrays(1, &snow.vao);
+    glGenBuffers(1, &snow.instanceVBO);
+    glBindVertexArray(snow.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    const size_t stream = snow.count * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, snow.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 3 * stream, nullptr, GL_STREAM_DRAW);
+    pointInstanceStreams(snow, snow.instanceVBO, 0);
+    for (GLuint k = 0; k < 3; ++k) {
+        glVertexAttribDivisor(3 + k, 1);
+        glEnableVertexAttribArray(3 + k);
+    }
+    glBindVertexArray(0);
+}
+
+void uploadSnowfall(Snowfall& snow) {
+    snow.drawCount = snow.count;
+    const GLsizeiptr stream = snow.count * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, snow.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, 3 * stream, nullptr, GL_STREAM_DRAW);     // orphan: no wait on last frame's draw
+    glBufferSubData(GL_ARRAY_BUFFER, 0, stream, snow.x.data());
+    glBufferSubData(GL_ARRAY_BUFFER, stream, stream, snow.y.data());
+    glBufferSubData(GL_ARRAY_BUFFER, 2 * stream, stream, snow.z.data());
+}
+
+void streamSnowfall(Snowfall& snow, DynamicBuffer& dynamic, const Frustum* frustum, CullStats* stats) {
+    if (snow.count == 0) return;
+    const size_t stream = snow.count * sizeof(float);
+    const DynamicAllocation a = allocDynamic(dynamic, 3 * stream);
+    glBindVertexArray(snow.vao);
+    if (!a.data) {
+        pointInstanceStreams(snow, snow.instanceVBO, 0);
+        glBindVertexArray(0);
+        uploadSnowfall(snow);
+        return;
+    }
+    float* dst = static_cast<float*>(a.data);
+    if (frustum) {
+        // The flake mesh is a unit cube scaled by params.scale: its bounding sphere has radius scale * sqrt(3) / 2.
+        const float radius = snow.params.scale * 0.8660254f;
+        snow.drawCount = cullSpheres(snow.x.data(), snow.y.data(), snow.z.data(), snow.count, radius, *frustum,
+            dst, dst + snow.count, dst + 2 * snow.count, snow.simd, stats);
+    }
+    else {
+        std::memcpy(dst, snow.x.data(), stream);
+        std::memcpy(dst + snow.count, snow.y.data(), stream);
+        std::memcpy(dst + 2 * snow.count, snow.z.data(), stream);
+        snow.drawCount = snow.count;
+    }
+    pointInstanceStreams(snow, a.buffer, a.offset);
+    glBindVertexArray(0);
+}
+
+void drawSnowfall(const Snowfall& snow, RenderStats* stats) {
+    const size_t instances = snow.gpu.program.id ? snow.count : snow.drawCount;
+    if (instances == 0) return;
+    glBindVertexArray(snow.gpu.program.id ? snow.gpu.drawVAO[snow.gpu.current] : snow.vao);
+    glDrawElementsInstanced(GL_TRIANGLES, snow.indexCount, snow.indexType, 0, static_cast<GLsizei>(instances));
+    if (stats) ++stats->drawCalls;
+}
+
+void submitSnowfall(RenderQueue& queue, const DrawPacket& packet, const Snowfall& snow) {
+    const size_t instances = snow.gpu.program.id ? snow.count : snow.drawCount;
+    if (instances == 0) return;
+    DrawPacket p = packet;
+    p.vao = snow.gpu.program.id ? snow.gpu.drawVAO[snow.gpu.current] : snow.vao;
+    p.indexType = snow.indexType;
+    p.range = SubMesh();
+    p.range.indexCount = static_cast<uint32_t>(snow.indexCount);
+    p.instances = static_cast<GLsizei>(instances);
+    submitDraw(queue, p);
+}
+
+void destroySnowfallGL(Snowfall& snow) {
+    if (snow.vao) glDeleteVertexArrays(1, &snow.vao);
+    if (snow.instanceVBO) glDeleteBuffers(1, &snow.instanceVBO);
+    snow.vao = snow.instanceVBO = 0;
+    SnowGpuState& gpu = snow.gpu;
+    if (gpu.program.id) {
+        glDeleteProgram(gpu.program.id);
+        glDeleteBuffers(2, gpu.state);
+        glDeleteVertexArrays(2, gpu.updateVAO);
+        glDeleteVertexArrays(2, gpu.drawVAO);
+    }
+    gpu = SnowGpuState();
+}
+
+// ---- GPU mode ----
+
+static GLuint createUpdateProgram(const char* path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Could not open shader file: " << path << "\n";
+        return 0;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    const std::string source = ss.str();
+    const char* src = source.c_str();
+
+    GLuint shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+    GLint ok;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char buf[1024]; glGetShaderInfoLog(shader, 1024, nullptr, buf);
+        std::cerr << "ERROR: " << path << ": " << buf << "\n";
+        glDeleteShader(shader);
+        return 0;
+    }
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    const char* varyings[] = { "tfPosLife", "tfVelPhase" };
+    glTransformFeedbackVaryings(program, 2, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char buf[1024]; glGetProgramInfoLog(program, 1024, nullptr, buf);
+        std::cerr << "ERROR: " << path << ": " << buf << "\n";
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+const GLsizei kGpuFlakeStride = 8 * sizeof(float);
+
+bool createSnowfallGPU(Snowfall& snow, const char* updateShaderPath, GLuint meshVBO, GLuint meshEBO,
+    GLsizei indexCount, GLenum indexType) {
+    GLuint program = createUpdateProgram(updateShaderPath);
+    if (!program) return false;
+    SnowGpuState& gpu = snow.gpu;
+    reflectProgram(gpu.program, program);
+    snow.indexCount = indexCount;
+    snow.indexType = indexType;
+
+    std::vector<float> initial(snow.count * 8);
+    for (size_t i = 0; i < snow.count; ++i) {
+        float* f = &initial[i * 8];
+        f[0] = snow.x[i]; f[1] = snow.y[i]; f[2] = snow.z[i]; f[3] = snow.life[i];
+        f[4] = snow.vx[i]; f[5] = snow.vy[i]; f[6] = snow.vz[i]; f[7] = snow.phase[i];
+    }
+    glGenBuffers(2, gpu.state);
+    glGenVertexArrays(2, gpu.updateVAO);
+    glGenVertexArrays(2, gpu.drawVAO);
+    for (int b = 0; b < 2; ++b) {
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.state[b]);
+        glBufferData(GL_ARRAY_BUFFER, initial.size() * sizeof(float), b == 0 ? initial.data() : nullptr, GL_DYNAMIC_COPY);
+
+        glBindVertexArray(gpu.updateVAO[b]);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, kGpuFlakeStride, (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, kGpuFlakeStride, (void*)(4 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        // Same attributes as createSnowfallGL, the coordinates now interleaved with the rest of the state.
+        glBindVertexArray(gpu.drawVAO[b]);
+        if (meshVBO) {
+            glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.state[b]);
+        for (GLuint k = 0; k < 3; ++k) {
+            glVertexAttribPointer(3 + k, 1, GL_FLOAT, GL_FALSE, kGpuFlakeStride, (void*)(k * sizeof(float)));
+            glVertexAttribDivisor(3 + k, 1);
+            glEnableVertexAttribArray(3 + k);
+        }
+    }
+    glBindVertexArray(0);
+    gpu.current = 0;
+
+    for (AlignedFloats* s : { &snow.x, &snow.y, &snow.z, &snow.vx, &snow.vy, &snow.vz, &snow.life, &snow.phase })
+        AlignedFloats().swap(*s);
+    return true;
+}
+
+void updateSnowfallGPU(Snowfall& snow, float deltaTime) {
+    static const UniformName dtName = internUniform("uDt"), dragDtName = internUniform("uDragDt");
+    static const UniformName gravityDtName = internUniform("uGravityDt"), windName = internUniform("uWind");
+    static const UniformName turbulenceName = internUniform("uTurbulence"), angleName = internUniform("uAngle");
+    static const UniformName extentName = internUniform("uExtent"), bottomName = internUniform("uBottom");
+    static const UniformName topName = internUniform("uTop"), lifeName = internUniform("uLife");
+    static const UniformName spawnVyName = internUniform("uSpawnVy"), seedName = internUniform("uSeed");
+    static const UniformName stepName = internUniform("uStep");
+    SnowGpuState& gpu = snow.gpu;
+    if (!gpu.program.id || snow.count == 0) return;
+    const SnowParams& p = snow.params;
+    const SnowStep st = beginStep(snow, deltaTime);
+    ShaderProgram& program = gpu.program;
+    glUseProgram(program.id);
+    setUniform(program, dtName, st.dt);
+    setUniform(program, dragDtName, st.dragDt);
+    setUniform(program, gravityDtName, st.gravityDt);
+    setUniform(program, windName, p.wind);
+    setUniform(program, turbulenceName, st.turbulence);
+    setUniform(program, angleName, st.angle);
+    setUniform(program, extentName, st.extent);
+    setUniform(program, bottomName, st.bottom);
+    setUniform(program, topName, p.top);
+    setUniform(program, lifeName, glm::vec2(p.lifeMin, p.lifeMax));
+    setUniform(program, spawnVyName, p.wind.y - p.gravity / p.drag);
+    setUniform(program, seedName, static_cast<unsigned int>(p.seed));
+    setUniform(program, stepName, static_cast<unsigned int>(snow.step));
+
+    const int next = 1 - gpu.current;
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(gpu.updateVAO[gpu.current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpu.state[next]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(snow.count));
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    gpu.current = next;
+}
+
+void readSnowfallGPU(const Snowfall& snow, std::vector<float>& state) {
+    state.resize(snow.count * 8);
+    if (!snow.gpu.program.id || state.empty()) return;
+    glBindBuffer(GL_ARRAY_BUFFER, snow.gpu.state[snow.gpu.current]);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, state.size() * sizeof(float), state.data());
+}
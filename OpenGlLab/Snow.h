@@ -0,0 +1,93 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "CpuFeatures.h"
+#include "Culling.h"
+#include "DynamicBuffer.h"
+#include "JobSystem.h"
+#include "MeshPacking.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include <cstdint>
+#include <vector>
+
+// Cache-line aligned, so job ranges of whole lines never share one with a neighbour.
+typedef std::vector<float, AlignedAllocator<float, 64>> AlignedFloats;
+
+struct SnowParams {
+    // Flakes are pulled by gravity and dragged towards the local wind; terminal fall speed is gravity / drag.
+    float gravity = 3.0f;
+    float drag = 2.0f;
+    glm::vec3 wind = glm::vec3(0.3f, 0.0f, 0.1f);
+    float turbulence = 0.6f;            // amplitude of the swaying gusts added to the wind, m/s
+    float turbulenceFrequency = 1.3f;   // rad/s
+    float extent = 10.0f;               // flakes live in [-extent, extent] horizontally
+    float top = 10.0f, bottom = -1.0f;  // and respawn at top once they fall below bottom
+    float lifeMin = 6.0f, lifeMax = 12.0f;
+    float scale = 0.02f;
+    uint32_t seed = 1;
+};
+
+// GPU mode: the flake state lives in two buffers of 8 floats per flake (x, y, z, life, vx, vy, vz, phase),
+// and shaders/snow_update.vert advances it from one into the other with transform feedback.
+struct SnowGpuState {
+    ShaderProgram program;
+    GLuint state[2] = { 0, 0 };
+    GLuint updateVAO[2] = { 0, 0 };     // reads state[i]
+    GLuint drawVAO[2] = { 0, 0 };       // flake mesh + state[i] as instance data
+    int current = 0;                    // buffer holding the latest state
+};
+
+// Falling snow: simulated on the CPU as structure-of-arrays streams (AVX/SSE, 8 or 4 flakes per step),
+// streamed into an instance buffer once per frame and drawn with a single glDrawElementsInstanced.
+// Every stream is padded to a multiple of 8; the padding is simulated but never drawn.
+struct Snowfall {
+    SnowParams params;
+    size_t count = 0;
+    AlignedFloats x, y, z, vx, vy, vz, life;
+    AlignedFloats phase;                // per-flake offset of the turbulence, so flakes do not sway in step
+    float time = 0.0f;
+    uint32_t step = 0;                  // updates so far; with the seed and the flake index it drives respawns
+    SimdLevel simd = bestSimdLevel();   // SIMD_SCALAR/SIMD_SSE give the same results as the default, slower
+
+    GLuint vao = 0, instanceVBO = 0;
+    SnowGpuState gpu;                   // gpu.program.id != 0: GPU mode, the CPU streams are released
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_SHORT;
+    size_t drawCount = 0;               // CPU mode: flakes in the instance streams (those left after culling)
+};
+
+// Flakes spread over the whole volume with random lifetimes; the same params give the same snow.
+void initSnowfall(Snowfall& snow, size_t count, const SnowParams& params = SnowParams());
+// Deterministic: the result depends on the params, the deltaTime sequence and nothing else (not on snow.simd).
+void updateSnowfall(Snowfall& snow, float deltaTime);
+// The same update as jobs over cache-line-aligned ranges of the streams, with the same result. Returns at
+// once; the streams may be touched again after waitForJobs(jobs, done).
+void updateSnowfallAsync(Snowfall& snow, float deltaTime, JobSystem& jobs, JobCounter& done);
+
+// GL side. The flake mesh uses the light cube's layout: position and normal, 6 floats per vertex.
+// The instance buffer holds the x, y and z streams back to back (shader.vert locations 3..5).
+void createSnowfallGL(Snowfall& snow, GLuint meshVBO, GLuint meshEBO, GLsizei indexCount, GLenum indexType);
+// Orphans the instance buffer and refills it with this frame's flakes.
+void uploadSnowfall(Snowfall& snow);
+// Instead of uploadSnowfall: copies the flakes into this frame's dynamic buffer and points the instance
+// attributes there (between beginDynamicFrame and endDynamicFrame). With a frustum only the flakes
+// inside it are copied (cullSpheres on the flake cube's bounding sphere). Uploads every flake as
+// uploadSnowfall when the frame has no room left.
+void streamSnowfall(Snowfall& snow, DynamicBuffer& dynamic, const Frustum* frustum = nullptr, CullStats* stats = nullptr);
+// Expects prog with uInstanced and uInstanceScale set (see shader.vert).
+void drawSnowfall(const Snowfall& snow, RenderStats* stats = nullptr);
+// The same draw as a render queue packet; packet supplies the program, state and uniforms.
+void submitSnowfall(RenderQueue& queue, const DrawPacket& packet, const Snowfall& snow);
+void destroySnowfallGL(Snowfall& snow);
+
+// Instead of createSnowfallGL: moves the flakes from initSnowfall into GPU buffers and drops the CPU
+// streams (meshVBO 0: simulation only, nothing to draw). False, with nothing changed, when the update
+// shader does not build.
+bool createSnowfallGPU(Snowfall& snow, const char* updateShaderPath, GLuint meshVBO, GLuint meshEBO,
+    GLsizei indexCount, GLenum indexType);
+// One transform feedback pass, no CPU work per flake and no upload; call instead of update + upload.
+// Leaves GL_RASTERIZER_DISCARD off and no program bound.
+void updateSnowfallGPU(Snowfall& snow, float deltaTime);
+// Current GPU state, 8 floats per flake (see SnowGpuState), for checks against the CPU path.
+void readSnowfallGPU(const Snowfall& snow, std::vector<float>& state);
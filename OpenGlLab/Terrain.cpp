@@ -0,0 +1,268 @@
+#include "Terrain.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+float heightAt(const Heightfield& field, int x, int z) {
+    return field.heights[static_cast<size_t>(z) * field.width + x];
+}
+
+glm::vec3 normalAt(const Heightfield& field, int x, int z) {
+    if (field.normals.empty()) return glm::vec3(0.0f, 1.0f, 0.0f);
+    return field.normals[static_cast<size_t>(z) * field.width + x];
+}
+
+// Height of the level with sample step `step` at sample (x, z), interpolated over the same two triangles
+// per cell the template draws (diagonal from (x0, z1) to (x1, z0)).
+static float coarseHeight(const Heightfield& field, int x, int z, int step) {
+    const int x0 = x / step * step, z0 = z / step * step;
+    if (x0 == x && z0 == z) return heightAt(field, x, z);
+    // On a grid line the far corners coincide with the near ones, which keeps the last row and column
+    // inside the field.
+    const int x1 = x0 == x ? x0 : x0 + step, z1 = z0 == z ? z0 : z0 + step;
+    const float u = static_cast<float>(x - x0) / step, v = static_cast<float>(z - z0) / step;
+    const float h00 = heightAt(field, x0, z0), h10 = heightAt(field, x1, z0);
+    const float h01 = heightAt(field, x0, z1), h11 = heightAt(field, x1, z1);
+    if (u + v <= 1.0f) return h00 + u * (h10 - h00) + v * (h01 - h00);
+    return h11 + (1.0f - u) * (h01 - h11) + (1.0f - v) * (h10 - h11);
+}
+
+// Skirt quad between border vertices a, b and their lowered copies, facing +x for a border running
+// along +z and -z for one running along +x (counter-clockwise front faces); flip turns it around.
+static void addSkirtQuad(std::vector<uint16_t>& indices, uint32_t a, uint32_t b, uint32_t skirtA, uint32_t skirtB,
+    bool flip) {
+    if (flip) {
+        std::swap(a, b);
+        std::swap(skirtA, skirtB);
+    }
+    const uint32_t quad[6] = { a, b, skirtB, a, skirtB, skirtA };
+    for (uint32_t i : quad) indices.push_back(static_cast<uint16_t>(i));
+}
+
+// How far the surface of any other level strays from `level`'s along the border of the node with corner
+// (x0, z0) and edge `samples`. A coarser level only counts on the lines where one of its nodes can end.
+static float borderError(const Heightfield& field, int x0, int z0, int samples, int level, int levels, int quads) {
+    float error = 0.0f;
+    const auto lineError = [&](int line, bool alongZ) {
+        for (int t = 0; t <= samples; ++t) {
+            const int x = alongZ ? line : x0 + t, z = alongZ ? z0 + t : line;
+            const float h = coarseHeight(field, x, z, 1 << level);
+            for (int other = 0; other < levels; ++other) {
+                if (other == level || line % (quads << other) != 0) continue;
+                error = std::max(error, std::fabs(h - coarseHeight(field, x, z, 1 << other)));
+            }
+        }
+    };
+    lineError(x0, true);
+    lineError(x0 + samples, true);
+    lineError(z0, false);
+    lineError(z0 + samples, false);
+    return error;
+}
+
+bool buildTerrain(const Heightfield& field, const TerrainParams& params, Terrain& terrain) {
+    const int quads = params.chunkQuads;
+    if (quads < 1 || (quads & (quads - 1)) != 0 || quads > 128) {
+        std::cerr << "ERROR: terrain chunks must be a power of two up to 128 quads, not " << quads << "\n";
+        return false;
+    }
+    if (field.width < 2 || field.depth < 2 || (field.width - 1) % quads != 0 || (field.depth - 1) % quads != 0
+        || field.heights.size() != static_cast<size_t>(field.width) * field.depth) {
+        std::cerr << "ERROR: a " << field.width << "x" << field.depth << " heightfield does not split into chunks of "
+            << quads << " quads\n";
+        return false;
+    }
+
+    terrain = Terrain();
+    terrain.params = params;
+    terrain.width = field.width;
+    terrain.depth = field.depth;
+    terrain.spacing = field.spacing;
+    terrain.origin = field.origin;
+    terrain.chunksX = (field.width - 1) / quads;
+    terrain.chunksZ = (field.depth - 1) / quads;
+    int levels = std::min(std::max(params.lodLevels, 1), kMaxTerrainLods);
+    while (levels > 1 && (terrain.chunksX % (1 << (levels - 1)) != 0 || terrain.chunksZ % (1 << (levels - 1)) != 0)) --levels;
+    terrain.levels = levels;
+
+    // The template. Grid vertex (i, j) (i along x, j along z) is i * side + j at (i, 0, j); skirt edges follow
+    // in the order x min, x max, z min, z max, each side vertices long, at y = -1.
+    const uint32_t side = static_cast<uint32_t>(quads + 1);
+    const uint32_t gridVertices = side * side;
+    const auto templateVertex = [](uint32_t i, uint32_t j, int16_t skirt) {
+        return GridVertex{ { static_cast<int16_t>(i), skirt, static_cast<int16_t>(j), 0 } };
+    };
+    const uint32_t last = static_cast<uint32_t>(quads);
+    for (uint32_t i = 0; i < side; ++i)
+        for (uint32_t j = 0; j < side; ++j) terrain.templateVertices.push_back(templateVertex(i, j, 0));
+    for (uint32_t t = 0; t < side; ++t) terrain.templateVertices.push_back(templateVertex(0, t, -1));
+    for (uint32_t t = 0; t < side; ++t) terrain.templateVertices.push_back(templateVertex(last, t, -1));
+    for (uint32_t t = 0; t < side; ++t) terrain.templateVertices.push_back(templateVertex(t, 0, -1));
+    for (uint32_t t = 0; t < side; ++t) terrain.templateVertices.push_back(templateVertex(t, last, -1));
+    const auto grid = [&](uint32_t i, uint32_t j) { return i * side + j; };
+    const auto skirt = [&](uint32_t edge, uint32_t t) { return gridVertices + edge * side + t; };
+    for (uint32_t i = 0; i < last; ++i) {
+        for (uint32_t j = 0; j < last; ++j) {
+            const uint32_t tri[6] = { grid(i, j + 1), grid(i + 1, j), grid(i, j), grid(i, j + 1), grid(i + 1, j + 1), grid(i + 1, j) };
+            for (uint32_t v : tri) terrain.indices.push_back(static_cast<uint16_t>(v));
+        }
+    }
+    for (uint32_t t = 0; t < last; ++t) {
+        addSkirtQuad(terrain.indices, grid(0, t), grid(0, t + 1), skirt(0, t), skirt(0, t + 1), true);
+        addSkirtQuad(terrain.indices, grid(last, t), grid(last, t + 1), skirt(1, t), skirt(1, t + 1), false);
+        addSkirtQuad(terrain.indices, grid(t, 0), grid(t + 1, 0), skirt(2, t), skirt(2, t + 1), false);
+        addSkirtQuad(terrain.indices, grid(t, last), grid(t + 1, last), skirt(3, t), skirt(3, t + 1), true);
+    }
+
+    // Nodes, level by level: height ranges of the chunks from their samples, every level above from its
+    // four children; the skirt from the border.
+    std::vector<glm::vec2> ranges, childRanges;
+    for (int level = 0; level < levels; ++level) {
+        const int nodesX = terrain.chunksX >> level, nodesZ = terrain.chunksZ >> level;
+        const int samples = quads << level;
+        terrain.levelFirst.push_back(static_cast<uint32_t>(terrain.nodes.size()));
+        ranges.assign(static_cast<size_t>(nodesX) * nodesZ, glm::vec2(0.0f));
+        for (int nz = 0; nz < nodesZ; ++nz) {
+            for (int nx = 0; nx < nodesX; ++nx) {
+                const int x0 = nx * samples, z0 = nz * samples;
+                glm::vec2& r = ranges[static_cast<size_t>(nz) * nodesX + nx];
+                if (level == 0) {
+                    r = glm::vec2(heightAt(field, x0, z0));
+                    for (int z = z0; z <= z0 + samples; ++z) {
+                        for (int x = x0; x <= x0 + samples; ++x) {
+                            const float h = heightAt(field, x, z);
+                            r.x = std::min(r.x, h);
+                            r.y = std::max(r.y, h);
+                        }
+                    }
+                }
+                else {
+                    r = childRanges[static_cast<size_t>(nz * 2) * (nodesX * 2) + nx * 2];
+                    for (int q = 1; q < 4; ++q) {
+                        const glm::vec2& c = childRanges[static_cast<size_t>(nz * 2 + (q >> 1)) * (nodesX * 2) + nx * 2 + (q & 1)];
+                        r.x = std::min(r.x, c.x);
+                        r.y = std::max(r.y, c.y);
+                    }
+                }
+                TerrainNode node;
+                // Plus a margin for the hairline gaps rasterization leaves at T-junctions even on exact edges.
+                node.skirtDepth = borderError(field, x0, z0, samples, level, levels, quads) + 0.25f * field.spacing;
+                node.boundsMin = glm::vec3(field.origin.x + x0 * field.spacing, r.x - node.skirtDepth,
+                    field.origin.y + z0 * field.spacing);
+                node.boundsMax = glm::vec3(field.origin.x + (x0 + samples) * field.spacing, r.y,
+                    field.origin.y + (z0 + samples) * field.spacing);
+                terrain.nodes.push_back(node);
+                addCullBox(terrain.boxes, node.boundsMin, node.boundsMax);
+            }
+        }
+        ranges.swap(childRanges);
+    }
+    return true;
+}
+
+MeshData terrainMeshData(const Terrain& terrain) {
+    MeshData mesh;
+    mesh.format = VERTEX_FORMAT_GRID;
+    mesh.vertexData = terrain.templateVertices.data();
+    mesh.vertexCount = terrain.templateVertices.size();
+    mesh.vertexStride = sizeof(GridVertex);
+    mesh.indexData = terrain.indices.data();
+    mesh.indexCount = terrain.indices.size();
+    mesh.indexSize = 2;
+    const float edge = static_cast<float>(terrain.params.chunkQuads);
+    mesh.boundsMin = glm::vec3(0.0f, -1.0f, 0.0f);
+    mesh.boundsMax = glm::vec3(edge, 0.0f, edge);
+    return mesh;
+}
+
+GLuint createTerrainTexture(const Heightfield& field) {
+    std::vector<uint32_t> texels(static_cast<size_t>(field.width) * field.depth * 2);
+    for (int z = 0; z < field.depth; ++z) {
+        for (int x = 0; x < field.width; ++x) {
+            const size_t i = static_cast<size_t>(z) * field.width + x;
+            const float h = heightAt(field, x, z);
+            int16_t normal[2];
+            octEncode(normalAt(field, x, z), normal);
+            std::memcpy(&texels[2 * i], &h, sizeof(float));
+            texels[2 * i + 1] = static_cast<uint16_t>(normal[0]) | static_cast<uint32_t>(static_cast<uint16_t>(normal[1])) << 16;
+        }
+    }
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, field.width, field.depth, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void setTerrainConstants(ShaderProgram& program, const Terrain& terrain, int textureUnit) {
+    static const UniformName samples = internUniform("uTerrainSamples");
+    static const UniformName heightfield = internUniform("uHeightfield");
+    static const UniformName heightmapSize = internUniform("uHeightmapSize");
+    setUniform(program, samples, textureUnit);
+    setUniform(program, heightfield, glm::vec3(terrain.origin.x, terrain.origin.y, terrain.spacing));
+    setUniform(program, heightmapSize, glm::vec2(static_cast<float>(terrain.width), static_cast<float>(terrain.depth)));
+}
+
+static void selectNode(Terrain& terrain, const glm::vec3& eye, int level, int nx, int nz) {
+    ++terrain.stats.nodesVisited;
+    const uint32_t index = terrain.levelFirst[level] + static_cast<uint32_t>(nz * (terrain.chunksX >> level) + nx);
+    if (!terrain.visible[index]) {
+        ++terrain.stats.nodesCulled;
+        return;
+    }
+    const TerrainNode& node = terrain.nodes[index];
+    const float distance = boxDistance(node.boundsMin, node.boundsMax, eye);
+    if (level > 0 && distance < terrain.params.lodDistance * static_cast<float>(1 << (level - 1))) {
+        for (int q = 0; q < 4; ++q) selectNode(terrain, eye, level - 1, nx * 2 + (q & 1), nz * 2 + (q >> 1));
+        return;
+    }
+    terrain.selection.push_back({ index, static_cast<uint32_t>(level), distance });
+    ++terrain.stats.levelNodes[level];
+}
+
+void selectTerrainChunks(Terrain& terrain, const Frustum& frustum, const glm::vec3& eye) {
+    const auto begin = std::chrono::steady_clock::now();
+    terrain.selection.clear();
+    cullBoxes(terrain.boxes, frustum, terrain.visible);
+    const int top = terrain.levels - 1;
+    for (int rz = 0; rz < terrain.chunksZ >> top; ++rz)
+        for (int rx = 0; rx < terrain.chunksX >> top; ++rx) selectNode(terrain, eye, top, rx, rz);
+    ++terrain.stats.frames;
+    terrain.stats.nodesDrawn += static_cast<unsigned int>(terrain.selection.size());
+    terrain.stats.triangles += terrain.selection.size() * (terrain.indices.size() / 3);
+    terrain.stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void submitTerrain(RenderQueue& queue, const DrawPacket& packet, const Terrain& terrain, const MeshDraw& draw) {
+    static const UniformName nodeName = internUniform("uTerrainNode");
+    static const UniformName skirtName = internUniform("uSkirtDepth");
+    DrawPacket p = packet;
+    p.decode = &draw;
+    p.indexType = draw.indexType;
+    p.range = { 0, static_cast<uint32_t>(terrain.indices.size()), 0, static_cast<uint32_t>(terrain.templateVertices.size()), -1 };
+    for (const TerrainSelection& selected : terrain.selection) {
+        const uint32_t local = selected.node - terrain.levelFirst[selected.level];
+        const uint32_t nodesX = static_cast<uint32_t>(terrain.chunksX >> selected.level);
+        const float samples = static_cast<float>(terrain.params.chunkQuads << selected.level);
+        queueUniform(queue, nodeName, glm::vec3((local % nodesX) * samples, (local / nodesX) * samples,
+            static_cast<float>(1 << selected.level)));
+        queueUniform(queue, skirtName, terrain.nodes[selected.node].skirtDepth);
+        p.materialUniforms = takeUniformSet(queue);
+        p.depth = selected.distance;
+        submitDraw(queue, p);
+    }
+}
+
+TerrainStats takeTerrainStats(Terrain& terrain) {
+    TerrainStats stats = terrain.stats;
+    terrain.stats = TerrainStats();
+    return stats;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Culling.h"
+#include "Mesh.h"
+#include "MeshPacking.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include <cstdint>
+#include <vector>
+
+// Height samples on a regular grid: sample (x, z) sits at origin + (x, z) * spacing.
+struct Heightfield {
+    int width = 0, depth = 0;           // samples along x and z
+    float spacing = 1.0f;
+    glm::vec2 origin = glm::vec2(0.0f); // x and z of sample (0, 0)
+    std::vector<float> heights;         // heights[z * width + x]
+    std::vector<glm::vec3> normals;     // the same layout; empty: straight up everywhere
+};
+
+float heightAt(const Heightfield& field, int x, int z);
+glm::vec3 normalAt(const Heightfield& field, int x, int z);
+
+const int kMaxTerrainLods = 12;
+
+struct TerrainParams {
+    int chunkQuads = 32;                // quads along a node edge, a power of two up to 128
+    int lodLevels = 4;                  // level l nodes cover 2^l x 2^l chunks with every 2^l-th sample; lowered
+                                        // until the heightfield splits into whole nodes of the top level
+    float lodDistance = 8.0f;           // level 0 closer than this, level l closer than lodDistance * 2^l
+};
+
+// A node of the quadtree: chunkQuads^2 cells of 2^level samples. The template's skirt hangs skirtDepth
+// below the node's border, as far as any other level's surface can get from it there, so it hides the
+// cracks whatever level a neighbour is drawn at.
+struct TerrainNode {
+    glm::vec3 boundsMin, boundsMax;     // terrain space, skirt included
+    float skirtDepth = 0.0f;
+};
+
+struct TerrainStats {
+    unsigned int frames = 0;
+    unsigned int nodesVisited = 0;
+    unsigned int nodesDrawn = 0;        // one draw each
+    unsigned int nodesCulled = 0;
+    size_t triangles = 0;
+    unsigned int levelNodes[kMaxTerrainLods] = {};
+    double ms = 0.0;                    // culling and level selection
+};
+
+// One node picked for this frame.
+struct TerrainSelection {
+    uint32_t node;
+    uint32_t level;
+    float distance;                     // eye to the node's box
+};
+
+// Chunked heightfield terrain over a quadtree of nodes. Every node is drawn from one shared template, a
+// grid of chunkQuads^2 cells plus skirt with 16-bit indices, placed on the node by a per-draw uniform;
+// shader.vert (built with TERRAIN_CHUNKED) reads the height and normal of every sample from the terrain
+// texture and derives the tangent from the normal, so no vertex data depends on the size of the world. Node boxes are culled in one SIMD pass and the quadtree is
+// walked from the top: a node far enough for its level is drawn whole, nearer ones split into their four
+// children. Distant chunks thereby merge into ever larger nodes, which keeps draws and triangles per frame
+// roughly constant however large the heightfield is.
+struct Terrain {
+    TerrainParams params;
+    int width = 0, depth = 0;           // of the heightfield
+    float spacing = 1.0f;
+    glm::vec2 origin = glm::vec2(0.0f);
+    int chunksX = 0, chunksZ = 0;       // level 0 nodes
+    int levels = 0;
+    std::vector<GridVertex> templateVertices;   // (chunkQuads + 1)^2 grid vertices, then the skirt
+    std::vector<uint16_t> indices;
+    std::vector<uint32_t> levelFirst;   // per level, the first of its nodes, row by row
+    std::vector<TerrainNode> nodes;
+    CullBoxes boxes;                    // node bounds, in node order
+
+    // per frame
+    std::vector<uint8_t> visible;
+    std::vector<TerrainSelection> selection;
+    TerrainStats stats;
+};
+
+// The grid must have (chunkQuads * n + 1) samples along each axis. Prints the reason and returns false
+// otherwise.
+bool buildTerrain(const Heightfield& field, const TerrainParams& params, Terrain& terrain);
+// The template as a mesh for uploadMesh (no sub-meshes; draws come from the selection).
+MeshData terrainMeshData(const Terrain& terrain);
+// RG32UI texture with a texel per sample: the bits of the height, and the normal oct-encoded as two int16
+// (x in the low half). Read with texelFetch, so nothing is filtered.
+GLuint createTerrainTexture(const Heightfield& field);
+// Per-terrain uniforms of a TERRAIN_CHUNKED program, the createTerrainTexture texture bound on
+// textureUnit; the program must be current.
+void setTerrainConstants(ShaderProgram& program, const Terrain& terrain, int textureUnit);
+
+// Culls the nodes and walks the quadtree into terrain.selection. frustum and eye are in terrain space
+// (extract the frustum from proj * view * model).
+void selectTerrainChunks(Terrain& terrain, const Frustum& frustum, const glm::vec3& eye);
+// One packet per selected node, at the node's distance, with the node's uniforms as the material set;
+// draw is the mesh uploaded from terrainMeshData.
+void submitTerrain(RenderQueue& queue, const DrawPacket& packet, const Terrain& terrain, const MeshDraw& draw);
+
+// Returns and clears the counters.
+TerrainStats takeTerrainStats(Terrain& terrain);
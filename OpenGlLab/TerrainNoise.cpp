@@ -0,0 +1,400 @@
+#include "TerrainNoise.h"
+#include "Hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Skew and unskew factors of the 2D simplex grid: (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6.
+static const float kSkew = 0.36602540378f, kUnskew = 0.21132486541f, kUnskew2 = 2.0f * 0.21132486541f;
+static const float kSimplexScale = 70.0f;       // brings the summed corner contributions to about [-1, 1]
+static const float kOctaveCos = 0.8f, kOctaveSin = 0.6f;    // 36.87 degrees between consecutive octaves
+const size_t kNoiseJobSamples = 32768;          // per job: a few rows of a large field, many of a small one
+
+// One octave as an affine map of world (x, z) onto its lattice: (a x + b z + ox, c x + d z + oz).
+struct NoiseOctave {
+    float a, b, c, d;
+    float ox, oz;
+    float amplitude;
+};
+
+struct NoisePlan {
+    NoiseOctave octaves[kMaxNoiseOctaves];
+    int count = 0;
+    bool ridged = false;
+};
+
+static NoisePlan planNoise(const NoiseParams& noise) {
+    NoisePlan plan;
+    plan.count = std::min(std::max(noise.octaves, 1), kMaxNoiseOctaves);
+    plan.ridged = noise.fractal == NOISE_RIDGED;
+    float frequency = noise.frequency, amplitude = noise.amplitude, cosA = 1.0f, sinA = 0.0f;
+    for (int o = 0; o < plan.count; ++o) {
+        NoiseOctave& octave = plan.octaves[o];
+        octave.a = frequency * cosA;
+        octave.b = -frequency * sinA;
+        octave.c = frequency * sinA;
+        octave.d = frequency * cosA;
+        // The lattice hash repeats every 289 cells, so an offset in [0, 289) picks any stretch of the noise.
+        octave.ox = static_cast<float>(hash32(noise.seed ^ hash32(2u * o)) >> 8) * (289.0f / 16777216.0f);
+        octave.oz = static_cast<float>(hash32(noise.seed ^ hash32(2u * o + 1u)) >> 8) * (289.0f / 16777216.0f);
+        octave.amplitude = amplitude;
+        frequency *= noise.lacunarity;
+        amplitude *= noise.gain;
+        const float c = cosA * kOctaveCos - sinA * kOctaveSin;
+        sinA = sinA * kOctaveCos + cosA * kOctaveSin;
+        cosA = c;
+    }
+    return plan;
+}
+
+// ---- scalar ----
+
+static float mod289(float v) {
+    return v - std::floor(v * (1.0f / 289.0f)) * 289.0f;
+}
+
+// (34 v + 1) v mod 289 permutes [0, 289); every intermediate stays an integer below 2^24.
+static float permute(float v) {
+    return mod289((v * 34.0f + 1.0f) * v);
+}
+
+// Adds the contribution of the corner at offset (x, y) with lattice hash h, and its derivatives.
+static void addCorner(float h, float x, float y, float& n, float& dx, float& dy) {
+    // 41 gradient directions spread around a diamond, then normalized.
+    const float q = h * (1.0f / 41.0f);
+    float gx = 2.0f * (q - std::floor(q)) - 1.0f;
+    float gy = std::fabs(gx) - 0.5f;
+    gx = gx - std::floor(gx + 0.5f);
+    const float inv = 1.0f / std::sqrt(gx * gx + gy * gy);
+    gx = gx * inv;
+    gy = gy * inv;
+    const float t = std::max(0.5f - x * x - y * y, 0.0f);
+    const float t2 = t * t, t4 = t2 * t2;
+    const float gd = gx * x + gy * y;
+    const float td = 8.0f * t2 * t * gd;
+    n += t4 * gd;
+    dx += t4 * gx - td * x;
+    dy += t4 * gy - td * y;
+}
+
+// Simplex noise at (x, y) with its gradient.
+static float simplex(float x, float y, float& dx, float& dy) {
+    const float s = (x + y) * kSkew;
+    const float i = std::floor(x + s), j = std::floor(y + s);
+    const float t = (i + j) * kUnskew;
+    const float x0 = x - (i - t), y0 = y - (j - t);
+    // Below the diagonal the middle corner is one step along x, above it one along y.
+    const float i1 = x0 > y0 ? 1.0f : 0.0f, j1 = 1.0f - i1;
+    const float im = mod289(i), jm = mod289(j);
+    float n = 0.0f;
+    dx = dy = 0.0f;
+    addCorner(permute(permute(jm) + im), x0, y0, n, dx, dy);
+    addCorner(permute(permute(jm + j1) + im + i1), x0 - i1 + kUnskew, y0 - j1 + kUnskew, n, dx, dy);
+    addCorner(permute(permute(jm + 1.0f) + im + 1.0f), x0 - 1.0f + kUnskew2, y0 - 1.0f + kUnskew2, n, dx, dy);
+    dx = dx * kSimplexScale;
+    dy = dy * kSimplexScale;
+    return n * kSimplexScale;
+}
+
+// Height at world (x, z) and its slopes dh/dx, dh/dz.
+static float sampleScalar(const NoisePlan& plan, float x, float z, float& slopeX, float& slopeZ) {
+    float h = 0.0f;
+    slopeX = slopeZ = 0.0f;
+    for (int o = 0; o < plan.count; ++o) {
+        const NoiseOctave& octave = plan.octaves[o];
+        float gx, gy;
+        const float n = simplex(octave.a * x + octave.b * z + octave.ox, octave.c * x + octave.d * z + octave.oz, gx, gy);
+        float k = octave.amplitude;
+        if (plan.ridged) {
+            const float r = 1.0f - std::fabs(n);
+            h += octave.amplitude * r * r;
+            k = -2.0f * octave.amplitude * r * std::copysign(1.0f, n);
+        }
+        else {
+            h += octave.amplitude * n;
+        }
+        // Back through the octave's map onto world x and z.
+        slopeX += k * (octave.a * gx + octave.c * gy);
+        slopeZ += k * (octave.b * gx + octave.d * gy);
+    }
+    return h;
+}
+
+static void storeSample(Heightfield& field, size_t index, float h, float slopeX, float slopeZ) {
+    field.heights[index] = h;
+    const float inv = 1.0f / std::sqrt(slopeX * slopeX + slopeZ * slopeZ + 1.0f);
+    field.normals[index] = glm::vec3(-slopeX * inv, inv, -slopeZ * inv);
+}
+
+static void rowsScalar(Heightfield& field, const NoisePlan& plan, int rowBegin, int rowEnd) {
+    for (int zi = rowBegin; zi < rowEnd; ++zi) {
+        const float z = field.origin.y + static_cast<float>(zi) * field.spacing;
+        const size_t row = static_cast<size_t>(zi) * field.width;
+        for (int xi = 0; xi < field.width; ++xi) {
+            const float x = field.origin.x + static_cast<float>(xi) * field.spacing;
+            float slopeX, slopeZ;
+            const float h = sampleScalar(plan, x, z, slopeX, slopeZ);
+            storeSample(field, row + xi, h, slopeX, slopeZ);
+        }
+    }
+}
+
+#ifdef SIMD_X86
+// ---- SSE ----
+
+// SSE2 has no floor: truncate, then step down where that went up (negative non-integers).
+static __m128 floorSSE(__m128 v) {
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+static __m128 mod289SSE(__m128 v) {
+    return _mm_sub_ps(v, _mm_mul_ps(floorSSE(_mm_mul_ps(v, _mm_set1_ps(1.0f / 289.0f))), _mm_set1_ps(289.0f)));
+}
+
+static __m128 permuteSSE(__m128 v) {
+    return mod289SSE(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(34.0f)), _mm_set1_ps(1.0f)), v));
+}
+
+static void addCornerSSE(__m128 h, __m128 x, __m128 y, __m128& n, __m128& dx, __m128& dy) {
+    const __m128 one = _mm_set1_ps(1.0f), half = _mm_set1_ps(0.5f), signMask = _mm_set1_ps(-0.0f);
+    const __m128 q = _mm_mul_ps(h, _mm_set1_ps(1.0f / 41.0f));
+    __m128 gx = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f), _mm_sub_ps(q, floorSSE(q))), one);
+    __m128 gy = _mm_sub_ps(_mm_andnot_ps(signMask, gx), half);
+    gx = _mm_sub_ps(gx, floorSSE(_mm_add_ps(gx, half)));
+    const __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy))));
+    gx = _mm_mul_ps(gx, inv);
+    gy = _mm_mul_ps(gy, inv);
+    const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_setzero_ps());
+    const __m128 t2 = _mm_mul_ps(t, t), t4 = _mm_mul_ps(t2, t2);
+    const __m128 gd = _mm_add_ps(_mm_mul_ps(gx, x), _mm_mul_ps(gy, y));
+    const __m128 td = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(8.0f), t2), t), gd);
+    n = _mm_add_ps(n, _mm_mul_ps(t4, gd));
+    dx = _mm_add_ps(dx, _mm_sub_ps(_mm_mul_ps(t4, gx), _mm_mul_ps(td, x)));
+    dy = _mm_add_ps(dy, _mm_sub_ps(_mm_mul_ps(t4, gy), _mm_mul_ps(td, y)));
+}
+
+static __m128 simplexSSE(__m128 x, __m128 y, __m128& dx, __m128& dy) {
+    const __m128 one = _mm_set1_ps(1.0f), unskew = _mm_set1_ps(kUnskew), unskew2 = _mm_set1_ps(kUnskew2);
+    const __m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(kSkew));
+    const __m128 i = floorSSE(_mm_add_ps(x, s)), j = floorSSE(_mm_add_ps(y, s));
+    const __m128 t = _mm_mul_ps(_mm_add_ps(i, j), unskew);
+    const __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(i, t)), y0 = _mm_sub_ps(y, _mm_sub_ps(j, t));
+    const __m128 i1 = _mm_and_ps(_mm_cmpgt_ps(x0, y0), one), j1 = _mm_sub_ps(one, i1);
+    const __m128 im = mod289SSE(i), jm = mod289SSE(j);
+    __m128 n = _mm_setzero_ps();
+    dx = dy = _mm_setzero_ps();
+    addCornerSSE(permuteSSE(_mm_add_ps(permuteSSE(jm), im)), x0, y0, n, dx, dy);
+    addCornerSSE(permuteSSE(_mm_add_ps(_mm_add_ps(permuteSSE(_mm_add_ps(jm, j1)), im), i1)),
+        _mm_add_ps(_mm_sub_ps(x0, i1), unskew), _mm_add_ps(_mm_sub_ps(y0, j1), unskew), n, dx, dy);
+    addCornerSSE(permuteSSE(_mm_add_ps(_mm_add_ps(permuteSSE(_mm_add_ps(jm, one)), im), one)),
+        _mm_add_ps(_mm_sub_ps(x0, one), unskew2), _mm_add_ps(_mm_sub_ps(y0, one), unskew2), n, dx, dy);
+    const __m128 scale = _mm_set1_ps(kSimplexScale);
+    dx = _mm_mul_ps(dx, scale);
+    dy = _mm_mul_ps(dy, scale);
+    return _mm_mul_ps(n, scale);
+}
+
+static __m128 sampleSSE(const NoisePlan& plan, __m128 x, __m128 z, __m128& slopeX, __m128& slopeZ) {
+    const __m128 one = _mm_set1_ps(1.0f), signMask = _mm_set1_ps(-0.0f);
+    __m128 h = _mm_setzero_ps();
+    slopeX = slopeZ = _mm_setzero_ps();
+    for (int o = 0; o < plan.count; ++o) {
+        const NoiseOctave& octave = plan.octaves[o];
+        const __m128 a = _mm_set1_ps(octave.a), b = _mm_set1_ps(octave.b), c = _mm_set1_ps(octave.c), d = _mm_set1_ps(octave.d);
+        const __m128 amplitude = _mm_set1_ps(octave.amplitude);
+        __m128 gx, gy;
+        const __m128 n = simplexSSE(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, z)), _mm_set1_ps(octave.ox)),
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(c, x), _mm_mul_ps(d, z)), _mm_set1_ps(octave.oz)), gx, gy);
+        __m128 k = amplitude;
+        if (plan.ridged) {
+            const __m128 r = _mm_sub_ps(one, _mm_andnot_ps(signMask, n));
+            h = _mm_add_ps(h, _mm_mul_ps(_mm_mul_ps(amplitude, r), r));
+            k = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(-2.0f * octave.amplitude), r), _mm_or_ps(_mm_and_ps(n, signMask), one));
+        }
+        else {
+            h = _mm_add_ps(h, _mm_mul_ps(amplitude, n));
+        }
+        slopeX = _mm_add_ps(slopeX, _mm_mul_ps(k, _mm_add_ps(_mm_mul_ps(a, gx), _mm_mul_ps(c, gy))));
+        slopeZ = _mm_add_ps(slopeZ, _mm_mul_ps(k, _mm_add_ps(_mm_mul_ps(b, gx), _mm_mul_ps(d, gy))));
+    }
+    return h;
+}
+
+static void rowsSSE(Heightfield& field, const NoisePlan& plan, int rowBegin, int rowEnd) {
+    alignas(16) float h[4], slopeX[4], slopeZ[4];
+    const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 originX = _mm_set1_ps(field.origin.x), spacing = _mm_set1_ps(field.spacing);
+    for (int zi = rowBegin; zi < rowEnd; ++zi) {
+        const __m128 z = _mm_set1_ps(field.origin.y + static_cast<float>(zi) * field.spacing);
+        const size_t row = static_cast<size_t>(zi) * field.width;
+        for (int xi = 0; xi < field.width; xi += 4) {
+            const __m128 x = _mm_add_ps(originX, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(xi)), lane), spacing));
+            __m128 sx, sz;
+            _mm_store_ps(h, sampleSSE(plan, x, z, sx, sz));
+            _mm_store_ps(slopeX, sx);
+            _mm_store_ps(slopeZ, sz);
+            const int lanes = std::min(4, field.width - xi);
+            for (int l = 0; l < lanes; ++l) storeSample(field, row + xi + l, h[l], slopeX[l], slopeZ[l]);
+        }
+    }
+}
+
+// ---- AVX ----
+
+TARGET_AVX static __m256 mod289AVX(__m256 v) {
+    return _mm256_sub_ps(v, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(v, _mm256_set1_ps(1.0f / 289.0f))), _mm256_set1_ps(289.0f)));
+}
+
+TARGET_AVX static __m256 permuteAVX(__m256 v) {
+    return mod289AVX(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(34.0f)), _mm256_set1_ps(1.0f)), v));
+}
+
+TARGET_AVX static void addCornerAVX(__m256 h, __m256 x, __m256 y, __m256& n, __m256& dx, __m256& dy) {
+    const __m256 one = _mm256_set1_ps(1.0f), half = _mm256_set1_ps(0.5f), signMask = _mm256_set1_ps(-0.0f);
+    const __m256 q = _mm256_mul_ps(h, _mm256_set1_ps(1.0f / 41.0f));
+    __m256 gx = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_sub_ps(q, _mm256_floor_ps(q))), one);
+    __m256 gy = _mm256_sub_ps(_mm256_andnot_ps(signMask, gx), half);
+    gx = _mm256_sub_ps(gx, _mm256_floor_ps(_mm256_add_ps(gx, half)));
+    const __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy))));
+    gx = _mm256_mul_ps(gx, inv);
+    gy = _mm256_mul_ps(gy, inv);
+    const __m256 t = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(half, _mm256_mul_ps(x, x)), _mm256_mul_ps(y, y)), _mm256_setzero_ps());
+    const __m256 t2 = _mm256_mul_ps(t, t), t4 = _mm256_mul_ps(t2, t2);
+    const __m256 gd = _mm256_add_ps(_mm256_mul_ps(gx, x), _mm256_mul_ps(gy, y));
+    const __m256 td = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(8.0f), t2), t), gd);
+    n = _mm256_add_ps(n, _mm256_mul_ps(t4, gd));
+    dx = _mm256_add_ps(dx, _mm256_sub_ps(_mm256_mul_ps(t4, gx), _mm256_mul_ps(td, x)));
+    dy = _mm256_add_ps(dy, _mm256_sub_ps(_mm256_mul_ps(t4, gy), _mm256_mul_ps(td, y)));
+}
+
+TARGET_AVX static __m256 simplexAVX(__m256 x, __m256 y, __m256& dx, __m256& dy) {
+    const __m256 one = _mm256_set1_ps(1.0f), unskew = _mm256_set1_ps(kUnskew), unskew2 = _mm256_set1_ps(kUnskew2);
+    const __m256 s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(kSkew));
+    const __m256 i = _mm256_floor_ps(_mm256_add_ps(x, s)), j = _mm256_floor_ps(_mm256_add_ps(y, s));
+    const __m256 t = _mm256_mul_ps(_mm256_add_ps(i, j), unskew);
+    const __m256 x0 = _mm256_sub_ps(x, _mm256_sub_ps(i, t)), y0 = _mm256_sub_ps(y, _mm256_sub_ps(j, t));
+    const __m256 i1 = _mm256_and_ps(_mm256_cmp_ps(x0, y0, _CMP_GT_OQ), one), j1 = _mm256_sub_ps(one, i1);
+    const __m256 im = mod289AVX(i), jm = mod289AVX(j);
+    __m256 n = _mm256_setzero_ps();
+    dx = dy = _mm256_setzero_ps();
+    addCornerAVX(permuteAVX(_mm256_add_ps(permuteAVX(jm), im)), x0, y0, n, dx, dy);
+    addCornerAVX(permuteAVX(_mm256_add_ps(_mm256_add_ps(permuteAVX(_mm256_add_ps(jm, j1)), im), i1)),
+        _mm256_add_ps(_mm256_sub_ps(x0, i1), unskew), _mm256_add_ps(_mm256_sub_ps(y0, j1), unskew), n, dx, dy);
+    addCornerAVX(permuteAVX(_mm256_add_ps(_mm256_add_ps(permuteAVX(_mm256_add_ps(jm, one)), im), one)),
+        _mm256_add_ps(_mm256_sub_ps(x0, one), unskew2), _mm256_add_ps(_mm256_sub_ps(y0, one), unskew2), n, dx, dy);
+    const __m256 scale = _mm256_set1_ps(kSimplexScale);
+    dx = _mm256_mul_ps(dx, scale);
+    dy = _mm256_mul_ps(dy, scale);
+    return _mm256_mul_ps(n, scale);
+}
+
+TARGET_AVX static __m256 sampleAVX(const NoisePlan& plan, __m256 x, __m256 z, __m256& slopeX, __m256& slopeZ) {
+    const __m256 one = _mm256_set1_ps(1.0f), signMask = _mm256_set1_ps(-0.0f);
+    __m256 h = _mm256_setzero_ps();
+    slopeX = slopeZ = _mm256_setzero_ps();
+    for (int o = 0; o < plan.count; ++o) {
+        const NoiseOctave& octave = plan.octaves[o];
+        const __m256 a = _mm256_set1_ps(octave.a), b = _mm256_set1_ps(octave.b);
+        const __m256 c = _mm256_set1_ps(octave.c), d = _mm256_set1_ps(octave.d);
+        const __m256 amplitude = _mm256_set1_ps(octave.amplitude);
+        __m256 gx, gy;
+        const __m256 n = simplexAVX(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, x), _mm256_mul_ps(b, z)), _mm256_set1_ps(octave.ox)),
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c, x), _mm256_mul_ps(d, z)), _mm256_set1_ps(octave.oz)), gx, gy);
+        __m256 k = amplitude;
+        if (plan.ridged) {
+            const __m256 r = _mm256_sub_ps(one, _mm256_andnot_ps(signMask, n));
+            h = _mm256_add_ps(h, _mm256_mul_ps(_mm256_mul_ps(amplitude, r), r));
+            k = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f * octave.amplitude), r), _mm256_or_ps(_mm256_and_ps(n, signMask), one));
+        }
+        else {
+            h = _mm256_add_ps(h, _mm256_mul_ps(amplitude, n));
+        }
+        slopeX = _mm256_add_ps(slopeX, _mm256_mul_ps(k, _mm256_add_ps(_mm256_mul_ps(a, gx), _mm256_mul_ps(c, gy))));
+        slopeZ = _mm256_add_ps(slopeZ, _mm256_mul_ps(k, _mm256_add_ps(_mm256_mul_ps(b, gx), _mm256_mul_ps(d, gy))));
+    }
+    return h;
+}
+
+TARGET_AVX static void rowsAVX(Heightfield& field, const NoisePlan& plan, int rowBegin, int rowEnd) {
+    alignas(32) float h[8], slopeX[8], slopeZ[8];
+    const __m256 lane = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256 originX = _mm256_set1_ps(field.origin.x), spacing = _mm256_set1_ps(field.spacing);
+    for (int zi = rowBegin; zi < rowEnd; ++zi) {
+        const __m256 z = _mm256_set1_ps(field.origin.y + static_cast<float>(zi) * field.spacing);
+        const size_t row = static_cast<size_t>(zi) * field.width;
+        for (int xi = 0; xi < field.width; xi += 8) {
+            const __m256 x = _mm256_add_ps(originX, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(xi)), lane), spacing));
+            __m256 sx, sz;
+            _mm256_store_ps(h, sampleAVX(plan, x, z, sx, sz));
+            _mm256_store_ps(slopeX, sx);
+            _mm256_store_ps(slopeZ, sz);
+            const int lanes = std::min(8, field.width - xi);
+            for (int l = 0; l < lanes; ++l) storeSample(field, row + xi + l, h[l], slopeX[l], slopeZ[l]);
+        }
+    }
+}
+#endif
+
+// ---- generation ----
+
+static SimdLevel usableLevel(SimdLevel simd) {
+#ifdef SIMD_X86
+    return simd == SIMD_AVX && !cpuHasAVX() ? SIMD_SSE : simd;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+static void generateRows(Heightfield& field, const NoisePlan& plan, int rowBegin, int rowEnd, SimdLevel simd) {
+#ifdef SIMD_X86
+    if (simd == SIMD_AVX) { rowsAVX(field, plan, rowBegin, rowEnd); return; }
+    if (simd == SIMD_SSE) { rowsSSE(field, plan, rowBegin, rowEnd); return; }
+#endif
+    rowsScalar(field, plan, rowBegin, rowEnd);
+}
+
+static HeightfieldGenStats prepareField(Heightfield& field, SimdLevel simd) {
+    const size_t samples = static_cast<size_t>(std::max(field.width, 0)) * std::max(field.depth, 0);
+    field.heights.resize(samples);
+    field.normals.resize(samples);
+    HeightfieldGenStats stats;
+    stats.samples = samples;
+    stats.simd = usableLevel(simd);
+    return stats;
+}
+
+HeightfieldGenStats generateHeightfield(Heightfield& field, const NoiseParams& noise, SimdLevel simd) {
+    const auto begin = std::chrono::steady_clock::now();
+    HeightfieldGenStats stats = prepareField(field, simd);
+    const NoisePlan plan = planNoise(noise);
+    if (stats.samples) {
+        generateRows(field, plan, 0, field.depth, stats.simd);
+        stats.jobs = 1;
+    }
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return stats;
+}
+
+HeightfieldGenStats generateHeightfield(Heightfield& field, const NoiseParams& noise, JobSystem& jobs, SimdLevel simd) {
+    const auto begin = std::chrono::steady_clock::now();
+    HeightfieldGenStats stats = prepareField(field, simd);
+    if (stats.samples) {
+        const size_t rows = std::max<size_t>(1, kNoiseJobSamples / field.width);
+        stats.jobs = (field.depth + rows - 1) / rows;
+        Heightfield* f = &field;
+        const NoisePlan plan = planNoise(noise);
+        const SimdLevel level = stats.simd;
+        JobCounter done;
+        submitRange(jobs, done, field.depth, rows, 1, [f, &plan, level](size_t rowBegin, size_t rowEnd) {
+            generateRows(*f, plan, static_cast<int>(rowBegin), static_cast<int>(rowEnd), level);
+        });
+        waitForJobs(jobs, done);
+    }
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return stats;
+}
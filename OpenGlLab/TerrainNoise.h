@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include "Terrain.h"
+#include <cstdint>
+
+const int kMaxNoiseOctaves = 16;
+
+enum NoiseFractal {
+    NOISE_FBM = 0,                      // sum of octaves, heights around 0
+    NOISE_RIDGED = 1                    // sum of (1 - |octave|)^2: sharp crests, heights from 0 up
+};
+
+struct NoiseParams {
+    NoiseFractal fractal = NOISE_FBM;
+    int octaves = 6;                    // clamped to kMaxNoiseOctaves
+    float frequency = 0.01f;            // lattice cells per world unit of the first octave
+    float amplitude = 1.0f;             // height scale of the first octave
+    float lacunarity = 2.0f;            // frequency ratio of consecutive octaves
+    float gain = 0.5f;                  // amplitude ratio of consecutive octaves
+    uint32_t seed = 1;                  // shifts every octave to a different part of the noise
+};
+
+struct HeightfieldGenStats {
+    size_t samples = 0;
+    size_t jobs = 0;
+    SimdLevel simd = SIMD_SCALAR;
+    double ms = 0.0;
+};
+
+// Procedural heights and normals for a Heightfield: 2D simplex noise summed over octaves (fBm or ridged),
+// every octave rotated against the previous one so the lattice does not show along the axes. The noise
+// carries its analytic gradient, so each sample gets its exact normal in the same pass as its height.
+// The lattice hash is a permutation polynomial evaluated in floats (exact below 2^24), so the AVX path
+// needs no integer gathers and runs 8 samples of a row per step, SSE 4; the scalar path evaluates the
+// same expressions in the same order and all three agree bit for bit.
+//
+// field.width, depth, spacing and origin choose the samples; heights and normals are resized and
+// overwritten. A sample depends on its world position only, so a large field can be generated as strips
+// (each with its own origin) that match the whole one.
+HeightfieldGenStats generateHeightfield(Heightfield& field, const NoiseParams& noise, SimdLevel simd = bestSimdLevel());
+// The same, as jobs over ranges of rows; the calling thread takes part and returns when all are done.
+HeightfieldGenStats generateHeightfield(Heightfield& field, const NoiseParams& noise, JobSystem& jobs,
+    SimdLevel simd = bestSimdLevel());
@@ -0,0 +1,658 @@
+﻿#include "TextureCompress.h"
+#include "TextureMips.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "JobSystem.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COMPRESS_SSE2 1
+#endif
+
+namespace fs = std::filesystem;
+
+size_t blockBytes(BlockFormat format) {
+    return format == BLOCK_BC1 ? 8 : 16;
+}
+
+size_t compressedLevelSize(BlockFormat format, int width, int height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+GLenum blockInternalFormat(BlockFormat format) {
+    switch (format) {
+    case BLOCK_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    default: return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+const char* blockFormatName(BlockFormat format) {
+    switch (format) {
+    case BLOCK_BC1: return "BC1";
+    case BLOCK_BC3: return "BC3";
+    default: return "BC5";
+    }
+}
+
+BlockFormat chooseBlockFormat(const char* path, const unsigned char* pixels, int width, int height, int channels) {
+    if (mipContentForPath(path) == MIP_CONTENT_NORMAL) return BLOCK_BC5;
+    if (channels == 2 || channels == 4) {
+        const size_t count = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < count; ++i) {
+            if (pixels[i * channels + channels - 1] != 255) return BLOCK_BC3;
+        }
+    }
+    return BLOCK_BC1;
+}
+
+// One 4x4 block as RGBA8; pixels past the edge repeat the last row/column.
+static void fetchBlock(const unsigned char* pixels, int width, int height, int channels, int bx, int by,
+    unsigned char block[16][4]) {
+    for (int i = 0; i < 16; ++i) {
+        const int x = std::min(bx * 4 + (i & 3), width - 1);
+        const int y = std::min(by * 4 + (i >> 2), height - 1);
+        const unsigned char* p = pixels + (static_cast<size_t>(y) * width + x) * channels;
+        if (channels <= 2) {
+            block[i][0] = block[i][1] = block[i][2] = p[0];
+            block[i][3] = channels == 2 ? p[1] : 255;
+        }
+        else {
+            block[i][0] = p[0];
+            block[i][1] = p[1];
+            block[i][2] = p[2];
+            block[i][3] = channels == 4 ? p[3] : 255;
+        }
+    }
+}
+
+static uint16_t packRGB565(const float c[3]) {
+    const int r = std::min(31, std::max(0, static_cast<int>(c[0] * (31.0f / 255.0f) + 0.5f)));
+    const int g = std::min(63, std::max(0, static_cast<int>(c[1] * (63.0f / 255.0f) + 0.5f)));
+    const int b = std::min(31, std::max(0, static_cast<int>(c[2] * (31.0f / 255.0f) + 0.5f)));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t c, int out[3]) {
+    const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the nearest of the four palette colors for every pixel. Returns the 2-bit indices (pixel 0 in
+// the low bits) and the summed squared error.
+static uint32_t selectColorIndices(const float r[16], const float g[16], const float b[16],
+    const float palette[4][3], float& error) {
+    uint32_t indices = 0;
+#ifdef TEXTURE_COMPRESS_SSE2
+    __m128 total = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        const __m128 pr = _mm_loadu_ps(r + i), pg = _mm_loadu_ps(g + i), pb = _mm_loadu_ps(b + i);
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int k = 0; k < 4; ++k) {
+            const __m128 dr = _mm_sub_ps(pr, _mm_set1_ps(palette[k][0]));
+            const __m128 dg = _mm_sub_ps(pg, _mm_set1_ps(palette[k][1]));
+            const __m128 db = _mm_sub_ps(pb, _mm_set1_ps(palette[k][2]));
+            const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(k)));
+        }
+        total = _mm_add_ps(total, best);
+        alignas(16) int32_t lane[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane), bestIndex);
+        for (int j = 0; j < 4; ++j) indices |= static_cast<uint32_t>(lane[j]) << (2 * (i + j));
+    }
+    alignas(16) float sum[4];
+    _mm_store_ps(sum, total);
+    error = sum[0] + sum[1] + sum[2] + sum[3];
+#else
+    float sum[4] = {};  // summed in the same lane order as the SSE2 path, so both give identical blocks
+    for (int i = 0; i < 16; ++i) {
+        float best = FLT_MAX;
+        uint32_t bestIndex = 0;
+        for (uint32_t k = 0; k < 4; ++k) {
+            const float dr = r[i] - palette[k][0], dg = g[i] - palette[k][1], db = b[i] - palette[k][2];
+            const float d = dr * dr + dg * dg + db * db;
+            if (d < best) { best = d; bestIndex = k; }
+        }
+        sum[i & 3] += best;
+        indices |= bestIndex << (2 * i);
+    }
+    error = sum[0] + sum[1] + sum[2] + sum[3];
+#endif
+    return indices;
+}
+
+// Orders the endpoints for the four-color mode (e0 > e1) and picks the indices.
+static uint32_t fitColorIndices(const float r[16], const float g[16], const float b[16],
+    uint16_t& e0, uint16_t& e1, float& error) {
+    if (e0 < e1) std::swap(e0, e1);
+    int c0[3], c1[3];
+    unpackRGB565(e0, c0);
+    unpackRGB565(e1, c1);
+    float palette[4][3];
+    for (int k = 0; k < 3; ++k) {
+        palette[0][k] = static_cast<float>(c0[k]);
+        palette[1][k] = static_cast<float>(c1[k]);
+        palette[2][k] = (2.0f * c0[k] + c1[k]) / 3.0f;
+        palette[3][k] = (c0[k] + 2.0f * c1[k]) / 3.0f;
+    }
+    return selectColorIndices(r, g, b, palette, error);
+}
+
+// Least-squares endpoints for fixed indices.
+static bool refineEndpoints(const float r[16], const float g[16], const float b[16], uint32_t indices,
+    float c0[3], float c1[3]) {
+    static const float kWeight[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for (int i = 0; i < 16; ++i) {
+        const float a = kWeight[(indices >> (2 * i)) & 3], w = 1.0f - a;
+        aa += a * a;
+        ab += a * w;
+        bb += w * w;
+        const float p[3] = { r[i], g[i], b[i] };
+        for (int k = 0; k < 3; ++k) {
+            ax[k] += a * p[k];
+            bx[k] += w * p[k];
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) return false;
+    for (int k = 0; k < 3; ++k) {
+        c0[k] = std::min(255.0f, std::max(0.0f, (bb * ax[k] - ab * bx[k]) / det));
+        c1[k] = std::min(255.0f, std::max(0.0f, (aa * bx[k] - ab * ax[k]) / det));
+    }
+    return true;
+}
+
+// BC1 color block: endpoints along the principal axis of the colors (power iteration on the
+// covariance), inset by 1/16 of the range, then up to two least-squares refinements.
+static void encodeColorBlock(const unsigned char block[16][4], unsigned char out[8]) {
+    float r[16], g[16], b[16];
+    float mean[3] = {};
+    for (int i = 0; i < 16; ++i) {
+        r[i] = block[i][0];
+        g[i] = block[i][1];
+        b[i] = block[i][2];
+        mean[0] += r[i];
+        mean[1] += g[i];
+        mean[2] += b[i];
+    }
+    for (float& m : mean) m /= 16.0f;
+
+    float cov[6] = {};  // rr rg rb gg gb bb
+    for (int i = 0; i < 16; ++i) {
+        const float dr = r[i] - mean[0], dg = g[i] - mean[1], db = b[i] - mean[2];
+        cov[0] += dr * dr; cov[1] += dr * dg; cov[2] += dr * db;
+        cov[3] += dg * dg; cov[4] += dg * db; cov[5] += db * db;
+    }
+    float axis[3] = { cov[0] + cov[1] + cov[2], cov[1] + cov[3] + cov[4], cov[2] + cov[4] + cov[5] };
+    for (int iter = 0; iter < 8; ++iter) {
+        const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        const float m = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (m < 1e-6f) break;
+        axis[0] = x / m; axis[1] = y / m; axis[2] = z / m;
+    }
+    float len = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (len < 1e-6f) {
+        axis[0] = axis[1] = axis[2] = 1.0f;
+        len = std::sqrt(3.0f);
+    }
+    for (float& a : axis) a /= len;
+
+    float lo = FLT_MAX, hi = -FLT_MAX;
+    for (int i = 0; i < 16; ++i) {
+        const float t = (r[i] - mean[0]) * axis[0] + (g[i] - mean[1]) * axis[1] + (b[i] - mean[2]) * axis[2];
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    float c0[3], c1[3];
+    for (int k = 0; k < 3; ++k) {
+        c0[k] = mean[k] + axis[k] * hi;
+        c1[k] = mean[k] + axis[k] * lo;
+        const float inset = (c0[k] - c1[k]) / 16.0f;
+        c0[k] = std::min(255.0f, std::max(0.0f, c0[k] - inset));
+        c1[k] = std::min(255.0f, std::max(0.0f, c1[k] + inset));
+    }
+
+    uint16_t e0 = packRGB565(c0), e1 = packRGB565(c1);
+    float error;
+    uint32_t indices = fitColorIndices(r, g, b, e0, e1, error);
+    for (int iter = 0; iter < 2 && error > 0.0f; ++iter) {
+        if (!refineEndpoints(r, g, b, indices, c0, c1)) break;
+        uint16_t n0 = packRGB565(c0), n1 = packRGB565(c1);
+        float nextError;
+        const uint32_t next = fitColorIndices(r, g, b, n0, n1, nextError);
+        if (nextError >= error) break;
+        e0 = n0; e1 = n1; indices = next; error = nextError;
+    }
+
+    out[0] = static_cast<unsigned char>(e0); out[1] = static_cast<unsigned char>(e0 >> 8);
+    out[2] = static_cast<unsigned char>(e1); out[3] = static_cast<unsigned char>(e1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+}
+
+// BC4 block in the eight-value mode: a0 = max, a1 = min, each value snapped to the nearest step.
+static void encodeChannelBlock(const unsigned char values[16], unsigned char out[8]) {
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, static_cast<int>(values[i]));
+        hi = std::max(hi, static_cast<int>(values[i]));
+    }
+    out[0] = static_cast<unsigned char>(hi);
+    out[1] = static_cast<unsigned char>(lo);
+    uint64_t bits = 0;
+    if (hi > lo) {
+        const int range = hi - lo;
+        for (int i = 0; i < 16; ++i) {
+            const int t = ((values[i] - lo) * 7 + range / 2) / range;     // 0 = a1 .. 7 = a0
+            const uint64_t index = t == 7 ? 0 : t == 0 ? 1 : 8 - t;
+            bits |= index << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; ++i) out[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+}
+
+static void encodeBlock(const unsigned char block[16][4], BlockFormat format, unsigned char* out) {
+    unsigned char channel[16];
+    switch (format) {
+    case BLOCK_BC1:
+        encodeColorBlock(block, out);
+        break;
+    case BLOCK_BC3:
+        for (int i = 0; i < 16; ++i) channel[i] = block[i][3];
+        encodeChannelBlock(channel, out);
+        encodeColorBlock(block, out + 8);
+        break;
+    default:
+        for (int i = 0; i < 16; ++i) channel[i] = block[i][0];
+        encodeChannelBlock(channel, out);
+        for (int i = 0; i < 16; ++i) channel[i] = block[i][1];
+        encodeChannelBlock(channel, out + 8);
+        break;
+    }
+}
+
+void compressImage(const unsigned char* pixels, int width, int height, int channels, BlockFormat format,
+    unsigned char* out, JobSystem* jobs) {
+    const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t bytes = blockBytes(format);
+    parallelFor(jobs, 1, blocksY, 1, [&](size_t begin, size_t end) {
+        unsigned char block[16][4];
+        for (int by = static_cast<int>(begin); by < static_cast<int>(end); ++by) {
+            for (int bx = 0; bx < blocksX; ++bx) {
+                fetchBlock(pixels, width, height, channels, bx, by, block);
+                encodeBlock(block, format, out + (static_cast<size_t>(by) * blocksX + bx) * bytes);
+            }
+        }
+    });
+}
+
+// fourColor: BC3 color blocks ignore the endpoint order; BC1 switches to three colors + black when e0 <= e1.
+static void decodeColorBlock(const unsigned char* in, bool fourColor, unsigned char out[16][4]) {
+    const uint16_t e0 = static_cast<uint16_t>(in[0] | (in[1] << 8)), e1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+    int palette[4][4];
+    unpackRGB565(e0, palette[0]);
+    unpackRGB565(e1, palette[1]);
+    for (int k = 0; k < 3; ++k) {
+        if (fourColor || e0 > e1) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+        else {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColor || e0 > e1 ? 255 : 0;
+    const uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (static_cast<uint32_t>(in[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        const int* c = palette[(indices >> (2 * i)) & 3];
+        for (int k = 0; k < 4; ++k) out[i][k] = static_cast<unsigned char>(c[k]);
+    }
+}
+
+static void decodeChannelBlock(const unsigned char* in, unsigned char out[16]) {
+    int palette[8] = { in[0], in[1] };
+    if (palette[0] > palette[1]) {
+        for (int i = 2; i < 8; ++i) palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+    }
+    else {
+        for (int i = 2; i < 6; ++i) palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i) bits |= static_cast<uint64_t>(in[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i) out[i] = static_cast<unsigned char>(palette[(bits >> (3 * i)) & 7]);
+}
+
+void decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* rgba) {
+    const int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t bytes = blockBytes(format);
+    unsigned char block[16][4], channel[16];
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const unsigned char* in = blocks + (static_cast<size_t>(by) * blocksX + bx) * bytes;
+            if (format == BLOCK_BC1) {
+                decodeColorBlock(in, false, block);
+            }
+            else if (format == BLOCK_BC3) {
+                decodeColorBlock(in + 8, true, block);
+                decodeChannelBlock(in, channel);
+                for (int i = 0; i < 16; ++i) block[i][3] = channel[i];
+            }
+            else {
+                decodeChannelBlock(in, channel);
+                for (int i = 0; i < 16; ++i) block[i][0] = channel[i];
+                decodeChannelBlock(in + 8, channel);
+                for (int i = 0; i < 16; ++i) {
+                    block[i][1] = channel[i];
+                    block[i][2] = 0;
+                    block[i][3] = 255;
+                }
+            }
+            for (int i = 0; i < 16; ++i) {
+                const int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if (x < width && y < height) std::memcpy(rgba + (static_cast<size_t>(y) * width + x) * 4, block[i], 4);
+            }
+        }
+    }
+}
+
+// ---- DDS container ----
+
+const uint32_t kDDSMagic = 0x20534444;          // "DDS "
+const uint32_t kTextureCacheTag = 0x544C474F;   // "OGLT" in reserved1[0]
+const uint32_t kTextureCacheVersion = 2;
+
+enum DDSFlags : uint32_t {
+    DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000,
+    DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000,
+    DDPF_FOURCC = 0x4,
+    DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000
+};
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];     // [0] tag, [1] version, [2..3] source hash, [4..5] source size, [6] mip options
+    DDSPixelFormat format;
+    uint32_t caps, caps2, caps3, caps4;
+    uint32_t reserved2;
+};
+static_assert(sizeof(DDSHeader) == 124, "DDS header layout");
+
+static uint32_t makeFourCC(const char* s) {
+    return uint32_t(uint8_t(s[0])) | uint32_t(uint8_t(s[1])) << 8 | uint32_t(uint8_t(s[2])) << 16 | uint32_t(uint8_t(s[3])) << 24;
+}
+
+static uint32_t formatFourCC(BlockFormat format) {
+    switch (format) {
+    case BLOCK_BC1: return makeFourCC("DXT1");
+    case BLOCK_BC3: return makeFourCC("DXT5");
+    default: return makeFourCC("ATI2");
+    }
+}
+
+bool writeDDS(const char* path, const CompressedTexture& texture, const TextureCacheKey& key) {
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = static_cast<uint32_t>(texture.height);
+    header.width = static_cast<uint32_t>(texture.width);
+    header.pitchOrLinearSize = static_cast<uint32_t>(compressedLevelSize(texture.format, texture.width, texture.height));
+    header.mipMapCount = static_cast<uint32_t>(texture.levels.size());
+    header.reserved1[0] = kTextureCacheTag;
+    header.reserved1[1] = kTextureCacheVersion;
+    header.reserved1[2] = static_cast<uint32_t>(key.sourceHash);
+    header.reserved1[3] = static_cast<uint32_t>(key.sourceHash >> 32);
+    header.reserved1[4] = static_cast<uint32_t>(key.sourceSize);
+    header.reserved1[5] = static_cast<uint32_t>(key.sourceSize >> 32);
+    header.reserved1[6] = key.mipOptions;
+    header.format.size = sizeof(DDSPixelFormat);
+    header.format.flags = DDPF_FOURCC;
+    header.format.fourCC = formatFourCC(texture.format);
+    header.caps = DDSCAPS_TEXTURE | (texture.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    // Write to a temporary file and rename, as writeMeshCache does: a crash never leaves a truncated
+    // cache behind, and loader threads writing the same texture each use their own temporary.
+    const std::string tmpPath = std::string(path) + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "ERROR: Could not write texture cache: " << path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&kDDSMagic), sizeof(kDDSMagic));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const std::vector<unsigned char>& level : texture.levels)
+            file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+        if (!file) {
+            std::cerr << "ERROR: Could not write texture cache: " << path << std::endl;
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cerr << "ERROR: Could not write texture cache: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readDDS(const char* path, CompressedTexture& texture, TextureCacheKey* key) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    uint32_t magic = 0;
+    DDSHeader header;
+    if (!file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || magic != kDDSMagic) return false;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.size != sizeof(DDSHeader)) return false;
+    if (!(header.format.flags & DDPF_FOURCC) || header.width == 0 || header.height == 0) return false;
+
+    const uint32_t fourCC = header.format.fourCC;
+    if (fourCC == makeFourCC("DXT1")) texture.format = BLOCK_BC1;
+    else if (fourCC == makeFourCC("DXT5")) texture.format = BLOCK_BC3;
+    else if (fourCC == makeFourCC("ATI2") || fourCC == makeFourCC("BC5U")) texture.format = BLOCK_BC5;
+    else return false;
+
+    texture.width = static_cast<int>(header.width);
+    texture.height = static_cast<int>(header.height);
+    int levels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount ? static_cast<int>(header.mipMapCount) : 1;
+    levels = std::min(levels, mipLevelCount(texture.width, texture.height));
+    texture.levels.resize(levels);
+    for (int level = 0; level < levels; ++level) {
+        std::vector<unsigned char>& data = texture.levels[level];
+        data.resize(compressedLevelSize(texture.format, std::max(1, texture.width >> level), std::max(1, texture.height >> level)));
+        if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))) return false;
+    }
+
+    if (key) {
+        *key = TextureCacheKey();
+        if (header.reserved1[0] == kTextureCacheTag && header.reserved1[1] == kTextureCacheVersion) {
+            key->sourceHash = header.reserved1[2] | uint64_t(header.reserved1[3]) << 32;
+            key->sourceSize = header.reserved1[4] | uint64_t(header.reserved1[5]) << 32;
+            key->mipOptions = header.reserved1[6];
+        }
+    }
+    return true;
+}
+
+static std::string cachePathFor(const char* imagePath) {
+    return std::string(imagePath) + ".dds";
+}
+
+static MipOptions mipOptionsFor(const char* path, JobSystem* jobs) {
+    MipOptions options;
+    options.content = mipContentForPath(path);
+    options.jobs = jobs;
+    return options;
+}
+
+static void compressPixels(const char* path, const unsigned char* pixels, int width, int height, int channels,
+    CompressedTexture& texture, JobSystem* jobs) {
+    texture.format = chooseBlockFormat(path, pixels, width, height, channels);
+    texture.width = width;
+    texture.height = height;
+    std::vector<std::vector<unsigned char>> mips(1);
+    mips[0].assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+    buildMipChain(mips, width, height, channels, mipOptionsFor(path, jobs));
+    texture.levels.resize(mips.size());
+    for (size_t level = 0; level < mips.size(); ++level) {
+        const int w = std::max(1, width >> level), h = std::max(1, height >> level);
+        texture.levels[level].resize(compressedLevelSize(texture.format, w, h));
+        compressImage(mips[level].data(), w, h, channels, texture.format, texture.levels[level].data(), jobs);
+    }
+}
+
+bool compressTexture(const char* imagePath, CompressedTexture& texture, JobSystem* jobs) {
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(imagePath, &width, &height, &channels, 0);
+    if (!pixels) {
+        std::cerr << "ERROR: Failed to load texture: " << imagePath << std::endl;
+        return false;
+    }
+    compressPixels(imagePath, pixels, width, height, channels, texture, jobs);
+    stbi_image_free(pixels);
+    return true;
+}
+
+bool loadTextureCompressed(const char* imagePath, CompressedTexture& texture, JobSystem* jobs, bool* fromCache) {
+    if (fromCache) *fromCache = false;
+    std::error_code ec;
+    if (!fs::is_regular_file(imagePath, ec)) return false;
+    MappedFile source;
+    if (!mapFile(imagePath, source)) return false;
+    TextureCacheKey key;
+    key.sourceHash = hashBytes(source.data, source.size);
+    key.sourceSize = source.size;
+    key.mipOptions = mipOptionsKey(mipOptionsFor(imagePath, jobs));
+
+    const std::string cachePath = cachePathFor(imagePath);
+    TextureCacheKey cached;
+    if (readDDS(cachePath.c_str(), texture, &cached) && cached.sourceHash == key.sourceHash &&
+        cached.sourceSize == key.sourceSize && cached.mipOptions == key.mipOptions) {
+        unmapFile(source);
+        if (fromCache) *fromCache = true;
+        return true;
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.data),
+        static_cast<int>(source.size), &width, &height, &channels, 0);
+    unmapFile(source);
+    if (!pixels) return false;
+    compressPixels(imagePath, pixels, width, height, channels, texture, jobs);
+    stbi_image_free(pixels);
+    writeDDS(cachePath.c_str(), texture, key);
+    return true;
+}
+
+static bool isImageFile(const fs::path& p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+}
+
+int compressTextureFiles(const char* path) {
+    std::vector<fs::path> files;
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && isImageFile(it->path())) files.push_back(it->path());
+        }
+    }
+    else {
+        files.push_back(path);
+    }
+    if (files.empty()) {
+        std::cerr << "No image files found in " << path << std::endl;
+        return 1;
+    }
+
+    JobSystem jobs;
+    startJobSystem(jobs);
+    int failed = 0;
+    for (const fs::path& file : files) {
+        std::string imagePath = file.string();
+        auto t0 = std::chrono::steady_clock::now();
+        CompressedTexture texture;
+        bool fromCache = false;
+        if (!loadTextureCompressed(imagePath.c_str(), texture, &jobs, &fromCache)) {
+            std::cerr << "ERROR: Failed to load texture: " << imagePath << std::endl;
+            ++failed;
+            continue;
+        }
+        size_t bytes = 0;
+        for (const std::vector<unsigned char>& level : texture.levels) bytes += level.size();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << imagePath << ": " << texture.width << "x" << texture.height << " " << blockFormatName(texture.format)
+            << ", " << texture.levels.size() << " levels, " << bytes / 1024 << " KB, "
+            << (fromCache ? "cache up to date" : "compressed") << " (" << ms << " ms)\n";
+    }
+    stopJobSystem(jobs);
+    return failed ? 1 : 0;
+}
+
+bool hasS3TC() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0) return true;
+    }
+    return false;
+}
+
+GLuint uploadCompressedTexture(const CompressedTexture& texture) {
+    const GLenum format = blockInternalFormat(texture.format);
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    for (size_t level = 0; level < texture.levels.size(); ++level) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, std::max(1, texture.width >> level),
+            std::max(1, texture.height >> level), 0, static_cast<GLsizei>(texture.levels[level].size()), texture.levels[level].data());
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return textureID;
+}
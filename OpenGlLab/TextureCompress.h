@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct JobSystem;
+
+// S3TC is an extension even in GL 4.6, so glad (core only) does not define its enums.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// 4x4 block formats:
+//   BC1: RGB, two RGB565 endpoints + 2-bit indices, 8 bytes per block (4 bits per pixel)
+//   BC3: BC1 color + BC4 alpha, 16 bytes
+//   BC5: two BC4 channels, 16 bytes; used for normal maps (X/Y, shader.frag rebuilds Z)
+enum BlockFormat : uint32_t {
+    BLOCK_BC1 = 0,
+    BLOCK_BC3 = 1,
+    BLOCK_BC5 = 2
+};
+
+size_t blockBytes(BlockFormat format);
+size_t compressedLevelSize(BlockFormat format, int width, int height);
+GLenum blockInternalFormat(BlockFormat format);
+const char* blockFormatName(BlockFormat format);
+
+// BC5 for normal maps (mipContentForPath), BC3 when some alpha is below 255, BC1 otherwise.
+BlockFormat chooseBlockFormat(const char* path, const unsigned char* pixels, int width, int height, int channels);
+
+// Encodes a tightly packed image with 1..4 channels (edge blocks repeat the last row/column).
+// Rows of blocks run as jobs on jobs (null = the calling thread). out holds compressedLevelSize bytes.
+void compressImage(const unsigned char* pixels, int width, int height, int channels, BlockFormat format,
+    unsigned char* out, JobSystem* jobs = nullptr);
+// Back to RGBA8 (BC5 gives R, G, 0, 255), for error measurements.
+void decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* rgba);
+
+struct CompressedTexture {
+    BlockFormat format = BLOCK_BC1;
+    int width = 0, height = 0;
+    std::vector<std::vector<unsigned char>> levels;     // level 0 first
+};
+
+// What a texture cache was built from: any change to the image or to the mip options rebuilds it.
+struct TextureCacheKey {
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    uint32_t mipOptions = 0;    // mipOptionsKey()
+};
+
+// Texture cache (<image>.dds): a plain DDS with DXT1/DXT5/ATI2 FourCC and every mip level, so other
+// tools can open it. The key lives in reserved header words, as the mesh cache keeps its source hash.
+bool writeDDS(const char* path, const CompressedTexture& texture, const TextureCacheKey& key);
+bool readDDS(const char* path, CompressedTexture& texture, TextureCacheKey* key = nullptr);
+
+// Decodes an image file, builds its mip chain on the CPU (Kaiser filter; linear-light color,
+// renormalized normals, see TextureMips.h) and compresses every level.
+bool compressTexture(const char* imagePath, CompressedTexture& texture, JobSystem* jobs = nullptr);
+// Reads <imagePath>.dds when it matches the image; otherwise compresses the image and rewrites the .dds.
+bool loadTextureCompressed(const char* imagePath, CompressedTexture& texture, JobSystem* jobs = nullptr,
+    bool* fromCache = nullptr);
+// Batch converter: writes a .dds next to every .png/.jpg/.tga under path (file or directory, recursive).
+int compressTextureFiles(const char* path);
+
+// GL side. BC5 (RGTC) is core since 3.0; BC1/BC3 need GL_EXT_texture_compression_s3tc.
+bool hasS3TC();
+GLuint uploadCompressedTexture(const CompressedTexture& texture);
@@ -0,0 +1,274 @@
+#include "TextureLoader.h"
+#include "TextureCompress.h"
+#include "TextureMips.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Prefers the block-compressed .dds cache (refreshing it when the image changed); falls back to plain
+// pixels with a CPU-built mip chain.
+static void decodeImage(TextureImage& image, bool compressed) {
+    CompressedTexture texture;
+    if (compressed && loadTextureCompressed(image.path.c_str(), texture)) {
+        image.width = texture.width;
+        image.height = texture.height;
+        image.compressedFormat = blockInternalFormat(texture.format);
+        image.levels = std::move(texture.levels);
+        return;
+    }
+    unsigned char* pixels = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (!pixels) return;
+    image.levels.resize(1);
+    image.levels[0].assign(pixels, pixels + static_cast<size_t>(image.width) * image.height * image.channels);
+    stbi_image_free(pixels);
+    MipOptions mips;
+    mips.content = mipContentForPath(image.path.c_str());
+    buildMipChain(image.levels, image.width, image.height, image.channels, mips);
+}
+
+static void workerLoop(TextureLoader* loader) {
+    std::unique_lock<std::mutex> lock(loader->mutex);
+    for (;;) {
+        loader->wake.wait(lock, [&] { return loader->stopping || !loader->queue.empty(); });
+        if (loader->stopping) return;
+        std::pair<TextureRequest*, size_t> job = loader->queue.front();
+        loader->queue.pop_front();
+        lock.unlock();
+        decodeImage(job.first->images[job.second], loader->compress);
+        lock.lock();
+        if (--job.first->remaining == 0) loader->ready.push_back(job.first);
+    }
+}
+
+void startTextureLoader(TextureLoader& loader, unsigned int threads, bool synchronous,
+    const TextureStreamOptions& stream) {
+    TextureStreamOptions options = stream;
+    if (synchronous) options.frameBudget = 0;
+    initTextureStreamer(loader.streamer, options);
+    loader.compress = loader.compress && hasS3TC();
+    loader.stats = TextureStreamStats();
+    if (synchronous) return;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < threads; ++i) loader.workers.emplace_back(workerLoop, &loader);
+}
+
+void stopTextureLoader(TextureLoader& loader) {
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        loader.stopping = true;
+        loader.queue.clear();
+    }
+    loader.wake.notify_all();
+    for (std::thread& t : loader.workers) t.join();
+    loader.workers.clear();
+    loader.requests.clear();
+    loader.ready.clear();
+    loader.uploading.clear();
+    loader.stopping = false;
+    shutdownTextureStreamer(loader.streamer);
+}
+
+static void setPlaceholder(GLenum target, const unsigned char color[3]) {
+    if (target == GL_TEXTURE_CUBE_MAP) {
+        for (GLenum face = 0; face < 6; ++face)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, color);
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, color);
+    }
+}
+
+static GLenum pixelFormat(int channels) {
+    return channels == 3 ? GL_RGB : GL_RGBA;
+}
+
+static GLenum faceTarget(const TextureRequest& request, int face) {
+    return request.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+}
+
+// Checks the decoded images; on success allocates every level of every face and fills the smallest
+// one, replacing the placeholder with the image's average color. False keeps the placeholder.
+static bool beginUpload(TextureRequest& request) {
+    const TextureImage& first = request.images[0];
+    for (const TextureImage& image : request.images) {
+        if (image.levels.empty()) {
+            if (request.target == GL_TEXTURE_CUBE_MAP) std::cout << "Failed to load skybox face: " << image.path << std::endl;
+            else std::cerr << "ERROR: Failed to load texture: " << image.path << std::endl;
+            return false;
+        }
+        if (image.width != first.width || image.height != first.height || image.channels != first.channels ||
+            image.compressedFormat != first.compressedFormat || image.levels.size() != first.levels.size()) {
+            std::cerr << "ERROR: Cube map faces differ in size: " << image.path << std::endl;
+            return false;
+        }
+    }
+    request.levels = static_cast<int>(first.levels.size());
+    const GLenum format = pixelFormat(first.channels);
+    const int smallest = request.levels - 1;
+    glBindTexture(request.target, request.texture);
+    for (int face = 0; face < static_cast<int>(request.images.size()); ++face) {
+        const TextureImage& image = request.images[face];
+        for (int level = 0; level < request.levels; ++level) {
+            const int width = std::max(1, first.width >> level), height = std::max(1, first.height >> level);
+            const unsigned char* data = level == smallest ? image.levels[level].data() : nullptr;
+            if (image.compressedFormat) {
+                glCompressedTexImage2D(faceTarget(request, face), level, image.compressedFormat, width, height, 0,
+                    static_cast<GLsizei>(image.levels[level].size()), data);
+            }
+            else {
+                glTexImage2D(faceTarget(request, face), level, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+            }
+        }
+    }
+    glTexParameteri(request.target, GL_TEXTURE_MAX_LEVEL, smallest);
+    glTexParameteri(request.target, GL_TEXTURE_BASE_LEVEL, smallest);
+    request.level = smallest - 1;
+    request.face = 0;
+    request.row = 0;
+    return true;
+}
+
+// Streams rows of the front requests until the frame budget is spent. Levels that completed are
+// returned so their base level can move once the copies have been issued.
+static void streamLevels(TextureLoader& loader, std::vector<std::pair<TextureRequest*, int>>& completed) {
+    TextureStreamer& streamer = loader.streamer;
+    while (!loader.uploading.empty()) {
+        TextureRequest& request = *loader.uploading.front();
+        if (request.level < 0) {
+            loader.uploading.pop_front();
+            continue;
+        }
+        const TextureImage& image = request.images[request.face];
+        const std::vector<unsigned char>& data = image.levels[request.level];
+        const int width = std::max(1, image.width >> request.level);
+        const int height = std::max(1, image.height >> request.level);
+        // Compressed levels go by rows of 4x4 blocks.
+        const int rowCount = image.compressedFormat ? (height + 3) / 4 : height;
+        const size_t rowBytes = data.size() / rowCount;
+        const size_t budget = textureStreamBudget(streamer);
+        // At least one row per frame, so rows wider than the budget still make progress.
+        if (budget < rowBytes && streamer.used > 0) break;
+        const int rows = static_cast<int>(std::min<size_t>(rowCount - request.row, std::max<size_t>(1, budget / rowBytes)));
+
+        const unsigned char* src = data.data() + request.row * rowBytes;
+        if (image.compressedFormat) {
+            const int y = request.row * 4;
+            streamCompressedRows(streamer, request.texture, request.target, faceTarget(request, request.face), request.level,
+                y, width, std::min(rows * 4, height - y), image.compressedFormat, src, rows * rowBytes);
+        }
+        else {
+            streamTextureRows(streamer, request.texture, request.target, faceTarget(request, request.face), request.level,
+                request.row, width, rows, pixelFormat(image.channels), image.channels, src);
+        }
+        request.row += rows;
+        if (request.row < rowCount) continue;
+        request.row = 0;
+        if (++request.face < static_cast<int>(request.images.size())) continue;
+        request.face = 0;
+        completed.emplace_back(&request, request.level);
+        if (--request.level < 0) loader.uploading.pop_front();
+    }
+}
+
+static void releaseRequest(TextureLoader& loader, TextureRequest* request) {
+    loader.requests.remove_if([&](const TextureRequest& r) { return &r == request; });
+}
+
+static GLuint submit(TextureLoader& loader, GLenum target, const char* const* paths, size_t count,
+    const unsigned char placeholder[3]) {
+    loader.requests.emplace_back();
+    TextureRequest& request = loader.requests.back();
+    request.target = target;
+    request.images.resize(count);
+    for (size_t i = 0; i < count; ++i) request.images[i].path = paths[i];
+    request.remaining = static_cast<int>(count);
+
+    glGenTextures(1, &request.texture);
+    glBindTexture(target, request.texture);
+    setPlaceholder(target, placeholder);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+    if (target == GL_TEXTURE_CUBE_MAP) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    const GLuint texture = request.texture;
+
+    if (loader.workers.empty()) {
+        for (TextureImage& image : request.images) decodeImage(image, loader.compress);
+        request.remaining = 0;
+        loader.ready.push_back(&request);
+        pumpTextureUploads(loader);
+        return texture;
+    }
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        for (size_t i = 0; i < count; ++i) loader.queue.emplace_back(&request, i);
+    }
+    loader.wake.notify_all();
+    return texture;
+}
+
+GLuint loadTextureAsync(TextureLoader& loader, const char* path, const unsigned char placeholder[3]) {
+    return submit(loader, GL_TEXTURE_2D, &path, 1, placeholder);
+}
+
+GLuint loadCubeMapAsync(TextureLoader& loader, const char* const faces[6]) {
+    return submit(loader, GL_TEXTURE_CUBE_MAP, faces, 6, kPlaceholderWhite);
+}
+
+unsigned int pumpTextureUploads(TextureLoader& loader) {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<TextureRequest*> decoded;
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        decoded.swap(loader.ready);
+    }
+    unsigned int finished = 0;
+    for (TextureRequest* request : decoded) {
+        if (beginUpload(*request) && request->level >= 0) {
+            loader.uploading.push_back(request);
+            continue;
+        }
+        releaseRequest(loader, request);
+        ++finished;
+    }
+    if (loader.uploading.empty() || !beginTextureStreamFrame(loader.streamer)) return finished;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    std::vector<std::pair<TextureRequest*, int>> completed;
+    streamLevels(loader, completed);
+    const size_t frameBytes = loader.streamer.used;
+    endTextureStreamFrame(loader.streamer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (const auto& done : completed) {
+        glBindTexture(done.first->target, done.first->texture);
+        glTexParameteri(done.first->target, GL_TEXTURE_BASE_LEVEL, done.second);
+        if (done.second == 0) {
+            releaseRequest(loader, done.first);
+            ++finished;
+        }
+    }
+
+    TextureStreamStats& stats = loader.stats;
+    stats.bytes += frameBytes;
+    stats.frames += frameBytes ? 1 : 0;
+    stats.maxFrameBytes = std::max(stats.maxFrameBytes, frameBytes);
+    stats.maxPumpMs = std::max(stats.maxPumpMs,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    return finished;
+}
+
+size_t pendingTextures(const TextureLoader& loader) {
+    return loader.requests.size();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <glad/glad.h>
+#include "TextureStream.h"
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TextureImage {
+    std::string path;
+    int width = 0, height = 0, channels = 0;
+    GLenum compressedFormat = 0;        // BC internal format when read from the .dds cache, 0 for pixels
+    std::vector<std::vector<unsigned char>> levels;     // mip chain, level 0 first; empty if decoding failed
+};
+
+// One GL texture waiting for its images: a single 2D image or the six cube map faces.
+struct TextureRequest {
+    GLuint texture = 0;
+    GLenum target = GL_TEXTURE_2D;
+    std::vector<TextureImage> images;
+    int remaining = 0;                  // images not decoded yet (guarded by TextureLoader::mutex)
+
+    // Streaming progress: levels go from the smallest to level 0, every face of a level before the next.
+    int levels = 0;
+    int level = 0, face = 0, row = 0;
+};
+
+struct TextureStreamStats {
+    size_t bytes = 0;
+    unsigned int frames = 0;            // frames that uploaded something
+    size_t maxFrameBytes = 0;
+    double maxPumpMs = 0.0;             // worst CPU time spent in pumpTextureUploads
+};
+
+// Decodes image files on worker threads, or reads their block-compressed .dds cache (see
+// TextureCompress.h) and writes it first when it is missing or stale. Textures are created right away with a 1x1 placeholder,
+// so they can be bound immediately. Once every image of a texture is decoded, pumpTextureUploads()
+// allocates the mip chain on the render thread and streams it smallest level first through
+// TextureStreamer, moving GL_TEXTURE_BASE_LEVEL down as levels complete, so the texture sharpens over
+// a few frames without ever exceeding the per-frame budget. Without workers everything happens inline.
+struct TextureLoader {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::pair<TextureRequest*, size_t>> queue;  // (request, image) still to decode
+    std::vector<TextureRequest*> ready;                     // fully decoded, not uploaded yet
+    std::list<TextureRequest> requests;                     // owned by the render thread
+    std::deque<TextureRequest*> uploading;                  // storage allocated, levels streaming
+    bool stopping = false;
+    bool compress = true;               // decode through the <image>.dds BC cache; needs S3TC
+    TextureStreamer streamer;
+    TextureStreamStats stats;
+};
+
+// threads == 0 uses every hardware thread; synchronous loads and uploads on the calling thread
+// (no budget). Needs a current GL context for the staging buffers.
+void startTextureLoader(TextureLoader& loader, unsigned int threads = 0, bool synchronous = false,
+    const TextureStreamOptions& stream = TextureStreamOptions());
+// Drops whatever is still queued, joins the workers and releases the staging buffers.
+void stopTextureLoader(TextureLoader& loader);
+
+// Placeholder colors: white for color maps, a flat +Z normal for normal maps.
+const unsigned char kPlaceholderWhite[3] = { 255, 255, 255 };
+const unsigned char kPlaceholderNormal[3] = { 128, 128, 255 };
+
+// Returns the texture name immediately. A file that fails to decode keeps the placeholder.
+GLuint loadTextureAsync(TextureLoader& loader, const char* path, const unsigned char placeholder[3] = kPlaceholderWhite);
+// faces in GL_TEXTURE_CUBE_MAP_POSITIVE_X.. order; the faces stream together, level by level.
+GLuint loadCubeMapAsync(TextureLoader& loader, const char* const faces[6]);
+
+// Render thread, once per frame: starts textures whose images are decoded and streams levels
+// within the frame budget. Returns how many textures finished this call.
+unsigned int pumpTextureUploads(TextureLoader& loader);
+size_t pendingTextures(const TextureLoader& loader);
@@ -0,0 +1,297 @@
+#include "TextureMips.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <string>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+int mipLevelCount(int width, int height) {
+    int levels = 1;
+    while ((width | height) >> levels) ++levels;
+    return levels;
+}
+
+MipContent mipContentForPath(const char* path) {
+    std::string name = std::filesystem::path(path).filename().string();
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return name.find("normal") != std::string::npos ? MIP_CONTENT_NORMAL : MIP_CONTENT_COLOR;
+}
+
+uint32_t mipOptionsKey(const MipOptions& options) {
+    return static_cast<uint32_t>(options.filter) | static_cast<uint32_t>(options.content) << 4;
+}
+
+const char* mipFilterName(MipFilter filter) {
+    return filter == MIP_FILTER_BOX ? "box" : "kaiser";
+}
+
+// ---- kernels ----
+
+const double kKaiserRadius = 3.0;   // in destination texels
+const double kKaiserAlpha = 4.0;
+
+static double besselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 30; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static double kaiser(double t) {
+    if (std::fabs(t) >= kKaiserRadius) return 0.0;
+    const double sinc = t == 0.0 ? 1.0 : std::sin(3.14159265358979323846 * t) / (3.14159265358979323846 * t);
+    const double r = t / kKaiserRadius;
+    return sinc * besselI0(kKaiserAlpha * std::sqrt(1.0 - r * r)) / besselI0(kKaiserAlpha);
+}
+
+// Source texels and weights for every destination texel of one axis; every destination gets the same
+// number of taps (padded with zero weights) so the passes have no per-texel branches.
+struct FilterTaps {
+    int count = 0;
+    std::vector<int> index;     // [dst * count + tap], clamped to the source
+    std::vector<float> weight;
+};
+
+static FilterTaps makeTaps(int srcSize, int dstSize, MipFilter filter) {
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const double radius = filter == MIP_FILTER_BOX ? scale * 0.5 : kKaiserRadius * scale;
+    std::vector<std::vector<std::pair<int, double>>> taps(dstSize);
+    size_t count = 1;
+    for (int x = 0; x < dstSize; ++x) {
+        const double center = (x + 0.5) * scale;
+        double sum = 0.0;
+        for (int i = static_cast<int>(std::floor(center - radius)); i < static_cast<int>(std::ceil(center + radius)); ++i) {
+            double w;
+            if (filter == MIP_FILTER_BOX) w = std::max(0.0, std::min(i + 1.0, center + radius) - std::max(double(i), center - radius));
+            else w = kaiser((i + 0.5 - center) / scale);
+            if (w == 0.0) continue;
+            taps[x].emplace_back(std::min(std::max(i, 0), srcSize - 1), w);
+            sum += w;
+        }
+        for (auto& tap : taps[x]) tap.second /= sum;
+        count = std::max(count, taps[x].size());
+    }
+    FilterTaps out;
+    out.count = static_cast<int>(count);
+    out.index.assign(dstSize * count, 0);
+    out.weight.assign(dstSize * count, 0.0f);
+    for (int x = 0; x < dstSize; ++x) {
+        for (size_t t = 0; t < taps[x].size(); ++t) {
+            out.index[x * count + t] = taps[x][t].first;
+            out.weight[x * count + t] = static_cast<float>(taps[x][t].second);
+        }
+    }
+    return out;
+}
+
+// ---- row passes ----
+
+typedef void (*AxpyFn)(float* dst, const float* src, float w, int n);
+
+static void axpyScalar(float* dst, const float* src, float w, int n) {
+    for (int i = 0; i < n; ++i) dst[i] += w * src[i];
+}
+
+#ifdef SIMD_X86
+static void axpySSE(float* dst, const float* src, float w, int n) {
+    const __m128 vw = _mm_set1_ps(w);
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(vw, _mm_loadu_ps(src + i))));
+    for (; i < n; ++i) dst[i] += w * src[i];
+}
+
+TARGET_AVX static void axpyAVX(float* dst, const float* src, float w, int n) {
+    const __m256 vw = _mm256_set1_ps(w);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(vw, _mm256_loadu_ps(src + i))));
+    for (; i < n; ++i) dst[i] += w * src[i];
+}
+#endif
+
+static AxpyFn selectAxpy(bool simd) {
+#ifdef SIMD_X86
+    if (simd) {
+        return bestSimdLevel() == SIMD_AVX ? axpyAVX : axpySSE;
+    }
+#endif
+    (void)simd;
+    return axpyScalar;
+}
+
+const size_t kMinWorkPerThread = 1 << 16;     // multiply-adds; smaller passes stay on the calling thread
+
+// dst row y = sum over taps of weight * src row index: the vertical pass, and the horizontal one on
+// transposed planes.
+static void filterRows(const float* src, float* dst, int width, int dstRows, const FilterTaps& taps,
+    AxpyFn axpy, JobSystem* jobs) {
+    const size_t workPerRow = static_cast<size_t>(width) * taps.count;
+    parallelFor(jobs, 1, dstRows, (kMinWorkPerThread + workPerRow - 1) / workPerRow, [&](size_t begin, size_t end) {
+        for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y) {
+            float* d = dst + static_cast<size_t>(y) * width;
+            std::fill(d, d + width, 0.0f);
+            for (int t = 0; t < taps.count; ++t) {
+                const float w = taps.weight[y * taps.count + t];
+                if (w != 0.0f) axpy(d, src + static_cast<size_t>(taps.index[y * taps.count + t]) * width, w, width);
+            }
+        }
+    });
+}
+
+static void transpose(const float* src, float* dst, int width, int height) {
+    const int kTile = 16;
+    for (int y0 = 0; y0 < height; y0 += kTile) {
+        for (int x0 = 0; x0 < width; x0 += kTile) {
+            for (int y = y0; y < std::min(y0 + kTile, height); ++y)
+                for (int x = x0; x < std::min(x0 + kTile, width); ++x)
+                    dst[static_cast<size_t>(x) * height + y] = src[static_cast<size_t>(y) * width + x];
+        }
+    }
+}
+
+// ---- conversions ----
+
+const int kLinearSteps = 16384;
+
+static float srgbToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+struct ColorTables {
+    float toLinear[256];
+    unsigned char toSrgb[kLinearSteps + 1];
+    ColorTables() {
+        for (int i = 0; i < 256; ++i) toLinear[i] = srgbToLinear(i / 255.0f);
+        for (int i = 0; i <= kLinearSteps; ++i)
+            toSrgb[i] = static_cast<unsigned char>(linearToSrgb(static_cast<float>(i) / kLinearSteps) * 255.0f + 0.5f);
+    }
+};
+
+static const ColorTables& colorTables() {
+    static const ColorTables tables;
+    return tables;
+}
+
+static bool isAlpha(int channels, int k) {
+    return (channels == 2 && k == 1) || (channels == 4 && k == 3);
+}
+
+// Interleaved bytes -> one float plane per channel (linear light / [-1, 1] normals).
+static void decodePlanes(const unsigned char* pixels, size_t count, int channels, MipContent content,
+    std::vector<std::vector<float>>& planes) {
+    const ColorTables& tables = colorTables();
+    planes.assign(channels, std::vector<float>(count));
+    for (int k = 0; k < channels; ++k) {
+        float* plane = planes[k].data();
+        const bool alpha = isAlpha(channels, k);
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned char v = pixels[i * channels + k];
+            if (alpha || content == MIP_CONTENT_LINEAR) plane[i] = v / 255.0f;
+            else if (content == MIP_CONTENT_NORMAL) plane[i] = v * (2.0f / 255.0f) - 1.0f;
+            else plane[i] = tables.toLinear[v];
+        }
+    }
+}
+
+static unsigned char toByte(float v) {
+    return static_cast<unsigned char>(std::min(255.0f, std::max(0.0f, v * 255.0f + 0.5f)));
+}
+
+static void encodePlanes(const std::vector<std::vector<float>>& planes, size_t count, int channels, MipContent content,
+    std::vector<unsigned char>& pixels) {
+    const ColorTables& tables = colorTables();
+    pixels.resize(count * channels);
+    for (size_t i = 0; i < count; ++i) {
+        float n[3] = { 0.0f, 0.0f, 1.0f };
+        if (content == MIP_CONTENT_NORMAL && channels >= 3) {
+            const float x = planes[0][i], y = planes[1][i], z = planes[2][i];
+            const float len = std::sqrt(x * x + y * y + z * z);
+            if (len > 1e-6f) { n[0] = x / len; n[1] = y / len; n[2] = z / len; }
+        }
+        for (int k = 0; k < channels; ++k) {
+            const float v = planes[k][i];
+            unsigned char& out = pixels[i * channels + k];
+            if (isAlpha(channels, k) || content == MIP_CONTENT_LINEAR) out = toByte(v);
+            else if (content == MIP_CONTENT_NORMAL) out = toByte((channels >= 3 ? n[k] : v) * 0.5f + 0.5f);
+            else out = tables.toSrgb[static_cast<int>(std::min(1.0f, std::max(0.0f, v)) * kLinearSteps + 0.5f)];
+        }
+    }
+}
+
+void buildMipChain(std::vector<std::vector<unsigned char>>& levels, int width, int height, int channels,
+    const MipOptions& options) {
+    const int count = mipLevelCount(width, height);
+    levels.resize(count);
+    if (count == 1) return;
+    const AxpyFn axpy = selectAxpy(options.simd);
+
+    std::vector<std::vector<float>> planes, next(channels);
+    decodePlanes(levels[0].data(), static_cast<size_t>(width) * height, channels, options.content, planes);
+    std::vector<float> rows, rowsT, colsT;
+    int sw = width, sh = height;
+    for (int level = 1; level < count; ++level) {
+        const int dw = std::max(1, sw >> 1), dh = std::max(1, sh >> 1);
+        const FilterTaps tapsY = makeTaps(sh, dh, options.filter);
+        const FilterTaps tapsX = makeTaps(sw, dw, options.filter);
+        rows.resize(static_cast<size_t>(sw) * dh);
+        rowsT.resize(rows.size());
+        colsT.resize(static_cast<size_t>(dw) * dh);
+        for (int k = 0; k < channels; ++k) {
+            filterRows(planes[k].data(), rows.data(), sw, dh, tapsY, axpy, options.jobs);      // sw x dh
+            transpose(rows.data(), rowsT.data(), sw, dh);                                       // dh x sw
+            filterRows(rowsT.data(), colsT.data(), dh, dw, tapsX, axpy, options.jobs);         // dh x dw
+            next[k].resize(colsT.size());
+            transpose(colsT.data(), next[k].data(), dh, dw);                                    // dw x dh
+        }
+        planes.swap(next);
+        encodePlanes(planes, static_cast<size_t>(dw) * dh, channels, options.content, levels[level]);
+        sw = dw;
+        sh = dh;
+    }
+}
+
+void buildMipChainReference(std::vector<std::vector<unsigned char>>& levels, int width, int height, int channels,
+    const MipOptions& options) {
+    const int count = mipLevelCount(width, height);
+    levels.resize(count);
+    std::vector<std::vector<float>> planes, next(channels);
+    decodePlanes(levels[0].data(), static_cast<size_t>(width) * height, channels, options.content, planes);
+    int sw = width, sh = height;
+    for (int level = 1; level < count; ++level) {
+        const int dw = std::max(1, sw >> 1), dh = std::max(1, sh >> 1);
+        const FilterTaps tapsY = makeTaps(sh, dh, options.filter);
+        const FilterTaps tapsX = makeTaps(sw, dw, options.filter);
+        for (int k = 0; k < channels; ++k) {
+            next[k].assign(static_cast<size_t>(dw) * dh, 0.0f);
+            for (int y = 0; y < dh; ++y) {
+                for (int x = 0; x < dw; ++x) {
+                    double sum = 0.0;
+                    for (int ty = 0; ty < tapsY.count; ++ty) {
+                        const double wy = tapsY.weight[y * tapsY.count + ty];
+                        const float* row = planes[k].data() + static_cast<size_t>(tapsY.index[y * tapsY.count + ty]) * sw;
+                        for (int tx = 0; tx < tapsX.count; ++tx)
+                            sum += wy * tapsX.weight[x * tapsX.count + tx] * row[tapsX.index[x * tapsX.count + tx]];
+                    }
+                    next[k][static_cast<size_t>(y) * dw + x] = static_cast<float>(sum);
+                }
+            }
+        }
+        planes.swap(next);
+        encodePlanes(planes, static_cast<size_t>(dw) * dh, channels, options.content, levels[level]);
+        sw = dw;
+        sh = dh;
+    }
+}
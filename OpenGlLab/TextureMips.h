@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct JobSystem;
+
+enum MipFilter : uint32_t {
+    MIP_FILTER_BOX = 0,         // area average (2x2 for even sizes)
+    MIP_FILTER_KAISER = 1       // Kaiser-windowed sinc, 3 destination texels each side: sharper, less aliasing
+};
+
+enum MipContent : uint32_t {
+    MIP_CONTENT_COLOR = 0,      // sRGB-encoded color, averaged in linear light; alpha stays linear
+    MIP_CONTENT_LINEAR = 1,     // data maps (roughness, height, ...)
+    MIP_CONTENT_NORMAL = 2      // tangent-space normals in RGB, renormalized on every level
+};
+
+struct MipOptions {
+    MipFilter filter = MIP_FILTER_KAISER;
+    MipContent content = MIP_CONTENT_COLOR;
+    JobSystem* jobs = nullptr;  // rows of each pass run as its jobs; null keeps them on the calling thread
+    bool simd = true;           // false runs the same passes with plain loops (identical output)
+};
+
+// levels[0] holds a tightly packed width x height image with 1..4 channels; appends levels 1.. down to 1x1.
+// Every level is filtered from the previous one in float (so rounding does not accumulate) with
+// separable passes vectorized with AVX when the CPU has it, SSE otherwise. Edges clamp.
+void buildMipChain(std::vector<std::vector<unsigned char>>& levels, int width, int height, int channels,
+    const MipOptions& options = MipOptions());
+// Straightforward 2D filter in double precision with the same kernels, for checking buildMipChain
+// (results agree within one step per channel).
+void buildMipChainReference(std::vector<std::vector<unsigned char>>& levels, int width, int height, int channels,
+    const MipOptions& options = MipOptions());
+
+int mipLevelCount(int width, int height);
+// MIP_CONTENT_NORMAL for file names containing "normal", MIP_CONTENT_COLOR otherwise.
+MipContent mipContentForPath(const char* path);
+// Filter and content packed into one word, stored with baked mip chains to detect option changes.
+uint32_t mipOptionsKey(const MipOptions& options);
+const char* mipFilterName(MipFilter filter);
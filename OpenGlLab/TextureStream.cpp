@@ -0,0 +1,135 @@
+#include "TextureStream.h"
+#include <cstring>
+#include <limits>
+
+const size_t kMinSlotSize = 256 * 1024;
+
+void initTextureStreamer(TextureStreamer& streamer, const TextureStreamOptions& options) {
+    shutdownTextureStreamer(streamer);
+    streamer.frameBudget = options.frameBudget;
+    streamer.path = TEXTURE_UPLOAD_DIRECT;
+    // Unlimited budgets have no fixed staging size, so they always upload directly.
+    if (!options.usePbo || options.frameBudget == 0 || !GLAD_GL_VERSION_2_1) return;
+
+    streamer.slotSize = options.frameBudget < kMinSlotSize ? kMinSlotSize : options.frameBudget;
+    if (options.persistent && GLAD_GL_VERSION_4_4) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr size = static_cast<GLsizeiptr>(streamer.slotSize * TextureStreamer::kSlots);
+        glGenBuffers(1, &streamer.buffers[0]);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamer.buffers[0]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        streamer.persistentMemory = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (streamer.persistentMemory) {
+            streamer.path = TEXTURE_UPLOAD_PBO_PERSISTENT;
+            return;
+        }
+        glDeleteBuffers(1, &streamer.buffers[0]);
+        streamer.buffers[0] = 0;
+    }
+    glGenBuffers(TextureStreamer::kSlots, streamer.buffers);
+    streamer.path = TEXTURE_UPLOAD_PBO_ORPHAN;
+}
+
+void shutdownTextureStreamer(TextureStreamer& streamer) {
+    for (int i = 0; i < TextureStreamer::kSlots; ++i) {
+        if (streamer.fences[i]) glDeleteSync(streamer.fences[i]);
+    }
+    if (streamer.persistentMemory) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamer.buffers[0]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    if (streamer.path != TEXTURE_UPLOAD_DIRECT) glDeleteBuffers(TextureStreamer::kSlots, streamer.buffers);
+    streamer = TextureStreamer();
+}
+
+const char* textureUploadPathName(TextureUploadPath path) {
+    switch (path) {
+    case TEXTURE_UPLOAD_PBO_ORPHAN: return "PBO ring (orphaning)";
+    case TEXTURE_UPLOAD_PBO_PERSISTENT: return "PBO ring (persistent mapping)";
+    default: return "direct";
+    }
+}
+
+bool beginTextureStreamFrame(TextureStreamer& streamer) {
+    streamer.used = 0;
+    streamer.copies.clear();
+    streamer.staging = nullptr;
+    switch (streamer.path) {
+    case TEXTURE_UPLOAD_PBO_PERSISTENT: {
+        GLsync& fence = streamer.fences[streamer.slot];
+        if (fence) {
+            GLenum state = glClientWaitSync(fence, 0, 0);
+            if (state == GL_TIMEOUT_EXPIRED) return false;
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        streamer.staging = streamer.persistentMemory + streamer.slot * streamer.slotSize;
+        return true;
+    }
+    case TEXTURE_UPLOAD_PBO_ORPHAN:
+        // Orphaning hands the old storage to the driver, so mapping never waits for the GPU.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamer.buffers[streamer.slot]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(streamer.slotSize), nullptr, GL_STREAM_DRAW);
+        streamer.staging = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+            static_cast<GLsizeiptr>(streamer.slotSize), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return true;    // a failed map leaves staging null: this frame uploads directly
+    default:
+        return true;
+    }
+}
+
+size_t textureStreamBudget(const TextureStreamer& streamer) {
+    if (streamer.frameBudget == 0) return std::numeric_limits<size_t>::max();
+    return streamer.used < streamer.frameBudget ? streamer.frameBudget - streamer.used : 0;
+}
+
+static void uploadRows(const TextureStreamCopy& c, const void* data) {
+    glBindTexture(c.bindTarget, c.texture);
+    if (c.compressedSize) glCompressedTexSubImage2D(c.target, c.level, 0, c.y, c.width, c.rows, c.format, c.compressedSize, data);
+    else glTexSubImage2D(c.target, c.level, 0, c.y, c.width, c.rows, c.format, GL_UNSIGNED_BYTE, data);
+}
+
+static void streamCopy(TextureStreamer& streamer, TextureStreamCopy copy, const unsigned char* src, size_t bytes) {
+    const bool staged = streamer.staging && streamer.used + bytes <= streamer.slotSize;
+    if (!staged) {
+        // Direct path, or a copy larger than a staging slot: upload from client memory.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        uploadRows(copy, src);
+        streamer.used += bytes;
+        return;
+    }
+    std::memcpy(streamer.staging + streamer.used, src, bytes);
+    copy.offset = streamer.used;
+    streamer.copies.push_back(copy);
+    streamer.used += bytes;
+}
+
+void streamTextureRows(TextureStreamer& streamer, GLuint texture, GLenum bindTarget, GLenum target, GLint level,
+    GLint y, GLsizei width, GLsizei rows, GLenum format, int channels, const unsigned char* src) {
+    const size_t bytes = static_cast<size_t>(width) * rows * channels;
+    streamCopy(streamer, { texture, bindTarget, target, level, y, width, rows, format, 0, 0 }, src, bytes);
+}
+
+void streamCompressedRows(TextureStreamer& streamer, GLuint texture, GLenum bindTarget, GLenum target, GLint level,
+    GLint y, GLsizei width, GLsizei rows, GLenum internalFormat, const unsigned char* src, size_t bytes) {
+    streamCopy(streamer, { texture, bindTarget, target, level, y, width, rows, internalFormat,
+        static_cast<GLsizei>(bytes), 0 }, src, bytes);
+}
+
+void endTextureStreamFrame(TextureStreamer& streamer) {
+    if (streamer.path == TEXTURE_UPLOAD_DIRECT || !streamer.staging) return;
+    GLuint buffer = streamer.buffers[streamer.path == TEXTURE_UPLOAD_PBO_PERSISTENT ? 0 : streamer.slot];
+    size_t base = streamer.path == TEXTURE_UPLOAD_PBO_PERSISTENT ? streamer.slot * streamer.slotSize : 0;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    if (streamer.path == TEXTURE_UPLOAD_PBO_ORPHAN) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    for (const TextureStreamCopy& c : streamer.copies) uploadRows(c, (const void*)(base + c.offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (streamer.path == TEXTURE_UPLOAD_PBO_PERSISTENT && !streamer.copies.empty())
+        streamer.fences[streamer.slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    streamer.slot = (streamer.slot + 1) % TextureStreamer::kSlots;
+    streamer.staging = nullptr;
+    streamer.copies.clear();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+enum TextureUploadPath {
+    TEXTURE_UPLOAD_DIRECT,          // glTexSubImage2D from client memory
+    TEXTURE_UPLOAD_PBO_ORPHAN,      // ring of PBOs, orphaned with glBufferData before every map
+    TEXTURE_UPLOAD_PBO_PERSISTENT   // one persistently mapped buffer split into fenced slots (GL 4.4)
+};
+
+struct TextureStreamOptions {
+    size_t frameBudget = 4 << 20;   // bytes uploaded per frame; 0 = unlimited
+    bool usePbo = true;
+    bool persistent = true;         // only where GL 4.4 is available
+};
+
+// Rows of a texture level to copy at the end of the frame.
+struct TextureStreamCopy {
+    GLuint texture;
+    GLenum bindTarget;              // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+    GLenum target;                  // GL_TEXTURE_2D or a cube face
+    GLint level, y;
+    GLsizei width, rows;
+    GLenum format;                  // pixel format, or the internal format of compressed rows
+    GLsizei compressedSize;         // 0 for uncompressed rows
+    size_t offset;                  // into the frame's staging slot
+};
+
+// Stages texture data through pixel unpack buffers so glTexSubImage2D reads from GPU-visible memory
+// instead of blocking on client memory, and caps the bytes uploaded per frame.
+// Frame protocol: beginTextureStreamFrame, streamTextureRows while textureStreamBudget() allows,
+// endTextureStreamFrame.
+struct TextureStreamer {
+    static const int kSlots = 3;
+    TextureUploadPath path = TEXTURE_UPLOAD_DIRECT;
+    size_t frameBudget = 0;
+    size_t slotSize = 0;
+    GLuint buffers[kSlots] = {};
+    GLsync fences[kSlots] = {};
+    unsigned char* persistentMemory = nullptr;
+    int slot = 0;
+
+    // current frame
+    unsigned char* staging = nullptr;
+    size_t used = 0;
+    std::vector<TextureStreamCopy> copies;
+};
+
+void initTextureStreamer(TextureStreamer& streamer, const TextureStreamOptions& options);
+void shutdownTextureStreamer(TextureStreamer& streamer);
+const char* textureUploadPathName(TextureUploadPath path);
+
+// False when the next staging slot is still in use by the GPU; nothing may be streamed that frame.
+bool beginTextureStreamFrame(TextureStreamer& streamer);
+// Bytes that may still be streamed this frame.
+size_t textureStreamBudget(const TextureStreamer& streamer);
+// Uploads rows [y, y + rows) of a tightly packed level; rows * width * channels must fit the budget
+// unless it is the first copy of the frame.
+void streamTextureRows(TextureStreamer& streamer, GLuint texture, GLenum bindTarget, GLenum target, GLint level,
+    GLint y, GLsizei width, GLsizei rows, GLenum format, int channels, const unsigned char* src);
+// Same for rows of 4x4 blocks: y and rows in pixels (multiples of 4 except at the bottom edge).
+void streamCompressedRows(TextureStreamer& streamer, GLuint texture, GLenum bindTarget, GLenum target, GLint level,
+    GLint y, GLsizei width, GLsizei rows, GLenum internalFormat, const unsigned char* src, size_t bytes);
+void endTextureStreamFrame(TextureStreamer& streamer);
@@ -0,0 +1,86 @@
+#include "UniformBuffer.h"
+#include <cstring>
+#include <iostream>
+
+bool initUniformRing(UniformRing& ring, size_t frameBytes, int blocks) {
+    shutdownUniformRing(ring);
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0) ring.alignment = static_cast<size_t>(alignment);
+    ring.regionSize = alignBufferOffset(frameBytes + static_cast<size_t>(blocks) * (ring.alignment - 1), ring.alignment);
+
+    glGenBuffers(1, &ring.buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(ring.regionSize * FencedRegions::kRegions), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if (!ring.buffer) {
+        std::cerr << "ERROR: could not create the uniform buffer ring\n";
+        return false;
+    }
+    ring.staging.reserve(ring.regionSize);
+    return true;
+}
+
+void shutdownUniformRing(UniformRing& ring) {
+    deleteFences(ring.regions);
+    if (ring.buffer) glDeleteBuffers(1, &ring.buffer);
+    ring = UniformRing();
+}
+
+void beginUniformFrame(UniformRing& ring) {
+    ring.staging.clear();
+    ring.blocks.clear();
+}
+
+bool stageUniformBlock(UniformRing& ring, GLuint binding, const void* data, size_t bytes) {
+    const size_t offset = alignBufferOffset(ring.staging.size(), ring.alignment);
+    if (offset + bytes > ring.regionSize) {
+        std::cerr << "ERROR: uniform block " << binding << " does not fit the uniform ring region\n";
+        return false;
+    }
+    ring.staging.resize(offset + bytes);
+    std::memcpy(ring.staging.data() + offset, data, bytes);
+    ring.blocks.push_back({ binding, offset, bytes });
+    return true;
+}
+
+static bool sameBlocks(const std::vector<UniformRingBlock>& a, const std::vector<UniformRingBlock>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if (a[i].binding != b[i].binding || a[i].offset != b[i].offset || a[i].size != b[i].size) return false;
+    return true;
+}
+
+void endUniformFrame(UniformRing& ring) {
+    if (!ring.buffer || ring.staging.empty()) return;
+    if (ring.regions.region >= 0 && ring.staging == ring.uploaded && sameBlocks(ring.blocks, ring.uploadedBlocks)) {
+        ++ring.stats.reused;
+        return;
+    }
+
+    ring.stats.waitMs += advanceFencedRegion(ring.regions);
+    const size_t base = static_cast<size_t>(ring.regions.region) * ring.regionSize;
+    glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    void* dst = glMapBufferRange(GL_UNIFORM_BUFFER, static_cast<GLintptr>(base), static_cast<GLsizeiptr>(ring.staging.size()),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst) {
+        std::memcpy(dst, ring.staging.data(), ring.staging.size());
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    else {
+        glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(base), static_cast<GLsizeiptr>(ring.staging.size()), ring.staging.data());
+    }
+    for (const UniformRingBlock& b : ring.blocks)
+        glBindBufferRange(GL_UNIFORM_BUFFER, b.binding, ring.buffer, static_cast<GLintptr>(base + b.offset), static_cast<GLsizeiptr>(b.size));
+
+    ++ring.stats.uploads;
+    ring.stats.bytes += ring.staging.size();
+    ring.uploaded.swap(ring.staging);
+    ring.uploadedBlocks.swap(ring.blocks);
+}
+
+UniformRingStats takeUniformRingStats(UniformRing& ring) {
+    UniformRingStats stats = ring.stats;
+    ring.stats = UniformRingStats();
+    return stats;
+}
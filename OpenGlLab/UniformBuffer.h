@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include "DynamicBuffer.h"
+#include <cstddef>
+#include <vector>
+
+// Where a staged block goes: uniform buffer binding index and its bytes in the frame's staging copy.
+struct UniformRingBlock {
+    GLuint binding;
+    size_t offset, size;
+};
+
+struct UniformRingStats {
+    unsigned int uploads = 0;       // frames whose blocks were copied into a region
+    unsigned int reused = 0;        // frames that kept the bound region (same bytes as the last upload)
+    size_t bytes = 0;               // copied into the buffer
+    double waitMs = 0.0;            // blocked on a region the GPU was still reading
+};
+
+// Per-frame std140 uniform blocks shared by every program (camera, lights, fog). One buffer is split into
+// FencedRegions::kRegions regions; a frame's blocks are staged on the CPU, copied into the next region
+// with an unsynchronized map and bound with glBindBufferRange, so each value is written once per frame
+// however many programs read it. A frame whose blocks match the last upload leaves everything bound as it is.
+// Frame protocol: beginUniformFrame, stageUniformBlock for each block, endUniformFrame, then draw.
+struct UniformRing {
+    GLuint buffer = 0;
+    size_t alignment = 256;         // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    size_t regionSize = 0;
+    FencedRegions regions;          // region the bindings point at; -1 before the first upload
+
+    // current frame, and what is bound now
+    std::vector<unsigned char> staging, uploaded;
+    std::vector<UniformRingBlock> blocks, uploadedBlocks;
+    UniformRingStats stats;
+};
+
+// frameBytes: sum of the block sizes staged per frame; room for aligning each of the blocks is added.
+bool initUniformRing(UniformRing& ring, size_t frameBytes, int blocks);
+void shutdownUniformRing(UniformRing& ring);
+
+void beginUniformFrame(UniformRing& ring);
+// Copies a block to the staging area; false (and nothing staged) when it would overflow the region.
+bool stageUniformBlock(UniformRing& ring, GLuint binding, const void* data, size_t bytes);
+void endUniformFrame(UniformRing& ring);
+
+// Returns and clears the counters.
+UniformRingStats takeUniformRingStats(UniformRing& ring);
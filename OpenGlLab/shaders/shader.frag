@@ -1,39 +1,69 @@
 #version 330 core
 in vec3 FragPos;
-in vec3 Tangent;
-flat in vec3 FlatNormal;
+in vec4 Tangent;        // xyz, w = handedness (MikkTSpace)
+in vec3 Normal;
 in vec2 TexCoord;
 out vec4 FragColor;
 uniform int mode;
 uniform bool isTerrain;
 uniform sampler2D texture1;  // Diffuse
+uniform vec3 uDiffuseColor = vec3(1.0);  // MTL Kd
 uniform sampler2D normalTexture; 
-uniform vec3 viewPos;
-uniform vec3 ambientColor;  
 uniform int invertNormal;
-// Multi-light
-uniform int numLights;
-uniform vec3 lightPositions[4];  // Max 4
-uniform vec3 lightColors[4];
 uniform int currentLightIndex;
-// Fog
-uniform int fogMode;
-uniform vec3 fogColor;
-uniform float fogStart;
-uniform float fogEnd;
-uniform float fogDensity;
 
-uniform mat4 uModel;
+// Per-frame blocks (std140), one copy for all programs in a uniform buffer ring (UniformBuffer.h).
+// The layouts must match CameraBlock/LightingBlock/FogBlock in FileName.cpp.
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uSkyView;      // uView without the translation
+    vec3 viewPos;
+};
+// Multi-light
+layout (std140) uniform Lighting {
+    vec3 lightPositions[4];  // Max 4
+    vec3 lightColors[4];
+    vec3 ambientColor;
+    int numLights;
+};
+layout (std140) uniform Fog {
+    vec3 fogColor;
+    int fogMode;
+    float fogStart;
+    float fogEnd;
+    float fogDensity;
+};
+
+// Per-draw block (std140), allocated from the per-frame dynamic buffer (DynamicBuffer.h); must match
+// ObjectBlock in FileName.cpp.
+layout (std140) uniform Object {
+    mat4 uModel;
+    mat3 uNormalMatrix;
+};
+
+#ifdef WIREFRAME_BARYCENTRIC
+noperspective in vec3 Barycentric;      // from wire_bary.gs
+
+// 1 inside the triangle, falling to 0 within about a pixel of an edge (the line wire.gs draws).
+float wireEdge() {
+    vec3 width = fwidth(Barycentric);
+    vec3 edge = smoothstep(vec3(0.0), width * 1.5, Barycentric);
+    return min(min(edge.x, edge.y), edge.z);
+}
+#endif
 
 vec3 calcNormal() {
-    vec3 normal = normalize(FlatNormal);
+    vec3 normal = normalize(Normal);
     if (textureSize(normalTexture, 0).x > 0) { 
-        vec3 tangent = normalize(Tangent);
-        vec3 bitangent = cross(normal, tangent);  // Simple TBN
-        mat3 TBN = mat3(tangent, bitangent, normal);
+        // MikkTSpace: the bitangent is rebuilt per pixel and the interpolated vectors are used
+        // unnormalized, matching how the baker encoded the map.
+        vec3 bitangent = Tangent.w * cross(Normal, Tangent.xyz);
         
-        vec3 normalMap = texture(normalTexture, TexCoord).rgb * 2.0 - 1.0;
-        normal = normalize(TBN * normalMap);
+        // Z is rebuilt from X/Y, so two-channel BC5 normal maps work as well as RGB ones.
+        vec2 normalXY = texture(normalTexture, TexCoord).rg * 2.0 - 1.0;
+        vec3 normalMap = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+        normal = normalize(normalMap.x * Tangent.xyz + normalMap.y * bitangent + normalMap.z * Normal);
     }
     return normal;
 }
@@ -59,7 +89,7 @@ void main() {
         float height = FragPos.y + 1.0;
         texColor = mix(vec3(0.4, 0.2, 0.1), vec3(0.2, 0.6, 0.2), smoothstep(-0.5, 0.5, height));
     } else {
-        texColor = texture(texture1, TexCoord).rgb;
+        texColor = texture(texture1, TexCoord).rgb * uDiffuseColor;
     }
     
     vec3 norm = calcNormal();
@@ -97,6 +127,10 @@ void main() {
         color = mix(fogColor, sceneColor, fogFactor);
     }
     
+#ifdef WIREFRAME_BARYCENTRIC
+    color = mix(vec3(0.0), color, wireEdge());  // black, as wire.frag
+#endif
+
     float alpha = 1.0;
     FragColor = vec4(color, alpha);
 }
\ No newline at end of file
@@ -1,24 +1,153 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;       // w: tangent handedness of quantized meshes
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in float aInstanceX;  // instanced snow: one stream per coordinate (Snowfall)
+layout (location = 4) in float aInstanceY;
+layout (location = 5) in float aInstanceZ;
+layout (location = 6) in vec4 aTangent;   // xyz, w = handedness; quantized: oct-encoded xy only
+
+// Built with WIREFRAME_BARYCENTRIC the outputs go to wire_bary.gs, which passes them on under the
+// names shader.frag reads.
+#ifdef WIREFRAME_BARYCENTRIC
+#define FragPos vFragPos
+#define Normal vNormal
+#define TexCoord vTexCoord
+#define Tangent vTangent
+#endif
 
 out vec3 FragPos;
-flat out vec3 FlatNormal;
+out vec3 Normal;
 out vec2 TexCoord;
-out vec3 Tangent;
+out vec4 Tangent;
+
+// Per-draw block (std140), allocated from the per-frame dynamic buffer (DynamicBuffer.h); must match
+// ObjectBlock in FileName.cpp.
+layout (std140) uniform Object {
+    mat4 uModel;
+    mat3 uNormalMatrix;     // inverse transpose of mat3(uModel), computed once per draw on the CPU
+};
+
+// Per-frame camera block (std140), shared by every program; must match CameraBlock in FileName.cpp.
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uSkyView;      // uView without the translation
+    vec3 viewPos;
+};
+
+// Quantized meshes (PackedVertex): int16 position relative to the mesh bounds, oct-encoded normal and
+// tangent.
+uniform vec3 uPosScale = vec3(1.0);
+uniform vec3 uPosOffset = vec3(0.0);
+uniform bool uOctNormals = false;
+
+// Instanced draws take their placement from aInstance* and uInstanceScale instead of uModel.
+uniform bool uInstanced = false;
+uniform float uInstanceScale = 1.0;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+#if defined(TERRAIN_CDLOD) || defined(TERRAIN_CHUNKED)
+// Heightfield terrain, either renderer.
+uniform vec3 uHeightfield;      // x, z of the first sample and the sample spacing
+uniform vec2 uHeightmapSize;    // samples along x and z
+#endif
+
+#ifdef TERRAIN_CDLOD
+// CDLOD terrain (Cdlod.h): aPos.xz is the patch grid position in [0, 1], placed on the node per draw;
+// the heights come from the heightfield texture.
+uniform vec3 uCdlodNode;        // node corner x, z and edge
+uniform float uCdlodRange;      // end of the node's level range
+uniform sampler2D uHeightmap;
+uniform float uPatchQuads;
+uniform float uMorphStart;     // fraction of uCdlodRange where the morph begins
 
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
+float terrainHeight(vec2 p)
+{
+    vec2 uv = ((p - uHeightfield.xy) / uHeightfield.z + 0.5) / uHeightmapSize;
+    return textureLod(uHeightmap, uv, 0.0).r;
+}
+
+void cdlodVertex(inout vec3 position, inout vec3 normal, inout vec2 texCoord, inout vec4 tangent)
+{
+    vec2 grid = position.xz;
+    vec2 p = uCdlodNode.xy + grid * uCdlodNode.z;
+    // Towards the end of the range odd vertices slide onto the next level's grid, reaching it where the
+    // coarser neighbour starts.
+    vec3 world = vec3(uModel * vec4(p.x, terrainHeight(p), p.y, 1.0));
+    float morph = clamp((distance(world, viewPos) / uCdlodRange - uMorphStart) / (1.0 - uMorphStart), 0.0, 1.0);
+    grid -= fract(grid * uPatchQuads * 0.5) * (2.0 / uPatchQuads) * morph;
+    p = uCdlodNode.xy + grid * uCdlodNode.z;
+    position = vec3(p.x, terrainHeight(p), p.y);
+
+    // Central differences; the tangent follows the slope along +x, the direction of increasing u, with the
+    // handedness of the chunked terrain's.
+    float d = uHeightfield.z;
+    float hx = terrainHeight(p + vec2(d, 0.0)) - terrainHeight(p - vec2(d, 0.0));
+    float hz = terrainHeight(p + vec2(0.0, d)) - terrainHeight(p - vec2(0.0, d));
+    normal = normalize(vec3(-hx, 2.0 * d, -hz));
+    tangent = vec4(normalize(vec3(2.0 * d, hx, 0.0)), -1.0);
+    texCoord = (p - uHeightfield.xy) / (uHeightfield.z * (uHeightmapSize - 1.0));
+}
+#endif
+
+#ifdef TERRAIN_CHUNKED
+// Chunked terrain (Terrain.h): aPos.xz is the template grid position in cells, aPos.y -1 on the skirt.
+uniform vec3 uTerrainNode;      // node corner x, z and cell edge, in samples
+uniform float uSkirtDepth;
+uniform usampler2D uTerrainSamples; // createTerrainTexture: height bits, oct-encoded normal
+
+void chunkedVertex(inout vec3 position, inout vec3 normal, inout vec2 texCoord, inout vec4 tangent)
+{
+    // Whole samples: the neighbouring node reads exactly the same texel on a shared border.
+    ivec2 texel = ivec2(uTerrainNode.xy + position.xz * uTerrainNode.z);
+    uvec2 s = texelFetch(uTerrainSamples, texel, 0).rg;
+    vec2 p = uHeightfield.xy + vec2(texel) * uHeightfield.z;
+    position = vec3(p.x, uintBitsToFloat(s.r) + position.y * uSkirtDepth, p.y);
+    normal = octDecode(vec2(int(s.g << 16) >> 16, int(s.g) >> 16) / 32767.0);
+    // u runs along +x and v along +z: the tangent is the slope along x, (1, -n.x / n.y, 0) normalized,
+    // and v points against cross(normal, tangent) everywhere on a heightfield.
+    tangent = vec4(normalize(vec3(normal.y, -normal.x, 0.0)), -1.0);
+    texCoord = vec2(texel) / (uHeightmapSize - 1.0);
+}
+#endif
 
 void main()
 {
-    FragPos = vec3(uModel * vec4(aPos, 1.0));
-    FlatNormal = mat3(transpose(inverse(uModel))) * aNormal;  
-    TexCoord = aTexCoord;
-    vec3 T = normalize(vec3(1.0, 0.0, 0.0) - dot(vec3(1.0, 0.0, 0.0), FlatNormal) * FlatNormal);
-    Tangent = T;
+    vec3 position = aPos.xyz * uPosScale + uPosOffset;
+    vec3 normal = uOctNormals ? octDecode(aNormal.xy / 32767.0) : aNormal;
+    vec4 tangent = uOctNormals ? vec4(octDecode(aTangent.xy / 32767.0), aPos.w) : aTangent;
+    vec2 texCoord = aTexCoord;
+#ifdef TERRAIN_CDLOD
+    cdlodVertex(position, normal, texCoord, tangent);
+#endif
+#ifdef TERRAIN_CHUNKED
+    chunkedVertex(position, normal, texCoord, tangent);
+#endif
+    if (uInstanced) {
+        FragPos = vec3(aInstanceX, aInstanceY, aInstanceZ) + position * uInstanceScale;
+        Normal = normal;
+        Tangent = tangent;
+    }
+    else {
+        FragPos = vec3(uModel * vec4(position, 1.0));
+#ifdef NORMAL_MATRIX_PER_VERTEX
+        // The old path, kept for --bench-normals: a 4x4 inverse in every vertex.
+        Normal = mat3(transpose(inverse(uModel))) * normal;
+#else
+        Normal = uNormalMatrix * normal;
+#endif
+        // Tangents lie in the surface and transform like positions.
+        Tangent = vec4(mat3(uModel) * tangent.xyz, tangent.w);
+    }
+    TexCoord = texCoord;
     gl_Position = uProj * uView * vec4(FragPos, 1.0);
 }
@@ -5,11 +5,17 @@ layout (location = 0) in vec3 aPos;
 out vec3 TexCoords;
 
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
+
+// Per-frame camera block (std140), shared by every program; must match CameraBlock in FileName.cpp.
+layout (std140) uniform Camera {
+    mat4 uView;
+    mat4 uProj;
+    mat4 uSkyView;      // uView without the translation
+    vec3 viewPos;
+};
 
 void main() {
     TexCoords = aPos;
-    vec4 pos = uProj * uView * uModel * vec4(aPos, 1.0);
+    vec4 pos = uProj * uSkyView * uModel * vec4(aPos, 1.0);
     gl_Position = pos.xyww;  
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#version 330 core
+
+// GPU snow (createSnowfallGPU): one flake per vertex, advanced with the same steps as the CPU kernels
+// in Snow.cpp. Transform feedback writes the new state into the other buffer; nothing is rasterized.
+layout (location = 0) in vec4 aPosLife;     // x, y, z, life
+layout (location = 1) in vec4 aVelPhase;    // vx, vy, vz, turbulence phase
+
+out vec4 tfPosLife;
+out vec4 tfVelPhase;
+
+uniform float uDt;
+uniform float uDragDt;
+uniform float uGravityDt;
+uniform vec3 uWind;
+uniform float uTurbulence;
+uniform float uAngle;
+uniform float uExtent;
+uniform float uBottom;
+uniform float uTop;
+uniform vec2 uLife;         // min, max
+uniform float uSpawnVy;     // terminal fall speed
+uniform uint uSeed;
+uniform uint uStep;
+
+uint hash32(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint rngState;
+
+float nextRandom()
+{
+    rngState += 0x9e3779b9u;
+    return float(hash32(rngState) >> 8) * (1.0 / 16777216.0);
+}
+
+float fastSin(float a)
+{
+    a = a - roundEven(a * 0.15915494) * 6.2831853;
+    float s = a * (1.2732395 + -0.40528473 * abs(a));
+    return s + 0.225 * (s * abs(s) - s);
+}
+
+void main()
+{
+    float a = uAngle + aVelPhase.w;
+    float tx = uWind.x + uTurbulence * fastSin(a);
+    float tz = uWind.z + uTurbulence * fastSin(a * 1.37 + 1.7);
+    vec3 v = aVelPhase.xyz;
+    v.x = v.x + uDragDt * (tx - v.x);
+    v.y = v.y + (uDragDt * (uWind.y - v.y) - uGravityDt);
+    v.z = v.z + uDragDt * (tz - v.z);
+    vec3 p = aPosLife.xyz + v * uDt;
+    float life = aPosLife.w - uDt;
+    float phase = aVelPhase.w;
+
+    if (p.y < uBottom || life <= 0.0 || abs(p.x) > uExtent || abs(p.z) > uExtent) {
+        rngState = hash32(uSeed ^ hash32(uint(gl_VertexID) ^ hash32(uStep)));
+        p.x = (nextRandom() * 2.0 - 1.0) * uExtent;
+        p.z = (nextRandom() * 2.0 - 1.0) * uExtent;
+        nextRandom();
+        p.y = uTop;
+        v = vec3(uWind.x, uSpawnVy, uWind.z);
+        life = uLife.x + nextRandom() * (uLife.y - uLife.x);
+        phase = nextRandom() * 6.2831853;
+    }
+    tfPosLife = vec4(p, life);
+    tfVelPhase = vec4(v, phase);
+}
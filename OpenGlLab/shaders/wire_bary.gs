@@ -0,0 +1,31 @@
+#version 330 core
+
+// Single-pass wireframe: the triangle goes through unchanged with the barycentric coordinate of each
+// corner added, and shader.frag (built with WIREFRAME_BARYCENTRIC) darkens fragments next to an edge.
+// Replaces the second draw of every mesh through wire.gs.
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+in vec3 vFragPos[];
+in vec3 vNormal[];
+in vec2 vTexCoord[];
+in vec4 vTangent[];
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+out vec4 Tangent;
+noperspective out vec3 Barycentric;
+
+void main() {
+    for (int i = 0; i < 3; ++i) {
+        gl_Position = gl_in[i].gl_Position;
+        FragPos = vFragPos[i];
+        Normal = vNormal[i];
+        TexCoord = vTexCoord[i];
+        Tangent = vTangent[i];
+        Barycentric = vec3(i == 0, i == 1, i == 2);
+        EmitVertex();
+    }
+    EndPrimitive();
+}